@@ -62,6 +62,18 @@ void nsvgRasterize(NSVGrasterizer* r,
 // Deletes rasterizer context.
 void nsvgDeleteRasterizer(NSVGrasterizer*);
 
+// SIMD kernels for coverage accumulation, solid color fills and unpremultiplying.
+enum NSVGsimd {
+	NSVG_SIMD_NONE = 0,
+	NSVG_SIMD_SSE2 = 1,
+	NSVG_SIMD_AVX2 = 2
+};
+
+// Selects the SIMD kernels used by the rasterizer, clamped to what was compiled in.
+// The caller must check that the CPU supports the level. The output is the same for every level.
+// Returns the level that will be used. New rasterizers start at NSVG_SIMD_NONE.
+int nsvgSetRasterizerSIMD(NSVGrasterizer* r, int level);
+
 
 #ifdef __cplusplus
 };
@@ -73,6 +85,21 @@ void nsvgDeleteRasterizer(NSVGrasterizer*);
 
 #include <math.h>
 
+#if !defined(NSVG_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define NSVG__SSE2 1
+#include <emmintrin.h>
+// AVX2 kernels are compiled for the target on their own; the caller checks the CPU before selecting them.
+#if defined(_MSC_VER) && _MSC_VER >= 1800
+#define NSVG__AVX2 1
+#define NSVG__TARGET_AVX2
+#include <immintrin.h>
+#elif defined(__GNUC__) || defined(__clang__)
+#define NSVG__AVX2 1
+#define NSVG__TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+
 #define NSVG__SUBSAMPLES	5
 #define NSVG__FIXSHIFT		10
 #define NSVG__FIX			(1 << NSVG__FIXSHIFT)
@@ -141,6 +168,8 @@ struct NSVGrasterizer
 
 	unsigned char* bitmap;
 	int width, height, stride;
+
+	int simd;
 };
 
 NSVGrasterizer* nsvgCreateRasterizer()
@@ -159,6 +188,20 @@ error:
 	return NULL;
 }
 
+int nsvgSetRasterizerSIMD(NSVGrasterizer* r, int level)
+{
+#if defined(NSVG__AVX2)
+	if (level > NSVG_SIMD_AVX2) level = NSVG_SIMD_AVX2;
+#elif defined(NSVG__SSE2)
+	if (level > NSVG_SIMD_SSE2) level = NSVG_SIMD_SSE2;
+#else
+	level = NSVG_SIMD_NONE;
+#endif
+	if (level < NSVG_SIMD_NONE) level = NSVG_SIMD_NONE;
+	r->simd = level;
+	return level;
+}
+
 void nsvgDeleteRasterizer(NSVGrasterizer* r)
 {
 	NSVGmemPage* p;
@@ -883,7 +926,7 @@ static void nsvg__freeActive(NSVGrasterizer* r, NSVGactiveEdge* z)
 	r->freelist = z;
 }
 
-static void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1, int maxWeight, int* xmin, int* xmax)
+static void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1, int maxWeight, int* xmin, int* xmax, int simd)
 {
 	int i = x0 >> NSVG__FIXSHIFT;
 	int j = x1 >> NSVG__FIXSHIFT;
@@ -904,7 +947,20 @@ static void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1,
 			else
 				j = len; // clip
 
-			for (++i; i < j; ++i) // fill pixels between x0 and x1
+			++i;
+#ifdef NSVG__SSE2
+			if (simd >= NSVG_SIMD_SSE2) {
+				// Bytes wrap around just like the scalar loop below.
+				__m128i w = _mm_set1_epi8((char)maxWeight);
+				for (; i + 16 <= j; i += 16) {
+					__m128i s = _mm_loadu_si128((__m128i*)&scanline[i]);
+					_mm_storeu_si128((__m128i*)&scanline[i], _mm_add_epi8(s, w));
+				}
+			}
+#else
+			(void)simd;
+#endif
+			for (; i < j; ++i) // fill pixels between x0 and x1
 				scanline[i] += (unsigned char)maxWeight;
 		}
 	}
@@ -913,7 +969,7 @@ static void nsvg__fillScanline(unsigned char* scanline, int len, int x0, int x1,
 // note: this routine clips fills that extend off the edges... ideally this
 // wouldn't happen, but it could happen if the truetype glyph bounding boxes
 // are wrong, or if the user supplies a too-small bitmap
-static void nsvg__fillActiveEdges(unsigned char* scanline, int len, NSVGactiveEdge* e, int maxWeight, int* xmin, int* xmax, char fillRule)
+static void nsvg__fillActiveEdges(unsigned char* scanline, int len, NSVGactiveEdge* e, int maxWeight, int* xmin, int* xmax, char fillRule, int simd)
 {
 	// non-zero winding fill
 	int x0 = 0, w = 0;
@@ -928,7 +984,7 @@ static void nsvg__fillActiveEdges(unsigned char* scanline, int len, NSVGactiveEd
 				int x1 = e->x; w += e->dir;
 				// if we went to zero, we need to draw
 				if (w == 0)
-					nsvg__fillScanline(scanline, len, x0, x1, maxWeight, xmin, xmax);
+					nsvg__fillScanline(scanline, len, x0, x1, maxWeight, xmin, xmax, simd);
 			}
 			e = e->next;
 		}
@@ -940,7 +996,7 @@ static void nsvg__fillActiveEdges(unsigned char* scanline, int len, NSVGactiveEd
 				x0 = e->x; w = 1;
 			} else {
 				int x1 = e->x; w = 0;
-				nsvg__fillScanline(scanline, len, x0, x1, maxWeight, xmin, xmax);
+				nsvg__fillScanline(scanline, len, x0, x1, maxWeight, xmin, xmax, simd);
 			}
 			e = e->next;
 		}
@@ -979,8 +1035,119 @@ static inline int nsvg__div255(int x)
     return ((x+1) * 257) >> 16;
 }
 
+#ifdef NSVG__SSE2
+// nsvg__div255 on 16-bit lanes. x*257 never needs more than 32 bits, so the high half is exact.
+static inline __m128i nsvg__div255SSE2(__m128i x)
+{
+	return _mm_mulhi_epu16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_set1_epi16(257));
+}
+
+// Blends two pixels of 16-bit channels with nsvg__scanlineSolid's arithmetic.
+// rgb1 is the paint color with 255 in place of its alpha, a the coverage alpha of each channel.
+static inline __m128i nsvg__blendSSE2(__m128i d, __m128i a, __m128i rgb1)
+{
+	__m128i ia = _mm_sub_epi16(_mm_set1_epi16(255), a);
+	__m128i src = nsvg__div255SSE2(_mm_mullo_epi16(rgb1, a));
+	// src + div255(ia*dst) is at most a + ia, so no channel saturates when packed.
+	return _mm_add_epi16(src, nsvg__div255SSE2(_mm_mullo_epi16(ia, d)));
+}
+
+// Returns how many pixels were blended; the caller finishes the rest.
+static int nsvg__blendColorSSE2(unsigned char* dst, int count, unsigned char* cover, unsigned int color)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rgb1 = _mm_unpacklo_epi8(_mm_set1_epi32((int)(color | 0xff000000u)), zero);
+	const __m128i ca = _mm_set1_epi16((short)(color >> 24));
+	int i, c;
+
+	for (i = 0; i + 4 <= count; i += 4) {
+		__m128i cov, a, d, lo, hi;
+		memcpy(&c, &cover[i], 4);
+		if (c == 0) continue; // zero coverage leaves the destination as it is
+		cov = _mm_unpacklo_epi8(_mm_cvtsi32_si128(c), zero);
+		a = nsvg__div255SSE2(_mm_mullo_epi16(cov, ca));
+		a = _mm_unpacklo_epi16(a, a); // a0 a0 a1 a1 a2 a2 a3 a3
+		d = _mm_loadu_si128((__m128i*)&dst[i*4]);
+		lo = nsvg__blendSSE2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi32(a, a), rgb1);
+		hi = nsvg__blendSSE2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi32(a, a), rgb1);
+		_mm_storeu_si128((__m128i*)&dst[i*4], _mm_packus_epi16(lo, hi));
+	}
+	return i;
+}
+
+// r,g,b,a as 32-bit lanes. Matches the integer division of nsvg__unpremultiplyAlpha: the quotient is
+// below 65536 and at least 1/255 away from the next integer, so the rounded float quotient truncates the same way.
+static inline __m128i nsvg__unpremultiplySSE2(__m128i p)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaLane = _mm_set_epi32(-1, 0, 0, 0);
+	__m128i a = _mm_shuffle_epi32(p, _MM_SHUFFLE(3,3,3,3));
+	__m128 q = _mm_div_ps(_mm_mul_ps(_mm_cvtepi32_ps(p), _mm_set1_ps(255.0f)), _mm_cvtepi32_ps(a));
+	__m128i u = _mm_and_si128(_mm_cvttps_epi32(q), _mm_set1_epi32(0xff));
+	// Transparent pixels, and alpha itself, are kept.
+	__m128i keep = _mm_or_si128(_mm_cmpeq_epi32(a, zero), alphaLane);
+	return _mm_or_si128(_mm_and_si128(keep, p), _mm_andnot_si128(keep, u));
+}
+
+static int nsvg__unpremultiplyRowSSE2(unsigned char* row, int w)
+{
+	const __m128i zero = _mm_setzero_si128();
+	int x;
+
+	for (x = 0; x + 4 <= w; x += 4) {
+		__m128i p = _mm_loadu_si128((__m128i*)&row[x*4]);
+		__m128i lo = _mm_unpacklo_epi8(p, zero);
+		__m128i hi = _mm_unpackhi_epi8(p, zero);
+		__m128i p0 = nsvg__unpremultiplySSE2(_mm_unpacklo_epi16(lo, zero));
+		__m128i p1 = nsvg__unpremultiplySSE2(_mm_unpackhi_epi16(lo, zero));
+		__m128i p2 = nsvg__unpremultiplySSE2(_mm_unpacklo_epi16(hi, zero));
+		__m128i p3 = nsvg__unpremultiplySSE2(_mm_unpackhi_epi16(hi, zero));
+		p = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+		_mm_storeu_si128((__m128i*)&row[x*4], p);
+	}
+	return x;
+}
+#endif
+
+#ifdef NSVG__AVX2
+NSVG__TARGET_AVX2 static inline __m256i nsvg__div255AVX2(__m256i x)
+{
+	return _mm256_mulhi_epu16(_mm256_add_epi16(x, _mm256_set1_epi16(1)), _mm256_set1_epi16(257));
+}
+
+NSVG__TARGET_AVX2 static inline __m256i nsvg__blendAVX2(__m256i d, __m256i a, __m256i rgb1)
+{
+	__m256i ia = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+	__m256i src = nsvg__div255AVX2(_mm256_mullo_epi16(rgb1, a));
+	return _mm256_add_epi16(src, nsvg__div255AVX2(_mm256_mullo_epi16(ia, d)));
+}
+
+// Eight pixels at a time. The unpacks work within 128-bit lanes, so the low half holds pixels 0-3 and the high half 4-7.
+NSVG__TARGET_AVX2 static int nsvg__blendColorAVX2(unsigned char* dst, int count, unsigned char* cover, unsigned int color)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i rgb1 = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)(color | 0xff000000u)), zero);
+	const __m128i ca = _mm_set1_epi16((short)(color >> 24));
+	int i;
+
+	for (i = 0; i + 8 <= count; i += 8) {
+		__m128i c, a;
+		__m256i a2, d, lo, hi;
+		c = _mm_loadl_epi64((__m128i*)&cover[i]);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_setzero_si128())) == 0xffff) continue;
+		a = nsvg__div255SSE2(_mm_mullo_epi16(_mm_unpacklo_epi8(c, _mm_setzero_si128()), ca));
+		a2 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(a, a)), _mm_unpackhi_epi16(a, a), 1);
+		d = _mm256_loadu_si256((__m256i*)&dst[i*4]);
+		lo = nsvg__blendAVX2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi32(a2, a2), rgb1);
+		hi = nsvg__blendAVX2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi32(a2, a2), rgb1);
+		_mm256_storeu_si256((__m256i*)&dst[i*4], _mm256_packus_epi16(lo, hi));
+	}
+	return i;
+}
+#endif
+
 static void nsvg__scanlineSolid(unsigned char* dst, int count, unsigned char* cover, int x, int y,
-								float tx, float ty, float scale, NSVGcachedPaint* cache)
+								float tx, float ty, float scale, NSVGcachedPaint* cache, int simd)
 {
 
 	if (cache->type == NSVG_PAINT_COLOR) {
@@ -990,7 +1157,21 @@ static void nsvg__scanlineSolid(unsigned char* dst, int count, unsigned char* co
 		cb = (cache->colors[0] >> 16) & 0xff;
 		ca = (cache->colors[0] >> 24) & 0xff;
 
-		for (i = 0; i < count; i++) {
+		i = 0;
+#ifdef NSVG__AVX2
+		if (simd >= NSVG_SIMD_AVX2)
+			i = nsvg__blendColorAVX2(dst, count, cover, cache->colors[0]);
+#endif
+#ifdef NSVG__SSE2
+		if (simd >= NSVG_SIMD_SSE2)
+			i += nsvg__blendColorSSE2(dst + i*4, count - i, cover + i, cache->colors[0]);
+#else
+		(void)simd;
+#endif
+		cover += i;
+		dst += i*4;
+
+		for (; i < count; i++) {
 			int r,g,b;
 			int a = nsvg__div255((int)cover[0] * ca);
 			int ia = 255 - a;
@@ -1183,26 +1364,35 @@ static void nsvg__rasterizeSortedEdges(NSVGrasterizer *r, float tx, float ty, fl
 
 			// now process all active edges in non-zero fashion
 			if (active != NULL)
-				nsvg__fillActiveEdges(r->scanline, r->width, active, maxWeight, &xmin, &xmax, fillRule);
+				nsvg__fillActiveEdges(r->scanline, r->width, active, maxWeight, &xmin, &xmax, fillRule, r->simd);
 		}
 		// Blit
 		if (xmin < 0) xmin = 0;
 		if (xmax > r->width-1) xmax = r->width-1;
 		if (xmin <= xmax) {
-			nsvg__scanlineSolid(&r->bitmap[y * r->stride] + xmin*4, xmax-xmin+1, &r->scanline[xmin], xmin, y, tx,ty, scale, cache);
+			nsvg__scanlineSolid(&r->bitmap[y * r->stride] + xmin*4, xmax-xmin+1, &r->scanline[xmin], xmin, y, tx,ty, scale, cache, r->simd);
 		}
 	}
 
 }
 
-static void nsvg__unpremultiplyAlpha(unsigned char* image, int w, int h, int stride)
+static void nsvg__unpremultiplyAlpha(unsigned char* image, int w, int h, int stride, int simd)
 {
 	int x,y;
 
 	// Unpremultiply
 	for (y = 0; y < h; y++) {
 		unsigned char *row = &image[y*stride];
-		for (x = 0; x < w; x++) {
+		x = 0;
+#ifdef NSVG__SSE2
+		if (simd >= NSVG_SIMD_SSE2) {
+			x = nsvg__unpremultiplyRowSSE2(row, w);
+			row += x*4;
+		}
+#else
+		(void)simd;
+#endif
+		for (; x < w; x++) {
 			int r = row[0], g = row[1], b = row[2], a = row[3];
 			if (a != 0) {
 				row[0] = (unsigned char)(r*255/a);
@@ -1436,7 +1626,7 @@ void nsvgRasterize(NSVGrasterizer* r,
 		}
 	}
 
-	nsvg__unpremultiplyAlpha(dst, w, h, stride);
+	nsvg__unpremultiplyAlpha(dst, w, h, stride, r->simd);
 
 	r->bitmap = NULL;
 	r->width = 0;
@@ -0,0 +1,105 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "animation.h"
+#include "main.h"
+
+
+#define ANIMATION_DURATION_MS (150)
+
+
+ANIMATION animationPool[ANIMATION_POOL_SIZE];
+
+
+bool Animation_Init(void)
+{
+    memset(animationPool, 0, sizeof(animationPool));
+
+    return true;
+}
+
+
+void Animation_Logic(uint32_t currentTick)
+{
+    // Retire finished animations.
+    for (int i = 0; i < ANIMATION_POOL_SIZE; i++)
+    {
+        ANIMATION *animation = &animationPool[i];
+        if (animation->active && (currentTick - animation->startTick) >= animation->durationTicks)
+            animation->active = false;
+    }
+}
+
+
+void Animation_Quit(void)
+{
+}
+
+
+bool Animation_Start(ANIMATION_KIND kind, GAME_PIECE piece, int fromRank, int fromFile, int toRank, int toFile, uint32_t currentTick)
+{
+    for (int i = 0; i < ANIMATION_POOL_SIZE; i++)
+    {
+        ANIMATION *animation = &animationPool[i];
+        if (animation->active)
+            continue;
+
+        uint32_t durationTicks = (ANIMATION_DURATION_MS * ticksPerSecond) / 1000;
+        if (durationTicks == 0)
+            durationTicks = 1;
+
+        animation->active = true;
+        animation->kind = kind;
+        animation->piece = piece;
+        animation->fromRank = fromRank;
+        animation->fromFile = fromFile;
+        animation->toRank = toRank;
+        animation->toFile = toFile;
+        animation->startTick = currentTick;
+        animation->durationTicks = durationTicks;
+
+        return true;
+    }
+
+    return false;
+}
+
+
+void Animation_SkipAll(void)
+{
+    for (int i = 0; i < ANIMATION_POOL_SIZE; i++)
+        animationPool[i].active = false;
+}
+
+
+float Animation_Progress(const ANIMATION *animation, uint32_t drawnTick, double interpolation)
+{
+    double elapsed = (drawnTick - animation->startTick) + interpolation;
+    double t = elapsed / animation->durationTicks;
+
+    if (t <= 0.0)
+        return 0.0f;
+    if (t >= 1.0)
+        return 1.0f;
+
+    // Smoothstep easing.
+    return (float)(t * t * (3.0 - (2.0 * t)));
+}
@@ -0,0 +1,64 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "game.h"
+
+
+// Animations live in a fixed pool. Starting one never allocates.
+#define ANIMATION_POOL_SIZE (8)
+
+typedef enum {
+    // A piece sliding from one square to another.
+    ANIMATION_MOVE,
+    // A captured piece fading out on the square it was taken on.
+    ANIMATION_CAPTURE
+} ANIMATION_KIND;
+
+typedef struct {
+    bool active;
+    ANIMATION_KIND kind;
+    GAME_PIECE piece;
+    int fromRank;
+    int fromFile;
+    int toRank;
+    int toFile;
+    uint32_t startTick;
+    uint32_t durationTicks;
+} ANIMATION;
+
+// The animation pool. Owned by the game logic.
+extern ANIMATION animationPool[ANIMATION_POOL_SIZE];
+
+bool Animation_Init(void);
+void Animation_Logic(uint32_t currentTick);
+void Animation_Quit(void);
+
+// Returns false if the pool is full, in which case the piece simply appears at its destination.
+bool Animation_Start(ANIMATION_KIND kind, GAME_PIECE piece, int fromRank, int fromFile, int toRank, int toFile, uint32_t currentTick);
+
+// Finish every running animation immediately.
+void Animation_SkipAll(void);
+
+// Eased progress of an animation in [0, 1], given the tick being drawn and the render interpolation.
+float Animation_Progress(const ANIMATION *animation, uint32_t drawnTick, double interpolation);
@@ -0,0 +1,144 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "arena.h"
+#include "logger.h"
+#include "memtrack.h"
+#include "SDL.h"
+
+
+ARENA logicArena;
+ARENA renderArena;
+
+
+// Owns the scratch arena of a thread and destroys it when the thread exits.
+struct ThreadArena
+{
+    ARENA arena = {};
+    bool created = false;
+
+    ~ThreadArena()
+    {
+        if (created)
+            Arena_Destroy(&arena);
+    }
+};
+
+static thread_local ThreadArena threadArena;
+
+
+bool Arena_Create(ARENA *arena, size_t capacity)
+{
+    SDL_zerop(arena);
+
+    arena->base = (uint8_t*)Memory_Allocate(capacity);
+    if (arena->base == NULL)
+        return false;
+
+    arena->capacity = capacity;
+    return true;
+}
+
+
+void Arena_Destroy(ARENA *arena)
+{
+    Memory_Free(arena->base);
+    SDL_zerop(arena);
+}
+
+
+// Where the next allocation starts.
+static size_t NextOffset(const ARENA *arena)
+{
+    return (arena->used + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+
+void* Arena_Allocate(ARENA *arena, size_t size)
+{
+    size_t start = NextOffset(arena);
+    if (start > arena->capacity || size > arena->capacity - start)
+    {
+        arena->failedAllocations++;
+        return NULL;
+    }
+
+    arena->used = start + size;
+    if (arena->used > arena->highWater)
+        arena->highWater = arena->used;
+
+    return arena->base + start;
+}
+
+
+void Arena_Reset(ARENA *arena)
+{
+    arena->used = 0;
+}
+
+
+size_t Arena_Mark(const ARENA *arena)
+{
+    return arena->used;
+}
+
+
+void Arena_Release(ARENA *arena, size_t mark)
+{
+    if (mark < arena->used)
+        arena->used = mark;
+}
+
+
+ARENA* Arena_Thread(void)
+{
+    if (!threadArena.created)
+        threadArena.created = Arena_Create(&threadArena.arena, THREAD_ARENA_SIZE);
+
+    return threadArena.created ? &threadArena.arena : NULL;
+}
+
+
+bool Arena_Init(void)
+{
+    if (!Arena_Create(&logicArena, LOGIC_ARENA_SIZE))
+        return false;
+
+    if (!Arena_Create(&renderArena, RENDER_ARENA_SIZE))
+        return false;
+
+    return true;
+}
+
+
+void Arena_Quit(void)
+{
+    Arena_LogStatistics(&logicArena, "Logic");
+    Arena_LogStatistics(&renderArena, "Render");
+
+    Arena_Destroy(&logicArena);
+    Arena_Destroy(&renderArena);
+}
+
+
+void Arena_LogStatistics(const ARENA *arena, const char *name)
+{
+    LOG_INFO(LOG_CATEGORY_MAIN, "%s arena: high water %zu of %zu bytes, %u failed allocations", name, arena->highWater, arena->capacity, arena->failedAllocations);
+}
@@ -0,0 +1,78 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define ARENA_ALIGNMENT (16)
+
+#define LOGIC_ARENA_SIZE (256 * 1024)
+#define RENDER_ARENA_SIZE (256 * 1024)
+#define THREAD_ARENA_SIZE (64 * 1024)
+
+
+// Bump allocator for scratch data that lives until the next reset.
+// Allocations are never freed individually; Arena_Reset releases all of them at once.
+// An arena is not thread safe; each thread uses its own.
+typedef struct
+{
+    uint8_t *base;
+    size_t capacity;
+    size_t used;
+
+    // The most the arena has held since it was created.
+    size_t highWater;
+    // Allocations refused because the arena was full.
+    uint32_t failedAllocations;
+} ARENA;
+
+
+// Scratch for DoLogic, reset at the start of every logic tick.
+extern ARENA logicArena;
+// Scratch for DoRender, reset at the start of every frame.
+extern ARENA renderArena;
+
+
+bool Arena_Create(ARENA *arena, size_t capacity);
+void Arena_Destroy(ARENA *arena);
+
+// Returns NULL when the arena is full. The heap is never used as a fallback.
+void* Arena_Allocate(ARENA *arena, size_t size);
+#define ARENA_NEW(arena, type) ((type*)Arena_Allocate((arena), sizeof(type)))
+#define ARENA_ARRAY(arena, type, count) ((type*)Arena_Allocate((arena), sizeof(type) * (count)))
+
+void Arena_Reset(ARENA *arena);
+
+// Release everything allocated after the mark was taken.
+size_t Arena_Mark(const ARENA *arena);
+void Arena_Release(ARENA *arena, size_t mark);
+
+// Scratch arena of the calling thread, for worker jobs. Created on first use and destroyed with the thread.
+// Returns NULL if it could not be created.
+ARENA* Arena_Thread(void);
+
+bool Arena_Init(void);
+void Arena_Quit(void);
+
+void Arena_LogStatistics(const ARENA *arena, const char *name);
@@ -93,6 +93,7 @@ const char *objMaterialPaths[] =
 
 
 struct NSVGimage **svgAssets;
+uint64_t svgAssetHash;
 
 std::vector<tinyobj::attrib_t> *objAttributes;
 std::vector<std::vector<tinyobj::shape_t>> *objShapes;
@@ -113,11 +114,25 @@ void ReadLinesAndCopy(std::shared_ptr<ZipArchiveEntry> archiveEntry, char **dest
 }
 
 
+// 64-bit FNV-1a, continued from a previous hash.
+static uint64_t HashText(uint64_t hash, const char *text)
+{
+    for (; *text != '\0'; text++)
+    {
+        hash ^= (unsigned char)*text;
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+
 bool LoadSVGAssets(std::shared_ptr<ZipArchive> archive)
 {
     char *currentText = NULL;
 
     svgAssets = (NSVGimage**)malloc(SVG_ASSET_COUNT * sizeof(NSVGimage*));
+    svgAssetHash = 0xcbf29ce484222325ULL;
 
     // Load SVGs
     for (int i = 0; i < SVG_ASSET_PATH_COUNT; i++)
@@ -126,6 +141,8 @@ bool LoadSVGAssets(std::shared_ptr<ZipArchive> archive)
         if (archiveEntry == nullptr)
             return false;
         ReadLinesAndCopy(archiveEntry, &currentText);
+        // Hash before parsing; nanosvg modifies the text.
+        svgAssetHash = HashText(svgAssetHash, currentText);
         svgAssets[i] = nsvgParse(currentText, "px", 96);
         delete(currentText);
     }
@@ -21,6 +21,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "nanosvg.h"
 #include "tiny_obj_loader.h"
@@ -42,6 +43,10 @@ typedef enum SVGAssetIndex
     SVG_ASSET_COUNT
 } SVGAssetIndex;
 extern struct NSVGimage **svgAssets;
+// Archive paths of the SVG assets, by SVGAssetIndex.
+extern const char *svgAssetPaths[];
+// Hash of the source of every SVG asset. Changes whenever any of the drawings do.
+extern uint64_t svgAssetHash;
 
 typedef enum OBJAssetAttribIndex
 {
@@ -55,6 +60,8 @@ typedef enum OBJAssetAttribIndex
     OBJ_ASSET_ATTRIB_COUNT
 } OBJAssetAttribIndex;
 extern std::vector<tinyobj::attrib_t> *objAttributes;
+// Archive paths of the OBJ assets, by OBJAssetShapeIndex.
+extern const char *objAssetPaths[];
 
 typedef enum OBJAssetShapeIndex
 {
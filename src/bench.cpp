@@ -0,0 +1,1171 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "arena.h"
+#include "asset.h"
+#include "bench.h"
+#include "camera.h"
+#include "game.h"
+#include "list.h"
+#include "logger.h"
+#include "main.h"
+#include "memtrack.h"
+#include "meshraster.h"
+#include "mipchain.h"
+#include "queue.h"
+#include "raster.h"
+#include "render.h"
+#include "renderbackend.h"
+#include "snapshot.h"
+#include "util.h"
+#include "SDL.h"
+#include "ZipFile.h"
+#include "nanosvgrast.h"
+
+
+#define LIST_BENCH_ITEMS (1000)
+#define LIST_BENCH_ROUNDS (2000)
+#define LIST_TRAVERSE_ITEMS (20000)
+#define LIST_TRAVERSE_ROUNDS (200)
+#define LIST_INDEX_ITEMS (1000)
+#define LIST_INDEX_LOOKUPS (200000)
+#define LIST_QUEUE_ITEMS (64)
+#define LIST_QUEUE_OPERATIONS (2000000)
+#define QUEUE_BENCH_CAPACITY (1024)
+#define QUEUE_BENCH_ITEMS_PER_PRODUCER (200000)
+#define QUEUE_BENCH_MAX_PRODUCERS (8)
+#define QUEUE_BENCH_BATCH (64)
+
+#define EVENT_BENCH_FRAMES (20000)
+#define EVENT_BENCH_EVENTS_PER_FRAME (16)
+#define BOARD_BENCH_REFRESHES (100000)
+#define MODEL_BENCH_ROUNDS (20)
+#define SVG_PARSE_ROUNDS (200)
+#define SVG_RASTERIZE_ROUNDS (10)
+#define SVG_SIMD_ROUNDS (10)
+#define OBJ_LOAD_ROUNDS (5)
+#define ATLAS_BENCH_SIZE (180)
+#define ATLAS_BENCH_ROUNDS (10)
+#define MIP_BENCH_ROUNDS (5)
+// Resampled pieces must stay this close to a supersampled rasterization, in dB of PSNR over premultiplied RGBA.
+#define MIP_BENCH_MIN_PSNR (30.0)
+#define MIP_BENCH_SUPERSAMPLING (4)
+#define DRAW_BENCH_FRAMES (200)
+
+#define BENCH_MAX_RESULTS (128)
+
+
+// Measures one benchmark: elapsed time and the allocations made while it ran.
+typedef struct
+{
+    uint64_t start;
+} BENCH_TIMER;
+
+typedef struct
+{
+    const char *name;
+    double nanosecondsPerOperation;
+    uint32_t allocations;
+} BENCH_RESULT;
+
+typedef bool (*BenchFunction)(void);
+
+typedef struct
+{
+    const char *name;
+    BenchFunction function;
+} BENCHMARK;
+
+
+// Keeps the compiler from optimizing away results nothing else reads.
+static volatile uintptr_t benchSink;
+
+static BENCH_RESULT results[BENCH_MAX_RESULTS];
+static int resultCount = 0;
+
+
+static void StartTimer(BENCH_TIMER *timer)
+{
+    MEMORY_FRAME_STATS discarded;
+    Memory_EndFrame(&discarded);
+
+    timer->start = SDL_GetPerformanceCounter();
+}
+
+
+static void StopTimer(const BENCH_TIMER *timer, const char *name, uint64_t operations)
+{
+    uint64_t elapsed = SDL_GetPerformanceCounter() - timer->start;
+
+    MEMORY_FRAME_STATS memory;
+    Memory_EndFrame(&memory);
+
+    double nanoseconds = (elapsed * 1e9) / SDL_GetPerformanceFrequency();
+    LOG_INFO(LOG_CATEGORY_MAIN, "%-36s %12.2f ns/op %12.0f op/s %10u allocations",
+        name, nanoseconds / operations, operations / (nanoseconds / 1e9), memory.totalAllocations);
+
+    if (resultCount < BENCH_MAX_RESULTS)
+    {
+        results[resultCount].name = name;
+        results[resultCount].nanosecondsPerOperation = nanoseconds / operations;
+        results[resultCount].allocations = memory.totalAllocations;
+        resultCount++;
+    }
+}
+
+
+// The list as it was before node pooling: one heap allocation per node.
+// Kept as the reference the pooled list is measured against.
+typedef struct HeapNode
+{
+    void *item;
+    struct HeapNode *next;
+    struct HeapNode *previous;
+} HeapNode;
+
+typedef struct
+{
+    HeapNode *head;
+    HeapNode *tail;
+} HeapList;
+
+
+static void HeapList_AddLast(HeapList *list, void *item)
+{
+    HeapNode *node = (HeapNode*)Memory_Allocate(sizeof(HeapNode));
+    node->item = item;
+    node->next = NULL;
+    node->previous = list->tail;
+
+    if (list->tail == NULL)
+        list->head = node;
+    else
+        list->tail->next = node;
+    list->tail = node;
+}
+
+
+static void HeapList_Clear(HeapList *list)
+{
+    HeapNode *node = list->head;
+    while (node != NULL)
+    {
+        HeapNode *next = node->next;
+        Memory_Free(node);
+        node = next;
+    }
+
+    list->head = NULL;
+    list->tail = NULL;
+}
+
+
+// Fill, walk and clear a list, like the event buffer every tick.
+static bool BenchListAppendIterate(void)
+{
+    BENCH_TIMER timer;
+    uintptr_t sum = 0;
+
+    HeapList heapList = {};
+    StartTimer(&timer);
+    for (int round = 0; round < LIST_BENCH_ROUNDS; round++)
+    {
+        for (uintptr_t i = 0; i < LIST_BENCH_ITEMS; i++)
+            HeapList_AddLast(&heapList, (void*)i);
+
+        for (HeapNode *node = heapList.head; node != NULL; node = node->next)
+            sum += (uintptr_t)node->item;
+
+        HeapList_Clear(&heapList);
+    }
+    StopTimer(&timer, "list/heap/append_iterate_clear", (uint64_t)LIST_BENCH_ROUNDS * LIST_BENCH_ITEMS);
+
+    void *list = List_Create();
+    StartTimer(&timer);
+    for (int round = 0; round < LIST_BENCH_ROUNDS; round++)
+    {
+        for (uintptr_t i = 0; i < LIST_BENCH_ITEMS; i++)
+            List_AddLast(list, (void*)i);
+
+        LIST_ITERATOR iteratorStorage;
+        void *iterator = List_IteratorInit(&iteratorStorage, list);
+        void *item;
+        while (List_IteratorNext(iterator, &item))
+            sum -= (uintptr_t)item;
+
+        List_Clear(list, NULL);
+    }
+    StopTimer(&timer, "list/pooled/append_iterate_clear", (uint64_t)LIST_BENCH_ROUNDS * LIST_BENCH_ITEMS);
+    List_Destroy(list, NULL);
+
+    benchSink = sum;
+
+    // Both lists saw the same items, so the sums cancel out.
+    return sum == 0;
+}
+
+
+// Walk long lists whose nodes were allocated between other allocations, as in a long running game.
+static bool BenchListTraverse(void)
+{
+    BENCH_TIMER timer;
+    uintptr_t heapSum = 0;
+    uintptr_t pooledSum = 0;
+
+    HeapList heapList = {};
+    void *list = List_Create();
+    void *noise[LIST_TRAVERSE_ITEMS];
+    for (uintptr_t i = 0; i < LIST_TRAVERSE_ITEMS; i++)
+    {
+        HeapList_AddLast(&heapList, (void*)i);
+        List_AddLast(list, (void*)i);
+        noise[i] = Memory_Allocate(16 + (i % 7) * 16);
+    }
+    for (uintptr_t i = 0; i < LIST_TRAVERSE_ITEMS; i++)
+        Memory_Free(noise[i]);
+
+    StartTimer(&timer);
+    for (int round = 0; round < LIST_TRAVERSE_ROUNDS; round++)
+    {
+        for (HeapNode *node = heapList.head; node != NULL; node = node->next)
+            heapSum += (uintptr_t)node->item;
+    }
+    StopTimer(&timer, "list/heap/traverse", (uint64_t)LIST_TRAVERSE_ROUNDS * LIST_TRAVERSE_ITEMS);
+
+    StartTimer(&timer);
+    for (int round = 0; round < LIST_TRAVERSE_ROUNDS; round++)
+    {
+        LIST_ITERATOR iteratorStorage;
+        void *iterator = List_IteratorInit(&iteratorStorage, list);
+        void *item;
+        while (List_IteratorNext(iterator, &item))
+            pooledSum += (uintptr_t)item;
+    }
+    StopTimer(&timer, "list/pooled/traverse", (uint64_t)LIST_TRAVERSE_ROUNDS * LIST_TRAVERSE_ITEMS);
+
+    HeapList_Clear(&heapList);
+    List_Destroy(list, NULL);
+
+    benchSink = heapSum;
+
+    return heapSum == pooledSum;
+}
+
+
+// Compare the linked and array list kinds on the operations that distinguish them.
+static bool BenchListKinds(void)
+{
+    static const LIST_KIND kinds[] = { LIST_KIND_LINKED, LIST_KIND_ARRAY };
+    static const char *appendNames[] = { "list/linked/append_iterate_clear", "list/array/append_iterate_clear" };
+    static const char *indexNames[] = { "list/linked/indexed_get", "list/array/indexed_get" };
+    static const char *queueNames[] = { "list/linked/queue", "list/array/queue" };
+
+    BENCH_TIMER timer;
+    uintptr_t sums[SDL_arraysize(kinds)] = {};
+
+    for (size_t k = 0; k < SDL_arraysize(kinds); k++)
+    {
+        void *list = List_CreateWithKind(kinds[k]);
+        void *item;
+
+        StartTimer(&timer);
+        for (int round = 0; round < LIST_BENCH_ROUNDS; round++)
+        {
+            for (uintptr_t i = 0; i < LIST_BENCH_ITEMS; i++)
+                List_AddLast(list, (void*)i);
+
+            LIST_ITERATOR iteratorStorage;
+            void *iterator = List_IteratorInit(&iteratorStorage, list);
+            while (List_IteratorNext(iterator, &item))
+                sums[k] += (uintptr_t)item;
+
+            List_Clear(list, NULL);
+        }
+        StopTimer(&timer, appendNames[k], (uint64_t)LIST_BENCH_ROUNDS * LIST_BENCH_ITEMS);
+
+        for (uintptr_t i = 0; i < LIST_INDEX_ITEMS; i++)
+            List_AddLast(list, (void*)i);
+
+        // A fixed stride visits every index without a random number generator in the loop.
+        StartTimer(&timer);
+        size_t index = 0;
+        for (int i = 0; i < LIST_INDEX_LOOKUPS; i++)
+        {
+            List_Get(list, index, &item);
+            sums[k] += (uintptr_t)item;
+            index = (index + 397) % LIST_INDEX_ITEMS;
+        }
+        StopTimer(&timer, indexNames[k], LIST_INDEX_LOOKUPS);
+
+        List_Clear(list, NULL);
+        for (uintptr_t i = 0; i < LIST_QUEUE_ITEMS; i++)
+            List_AddLast(list, (void*)i);
+
+        // First in, first out at a steady length, like a message queue.
+        StartTimer(&timer);
+        for (int i = 0; i < LIST_QUEUE_OPERATIONS; i++)
+        {
+            List_RemoveFirst(list, &item);
+            sums[k] += (uintptr_t)item;
+            List_AddLast(list, item);
+        }
+        StopTimer(&timer, queueNames[k], LIST_QUEUE_OPERATIONS);
+
+        List_Destroy(list, NULL);
+    }
+
+    benchSink = sums[0];
+
+    return sums[0] == sums[1];
+}
+
+
+typedef struct
+{
+    void *queue;
+    uintptr_t producer;
+} QUEUE_PRODUCER;
+
+
+// Push a numbered sequence of items, tagged with the producer, so the consumer can check their order.
+static int SDLCALL QueueProducer(void *data)
+{
+    QUEUE_PRODUCER *producer = (QUEUE_PRODUCER*)data;
+
+    for (uintptr_t i = 1; i <= QUEUE_BENCH_ITEMS_PER_PRODUCER; i++)
+        Queue_Push(producer->queue, (void*)((producer->producer << 24) | i));
+
+    return 0;
+}
+
+
+// Stress the MPSC queue with 1 to N producers and a consumer draining in batches.
+// Fails if an item is lost, duplicated, or arrives out of its producer's order.
+static bool BenchQueue(void)
+{
+    static const char *names[] = { "queue/mpsc/1_producer", "queue/mpsc/2_producers", "queue/mpsc/4_producers", "queue/mpsc/8_producers" };
+
+    bool success = true;
+    int cpuCount = SDL_GetCPUCount();
+
+    for (int n = 0, producerCount = 1; producerCount <= QUEUE_BENCH_MAX_PRODUCERS; n++, producerCount *= 2)
+    {
+        // Always run a single producer, but don't oversubscribe the machine beyond that.
+        if (producerCount > 1 && producerCount >= cpuCount)
+            break;
+
+        void *queue = Queue_Create(QUEUE_BENCH_CAPACITY);
+        QUEUE_PRODUCER producers[QUEUE_BENCH_MAX_PRODUCERS];
+        SDL_Thread *threads[QUEUE_BENCH_MAX_PRODUCERS];
+        uintptr_t lastSequence[QUEUE_BENCH_MAX_PRODUCERS] = {};
+
+        BENCH_TIMER timer;
+        StartTimer(&timer);
+
+        for (int i = 0; i < producerCount; i++)
+        {
+            producers[i].queue = queue;
+            producers[i].producer = i;
+            threads[i] = SDL_CreateThread(QueueProducer, "producer", &producers[i]);
+        }
+
+        uint64_t expected = (uint64_t)producerCount * QUEUE_BENCH_ITEMS_PER_PRODUCER;
+        uint64_t received = 0;
+        void *items[QUEUE_BENCH_BATCH];
+        while (received < expected)
+        {
+            size_t drained = Queue_Drain(queue, items, QUEUE_BENCH_BATCH);
+            for (size_t i = 0; i < drained; i++)
+            {
+                uintptr_t producer = (uintptr_t)items[i] >> 24;
+                uintptr_t sequence = (uintptr_t)items[i] & 0xFFFFFF;
+
+                if (producer >= (uintptr_t)producerCount || sequence != lastSequence[producer] + 1)
+                    success = false;
+                else
+                    lastSequence[producer] = sequence;
+            }
+            received += drained;
+        }
+
+        for (int i = 0; i < producerCount; i++)
+            SDL_WaitThread(threads[i], NULL);
+
+        StopTimer(&timer, names[n], expected);
+
+        QUEUE_STATISTICS statistics;
+        Queue_GetStatistics(queue, &statistics);
+        LOG_INFO(LOG_CATEGORY_MAIN, "  pushed %u, popped %u, contended retries %u, blocked pushes %u",
+            statistics.pushed, statistics.popped, statistics.contendedRetries, statistics.blockedPushes);
+
+        // Nothing may be left over.
+        void *leftover;
+        if (Queue_TryPop(queue, &leftover))
+            success = false;
+
+        Queue_Destroy(queue, NULL);
+    }
+
+    return success;
+}
+
+
+// Per frame: buffer a frame's worth of events, let the camera and render logic walk them, then release them.
+static bool BenchEventPipeline(void)
+{
+    ARENA eventArena;
+    if (!Arena_Create(&eventArena, EVENT_BENCH_EVENTS_PER_FRAME * sizeof(BUFFERED_EVENT) * 2))
+        return false;
+
+    void *eventBuffer = List_Create();
+    uintptr_t sum = 0;
+
+    BENCH_TIMER timer;
+    StartTimer(&timer);
+    for (int frame = 0; frame < EVENT_BENCH_FRAMES; frame++)
+    {
+        for (int i = 0; i < EVENT_BENCH_EVENTS_PER_FRAME; i++)
+        {
+            BUFFERED_EVENT *bufferedEvent = ARENA_NEW(&eventArena, BUFFERED_EVENT);
+            SDL_zerop(bufferedEvent);
+            bufferedEvent->event.type = SDL_MOUSEMOTION;
+            bufferedEvent->event.motion.x = i;
+            bufferedEvent->arrivalTime = frame;
+            List_AddLast(eventBuffer, bufferedEvent);
+        }
+
+        for (int pass = 0; pass < 2; pass++)
+        {
+            LIST_ITERATOR iteratorStorage;
+            void *iterator = List_IteratorInit(&iteratorStorage, eventBuffer);
+            BUFFERED_EVENT *bufferedEvent;
+            while (List_IteratorNext(iterator, (void**)&bufferedEvent))
+                sum += bufferedEvent->event.motion.x;
+        }
+
+        List_Clear(eventBuffer, NULL);
+        Arena_Reset(&eventArena);
+    }
+    StopTimer(&timer, "events/pipeline_frame", EVENT_BENCH_FRAMES);
+
+    List_Destroy(eventBuffer, NULL);
+    Arena_Destroy(&eventArena);
+
+    benchSink = sum;
+
+    return sum == (uintptr_t)EVENT_BENCH_FRAMES * 2 * (EVENT_BENCH_EVENTS_PER_FRAME * (EVENT_BENCH_EVENTS_PER_FRAME - 1) / 2);
+}
+
+
+static bool BenchRefreshBoardState(void)
+{
+    BENCH_TIMER timer;
+    StartTimer(&timer);
+    for (int i = 0; i < BOARD_BENCH_REFRESHES; i++)
+        refreshBoardState(&currentPosition);
+    StopTimer(&timer, "game/refresh_board_state", BOARD_BENCH_REFRESHES);
+
+    // The starting position has a white king on e1.
+    return boardState.pieces[0][4] == PIECE_KING;
+}
+
+
+static bool BenchBoundingBoxes(void)
+{
+    static const char *names[OBJ_ASSET_SHAPE_COUNT] =
+    {
+        "model/bounding_box/pawn",
+        "model/bounding_box/rook",
+        "model/bounding_box/knight",
+        "model/bounding_box/bishop",
+        "model/bounding_box/queen",
+        "model/bounding_box/king",
+        "model/bounding_box/board"
+    };
+
+    bool success = true;
+
+    for (int model = 0; model < OBJ_ASSET_SHAPE_COUNT; model++)
+    {
+        BENCH_TIMER timer;
+        StartTimer(&timer);
+        for (int round = 0; round < MODEL_BENCH_ROUNDS; round++)
+        {
+            std::vector<glm::mat4x3> *boxes = Util_FindBoundingBox(objAttributes->at(model), objShapes->at(model));
+            if (boxes == NULL || boxes->empty())
+                success = false;
+            delete boxes;
+        }
+        StopTimer(&timer, names[model], MODEL_BENCH_ROUNDS);
+    }
+
+    return success;
+}
+
+
+// Read an archive entry into a string.
+static std::string ReadEntry(ZipArchive::Ptr archive, const char *path)
+{
+    ZipArchiveEntry::Ptr archiveEntry = archive->GetEntry(path);
+    if (archiveEntry == nullptr)
+        return std::string();
+
+    std::istream *decompressionStream = archiveEntry->GetDecompressionStream();
+    std::string text(std::istreambuf_iterator<char>(*decompressionStream), {});
+    archiveEntry->CloseDecompressionStream();
+
+    return text;
+}
+
+
+// nsvgParse parses in place, so every round parses a fresh copy of the text.
+static bool BenchSVGParse(void)
+{
+    static const char *names[SVG_ASSET_COUNT] =
+    {
+        "svg/parse/pawn_dark",
+        "svg/parse/rook_dark",
+        "svg/parse/knight_dark",
+        "svg/parse/bishop_dark",
+        "svg/parse/queen_dark",
+        "svg/parse/king_dark",
+        "svg/parse/pawn_light",
+        "svg/parse/rook_light",
+        "svg/parse/knight_light",
+        "svg/parse/bishop_light",
+        "svg/parse/queen_light",
+        "svg/parse/king_light"
+    };
+
+    ZipArchive::Ptr archive = ZipFile::Open("assets");
+    bool success = true;
+
+    for (int piece = 0; piece < SVG_ASSET_COUNT; piece++)
+    {
+        std::string text = ReadEntry(archive, svgAssetPaths[piece]);
+        std::vector<char> copy(text.length() + 1);
+
+        BENCH_TIMER timer;
+        StartTimer(&timer);
+        for (int round = 0; round < SVG_PARSE_ROUNDS; round++)
+        {
+            memcpy(copy.data(), text.c_str(), text.length() + 1);
+            NSVGimage *image = nsvgParse(copy.data(), "px", 96);
+            if (image == NULL || image->shapes == NULL)
+                success = false;
+            nsvgDelete(image);
+        }
+        StopTimer(&timer, names[piece], SVG_PARSE_ROUNDS);
+    }
+
+    return success;
+}
+
+
+// Rasterize all twelve pieces at board square sizes from the smallest window to a large display.
+static bool BenchSVGRasterize(void)
+{
+    static const int sizes[] = { 45, 90, 180, 360 };
+    static const char *names[] =
+    {
+        "svg/rasterize/45px",
+        "svg/rasterize/90px",
+        "svg/rasterize/180px",
+        "svg/rasterize/360px"
+    };
+
+    NSVGrasterizer *rasterizer = nsvgCreateRasterizer();
+    if (rasterizer == NULL)
+        return false;
+    nsvgSetRasterizerSIMD(rasterizer, Raster_SIMDLevel());
+
+    bool success = true;
+
+    for (size_t s = 0; s < SDL_arraysize(sizes); s++)
+    {
+        int size = sizes[s];
+        std::vector<unsigned char> pixels(size * size * 4);
+
+        BENCH_TIMER timer;
+        StartTimer(&timer);
+        for (int round = 0; round < SVG_RASTERIZE_ROUNDS; round++)
+        {
+            for (int piece = 0; piece < SVG_ASSET_COUNT; piece++)
+            {
+                float scale = size / svgAssets[piece]->width;
+                nsvgRasterize(rasterizer, svgAssets[piece], 0, 0, scale, pixels.data(), size, size, size * 4);
+            }
+        }
+        StopTimer(&timer, names[s], SVG_RASTERIZE_ROUNDS * SVG_ASSET_COUNT);
+
+        // Something must have been drawn in the middle of the last piece.
+        if (pixels[((size / 2) * size + size / 2) * 4 + 3] == 0)
+            success = false;
+    }
+
+    nsvgDeleteRasterizer(rasterizer);
+
+    return success;
+}
+
+
+// Internal function.
+// Average nanoseconds to rasterize one piece, leaving the last result in pixels.
+static double TimeRasterize(NSVGrasterizer *rasterizer, NSVGimage *image, int size, unsigned char *pixels)
+{
+    float scale = size / image->width;
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    for (int round = 0; round < SVG_SIMD_ROUNDS; round++)
+        nsvgRasterize(rasterizer, image, 0, 0, scale, pixels, size, size, size * 4);
+    uint64_t elapsed = SDL_GetPerformanceCounter() - start;
+
+    return (elapsed * 1e9) / SDL_GetPerformanceFrequency() / SVG_SIMD_ROUNDS;
+}
+
+
+// Scalar and SIMD kernels side by side for every piece and size. The scalar images are the golden
+// reference: the SIMD kernels are exact, so a single differing byte fails the benchmark.
+static bool BenchSVGRasterizeSIMD(void)
+{
+    static const int sizes[] = { 45, 90, 180, 360 };
+    static const char *names[][2] =
+    {
+        { "svg/rasterize_simd/45px/scalar", "svg/rasterize_simd/45px/simd" },
+        { "svg/rasterize_simd/90px/scalar", "svg/rasterize_simd/90px/simd" },
+        { "svg/rasterize_simd/180px/scalar", "svg/rasterize_simd/180px/simd" },
+        { "svg/rasterize_simd/360px/scalar", "svg/rasterize_simd/360px/simd" }
+    };
+    static const char *pieceNames[SVG_ASSET_COUNT] =
+    {
+        "pawn_dark",
+        "rook_dark",
+        "knight_dark",
+        "bishop_dark",
+        "queen_dark",
+        "king_dark",
+        "pawn_light",
+        "rook_light",
+        "knight_light",
+        "bishop_light",
+        "queen_light",
+        "king_light"
+    };
+
+    NSVGrasterizer *scalar = nsvgCreateRasterizer();
+    NSVGrasterizer *simd = nsvgCreateRasterizer();
+    bool success = scalar != NULL && simd != NULL;
+
+    if (success)
+    {
+        nsvgSetRasterizerSIMD(simd, Raster_SIMDLevel());
+        LOG_INFO(LOG_CATEGORY_MAIN, "  SIMD level %d", Raster_SIMDLevel());
+    }
+
+    for (size_t s = 0; success && s < SDL_arraysize(sizes); s++)
+    {
+        int size = sizes[s];
+        std::vector<unsigned char> golden(size * size * 4);
+        std::vector<unsigned char> pixels(size * size * 4);
+
+        BENCH_TIMER timer;
+        StartTimer(&timer);
+        for (int round = 0; round < SVG_SIMD_ROUNDS; round++)
+        {
+            for (int piece = 0; piece < SVG_ASSET_COUNT; piece++)
+                nsvgRasterize(scalar, svgAssets[piece], 0, 0, size / svgAssets[piece]->width, golden.data(), size, size, size * 4);
+        }
+        StopTimer(&timer, names[s][0], SVG_SIMD_ROUNDS * SVG_ASSET_COUNT);
+
+        StartTimer(&timer);
+        for (int round = 0; round < SVG_SIMD_ROUNDS; round++)
+        {
+            for (int piece = 0; piece < SVG_ASSET_COUNT; piece++)
+                nsvgRasterize(simd, svgAssets[piece], 0, 0, size / svgAssets[piece]->width, pixels.data(), size, size, size * 4);
+        }
+        StopTimer(&timer, names[s][1], SVG_SIMD_ROUNDS * SVG_ASSET_COUNT);
+
+        for (int piece = 0; piece < SVG_ASSET_COUNT; piece++)
+        {
+            double scalarTime = TimeRasterize(scalar, svgAssets[piece], size, golden.data());
+            double simdTime = TimeRasterize(simd, svgAssets[piece], size, pixels.data());
+            bool same = golden == pixels;
+
+            LOG_INFO(LOG_CATEGORY_MAIN, "  %-12s %3dpx %10.0f ns scalar %10.0f ns simd %5.2fx%s",
+                pieceNames[piece], size, scalarTime, simdTime, scalarTime / simdTime, same ? "" : " MISMATCH");
+
+            if (!same)
+                success = false;
+        }
+    }
+
+    nsvgDeleteRasterizer(scalar);
+    nsvgDeleteRasterizer(simd);
+
+    return success;
+}
+
+
+// Rasterize a full set of pieces one after another with a single rasterizer, and with the raster workers.
+static bool BenchAtlas(void)
+{
+    int size = ATLAS_BENCH_SIZE;
+    int pitch = SVG_ASSET_COUNT * size * 4;
+    std::vector<unsigned char> serialPixels(size * pitch);
+    std::vector<unsigned char> parallelPixels(size * pitch);
+
+    RASTER_ITEM items[SVG_ASSET_COUNT];
+    for (int piece = 0; piece < SVG_ASSET_COUNT; piece++)
+    {
+        items[piece].image = svgAssets[piece];
+        items[piece].scale = size / svgAssets[piece]->width;
+        items[piece].destination = &parallelPixels[piece * size * 4];
+        items[piece].width = size;
+        items[piece].height = size;
+        items[piece].stride = pitch;
+    }
+
+    NSVGrasterizer *rasterizer = nsvgCreateRasterizer();
+    if (rasterizer == NULL)
+        return false;
+    nsvgSetRasterizerSIMD(rasterizer, Raster_SIMDLevel());
+
+    BENCH_TIMER timer;
+    StartTimer(&timer);
+    for (int round = 0; round < ATLAS_BENCH_ROUNDS; round++)
+    {
+        for (int piece = 0; piece < SVG_ASSET_COUNT; piece++)
+            nsvgRasterize(rasterizer, items[piece].image, 0, 0, items[piece].scale, &serialPixels[piece * size * 4], size, size, pitch);
+    }
+    StopTimer(&timer, "svg/atlas/serial", ATLAS_BENCH_ROUNDS);
+
+    nsvgDeleteRasterizer(rasterizer);
+
+    StartTimer(&timer);
+    for (int round = 0; round < ATLAS_BENCH_ROUNDS; round++)
+        Raster_Run(items, SVG_ASSET_COUNT);
+    StopTimer(&timer, "svg/atlas/parallel", ATLAS_BENCH_ROUNDS);
+
+    LOG_INFO(LOG_CATEGORY_MAIN, "  %d raster threads", Raster_ThreadCount());
+
+    // Threads must not change the result.
+    return serialPixels == parallelPixels;
+}
+
+
+// Internal function.
+// Peak signal to noise ratio of b against a, both non-premultiplied RGBA. The colors are premultiplied first,
+// so differences hidden under transparency do not count.
+static double PremultipliedPSNR(const unsigned char *a, const unsigned char *b, int pixelCount)
+{
+    double squaredError = 0.0;
+    for (int i = 0; i < pixelCount; i++, a += 4, b += 4)
+    {
+        for (int channel = 0; channel < 4; channel++)
+        {
+            int valueA = channel == 3 ? a[3] : (a[channel] * a[3] + 127) / 255;
+            int valueB = channel == 3 ? b[3] : (b[channel] * b[3] + 127) / 255;
+            squaredError += (valueA - valueB) * (valueA - valueB);
+        }
+    }
+
+    double meanSquaredError = squaredError / (pixelCount * 4.0);
+    if (meanSquaredError == 0.0)
+        return INFINITY;
+    return 10.0 * log10((255.0 * 255.0) / meanSquaredError);
+}
+
+
+// Internal function.
+// The piece rasterized at four times the size and averaged down, as the ground truth both ways of
+// drawing it are measured against.
+static void RasterizeReference(NSVGrasterizer *rasterizer, NSVGimage *image, int size, unsigned char *pixels)
+{
+    int bigSize = size * MIP_BENCH_SUPERSAMPLING;
+    std::vector<unsigned char> big(bigSize * bigSize * 4);
+    nsvgRasterize(rasterizer, image, 0, 0, bigSize / image->width, big.data(), bigSize, bigSize, bigSize * 4);
+
+    int samples = MIP_BENCH_SUPERSAMPLING * MIP_BENCH_SUPERSAMPLING;
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            int sum[4] = { 0, 0, 0, 0 };
+            for (int j = 0; j < MIP_BENCH_SUPERSAMPLING; j++)
+            {
+                const unsigned char *sample = &big[(((y * MIP_BENCH_SUPERSAMPLING + j) * bigSize) + (x * MIP_BENCH_SUPERSAMPLING)) * 4];
+                for (int i = 0; i < MIP_BENCH_SUPERSAMPLING; i++, sample += 4)
+                {
+                    sum[0] += sample[0] * sample[3];
+                    sum[1] += sample[1] * sample[3];
+                    sum[2] += sample[2] * sample[3];
+                    sum[3] += sample[3];
+                }
+            }
+
+            unsigned char *out = &pixels[(y * size + x) * 4];
+            out[3] = (unsigned char)((sum[3] + samples / 2) / samples);
+            for (int channel = 0; channel < 3; channel++)
+                out[channel] = sum[3] > 0 ? (unsigned char)((sum[channel] + sum[3] / 2) / sum[3]) : 0;
+        }
+    }
+}
+
+
+// Pieces resampled from the mip chain against rasterizing them directly, in time and in quality.
+// Sizes in between the power of two levels exercise the fractional filter.
+static bool BenchMipChain(void)
+{
+    static const int sizes[] = { 45, 67, 90, 133, 180 };
+    static const char *names[][2] =
+    {
+        { "mip/direct/45px", "mip/resample/45px" },
+        { "mip/direct/67px", "mip/resample/67px" },
+        { "mip/direct/90px", "mip/resample/90px" },
+        { "mip/direct/133px", "mip/resample/133px" },
+        { "mip/direct/180px", "mip/resample/180px" }
+    };
+
+    if (MipChain_MasterSize() == 0)
+    {
+        LOG_INFO(LOG_CATEGORY_MAIN, "  mip chain disabled, skipped");
+        return true;
+    }
+
+    NSVGrasterizer *rasterizer = nsvgCreateRasterizer();
+    if (rasterizer == NULL)
+        return false;
+    nsvgSetRasterizerSIMD(rasterizer, Raster_SIMDLevel());
+
+    bool success = true;
+
+    for (size_t s = 0; s < SDL_arraysize(sizes); s++)
+    {
+        int size = sizes[s];
+        int pieceBytes = size * size * 4;
+        std::vector<unsigned char> direct(pieceBytes * SVG_ASSET_COUNT);
+        std::vector<unsigned char> resampled(pieceBytes * SVG_ASSET_COUNT);
+        std::vector<unsigned char> reference(pieceBytes);
+
+        BENCH_TIMER timer;
+        StartTimer(&timer);
+        for (int round = 0; round < MIP_BENCH_ROUNDS; round++)
+        {
+            for (int piece = 0; piece < SVG_ASSET_COUNT; piece++)
+                nsvgRasterize(rasterizer, svgAssets[piece], 0, 0, size / svgAssets[piece]->width, &direct[piece * pieceBytes], size, size, size * 4);
+        }
+        StopTimer(&timer, names[s][0], MIP_BENCH_ROUNDS * SVG_ASSET_COUNT);
+
+        StartTimer(&timer);
+        for (int round = 0; round < MIP_BENCH_ROUNDS; round++)
+        {
+            for (int piece = 0; piece < SVG_ASSET_COUNT; piece++)
+                MipChain_Resample((SVGAssetIndex)piece, size, &resampled[piece * pieceBytes], size * 4);
+        }
+        StopTimer(&timer, names[s][1], MIP_BENCH_ROUNDS * SVG_ASSET_COUNT);
+
+        double directPSNR = INFINITY;
+        double resampledPSNR = INFINITY;
+        for (int piece = 0; piece < SVG_ASSET_COUNT; piece++)
+        {
+            RasterizeReference(rasterizer, svgAssets[piece], size, reference.data());
+            directPSNR = SDL_min(directPSNR, PremultipliedPSNR(reference.data(), &direct[piece * pieceBytes], size * size));
+            resampledPSNR = SDL_min(resampledPSNR, PremultipliedPSNR(reference.data(), &resampled[piece * pieceBytes], size * size));
+        }
+
+        LOG_INFO(LOG_CATEGORY_MAIN, "  %3dpx worst PSNR against %dx supersampling: direct %6.2f dB, resampled %6.2f dB",
+            size, MIP_BENCH_SUPERSAMPLING, directPSNR, resampledPSNR);
+
+        if (resampledPSNR < MIP_BENCH_MIN_PSNR)
+            success = false;
+    }
+
+    nsvgDeleteRasterizer(rasterizer);
+
+    return success;
+}
+
+
+// Load each model from the archive the way Asset_Init does, decompression included.
+static bool BenchOBJLoad(void)
+{
+    static const char *names[OBJ_ASSET_SHAPE_COUNT] =
+    {
+        "obj/load/pawn",
+        "obj/load/rook",
+        "obj/load/knight",
+        "obj/load/bishop",
+        "obj/load/queen",
+        "obj/load/king",
+        "obj/load/board"
+    };
+
+    ZipArchive::Ptr archive = ZipFile::Open("assets");
+    bool success = true;
+
+    for (int model = 0; model < OBJ_ASSET_SHAPE_COUNT; model++)
+    {
+        BENCH_TIMER timer;
+        StartTimer(&timer);
+        for (int round = 0; round < OBJ_LOAD_ROUNDS; round++)
+        {
+            tinyobj::attrib_t attributes;
+            std::vector<tinyobj::shape_t> shapes;
+            std::vector<tinyobj::material_t> materials;
+            std::string error;
+
+            ZipArchiveEntry::Ptr archiveEntry = archive->GetEntry(objAssetPaths[model]);
+            if (archiveEntry == nullptr
+                || !tinyobj::LoadObj(&attributes, &shapes, &materials, &error, archiveEntry->GetDecompressionStream())
+                || shapes.empty())
+            {
+                success = false;
+            }
+            if (archiveEntry != nullptr)
+                archiveEntry->CloseDecompressionStream();
+        }
+        StopTimer(&timer, names[model], OBJ_LOAD_ROUNDS);
+    }
+
+    return success;
+}
+
+
+// A frame with fresh scratch, as DoRender draws it.
+static void DrawFrame(void)
+{
+    Arena_Reset(&renderArena);
+    Render_Draw(0, 0.0);
+}
+
+
+// Draw full frames of the starting position offscreen, with whichever backend was selected.
+static bool BenchRenderDraw(void)
+{
+    LOG_INFO(LOG_CATEGORY_MAIN, "  drawing with the %s backend", renderBackend->name);
+
+    refreshBoardState(&currentPosition);
+    Snapshot_Publish(0);
+    Snapshot_Acquire();
+
+    // The first frame rasterizes the pieces for the viewport.
+    DrawFrame();
+
+    BENCH_TIMER timer;
+    StartTimer(&timer);
+    for (int frame = 0; frame < DRAW_BENCH_FRAMES; frame++)
+    {
+        Render_Invalidate();
+        DrawFrame();
+    }
+    StopTimer(&timer, "render/draw_frame", DRAW_BENCH_FRAMES);
+    LOG_INFO(LOG_CATEGORY_MAIN, "  %u draw calls per frame", Render_LastFrameDrawCalls());
+
+    // The same frames with the checkerboard filled square by square.
+    bool layerEnabled = boardLayerEnabled;
+    boardLayerEnabled = false;
+
+    StartTimer(&timer);
+    for (int frame = 0; frame < DRAW_BENCH_FRAMES; frame++)
+    {
+        Render_Invalidate();
+        DrawFrame();
+    }
+    StopTimer(&timer, "render/draw_frame/no_board_layer", DRAW_BENCH_FRAMES);
+    LOG_INFO(LOG_CATEGORY_MAIN, "  %u draw calls per frame", Render_LastFrameDrawCalls());
+
+    boardLayerEnabled = layerEnabled;
+
+    // Nothing changes between these frames, so they are skipped.
+    DrawFrame();
+    StartTimer(&timer);
+    for (int frame = 0; frame < DRAW_BENCH_FRAMES; frame++)
+        DrawFrame();
+    StopTimer(&timer, "render/draw_frame/idle", DRAW_BENCH_FRAMES);
+
+    return true;
+}
+
+
+// The same position in the 3D view, which is drawn in full every frame. When the models are drawn on the
+// CPU, the time of each stage is logged too; --offscreen-size 1920 1080 gives a 1080p board.
+static bool BenchRenderDraw3D(void)
+{
+    refreshBoardState(&currentPosition);
+    Camera_SetViewMode2D(false);
+    Snapshot_Publish(0);
+    Snapshot_Acquire();
+
+    // The first frame sizes the bins and layers.
+    DrawFrame();
+
+    MESH_RASTER_STATS stats;
+    MeshRaster_TakeStats(&stats);
+
+    BENCH_TIMER timer;
+    StartTimer(&timer);
+    for (int frame = 0; frame < DRAW_BENCH_FRAMES; frame++)
+        DrawFrame();
+    StopTimer(&timer, "render/draw_frame_3d", DRAW_BENCH_FRAMES);
+    LOG_INFO(LOG_CATEGORY_MAIN, "  %u draw calls per frame", Render_LastFrameDrawCalls());
+
+    MeshRaster_TakeStats(&stats);
+    if (stats.frames > 0)
+    {
+        double frames = stats.frames;
+        LOG_INFO(LOG_CATEGORY_MAIN, "  on the CPU, per frame: %.0f triangles, %.0f binned; transform %.3f ms, bin %.3f ms, raster %.3f ms",
+            stats.triangles / frames, stats.binnedTriangles / frames,
+            stats.transformMilliseconds / frames, stats.binMilliseconds / frames, stats.rasterMilliseconds / frames);
+    }
+
+    Camera_SetViewMode2D(true);
+    Snapshot_Publish(0);
+    Snapshot_Acquire();
+
+    return true;
+}
+
+
+static const BENCHMARK benchmarks[] =
+{
+    { "list/append_iterate_clear", BenchListAppendIterate },
+    { "list/traverse", BenchListTraverse },
+    { "list/kinds", BenchListKinds },
+    { "queue/mpsc", BenchQueue },
+    { "events/pipeline_frame", BenchEventPipeline },
+    { "game/refresh_board_state", BenchRefreshBoardState },
+    { "model/bounding_box", BenchBoundingBoxes },
+    { "svg/parse", BenchSVGParse },
+    { "svg/rasterize", BenchSVGRasterize },
+    { "svg/rasterize_simd", BenchSVGRasterizeSIMD },
+    { "svg/atlas", BenchAtlas },
+    { "mip/chain", BenchMipChain },
+    { "obj/load", BenchOBJLoad },
+    { "render/draw_frame", BenchRenderDraw },
+    { "render/draw_frame_3d", BenchRenderDraw3D },
+};
+
+
+// Write the results as JSON, one benchmark per line, so baselines diff cleanly.
+static bool WriteResults(const char *path)
+{
+    SDL_RWops *file = SDL_RWFromFile(path, "w");
+    if (file == NULL)
+        return false;
+
+    char line[256];
+    int length = SDL_snprintf(line, sizeof(line), "{\n  \"benchmarks\": [\n");
+    bool success = SDL_RWwrite(file, line, length, 1) == 1;
+
+    for (int i = 0; i < resultCount && success; i++)
+    {
+        length = SDL_snprintf(line, sizeof(line), "    { \"name\": \"%s\", \"ns_per_op\": %.3f, \"allocations\": %u }%s\n",
+            results[i].name, results[i].nanosecondsPerOperation, results[i].allocations, (i + 1 < resultCount) ? "," : "");
+        success = SDL_RWwrite(file, line, length, 1) == 1;
+    }
+
+    if (success)
+    {
+        length = SDL_snprintf(line, sizeof(line), "  ]\n}\n");
+        success = SDL_RWwrite(file, line, length, 1) == 1;
+    }
+
+    if (SDL_RWclose(file) != 0)
+        success = false;
+
+    return success;
+}
+
+
+// Compare every result with the baseline entry of the same name.
+// Baselines are files written by WriteResults; an entry may add "threshold_percent" to override the default.
+static bool CompareWithBaseline(const char *path, double defaultThresholdPercent)
+{
+    std::vector<char> text;
+    if (!Util_ReadFile(path, &text))
+    {
+        LOG_ERROR(LOG_CATEGORY_MAIN, "Failed to read benchmark baseline %s", path);
+        return false;
+    }
+    const char *baseline = text.data();
+
+    bool success = true;
+    for (int i = 0; i < resultCount; i++)
+    {
+        double baselineNanoseconds;
+        if (!Util_FindResultNumber(baseline, "benchmarks", results[i].name, "ns_per_op", &baselineNanoseconds) || baselineNanoseconds <= 0.0)
+        {
+            LOG_INFO(LOG_CATEGORY_MAIN, "%-36s not in baseline", results[i].name);
+            continue;
+        }
+
+        double thresholdPercent = defaultThresholdPercent;
+        Util_FindResultNumber(baseline, "benchmarks", results[i].name, "threshold_percent", &thresholdPercent);
+
+        double changePercent = ((results[i].nanosecondsPerOperation - baselineNanoseconds) * 100.0) / baselineNanoseconds;
+        if (changePercent > thresholdPercent)
+        {
+            LOG_ERROR(LOG_CATEGORY_MAIN, "%-36s %12.2f ns/op, baseline %.2f ns/op: %+.1f%% exceeds %.1f%%",
+                results[i].name, results[i].nanosecondsPerOperation, baselineNanoseconds, changePercent, thresholdPercent);
+            success = false;
+        }
+        else
+        {
+            LOG_INFO(LOG_CATEGORY_MAIN, "%-36s %12.2f ns/op, baseline %.2f ns/op: %+.1f%%",
+                results[i].name, results[i].nanosecondsPerOperation, baselineNanoseconds, changePercent);
+        }
+    }
+
+    return success;
+}
+
+
+bool Bench_Run(const BENCH_OPTIONS *options)
+{
+    bool success = true;
+
+    resultCount = 0;
+    for (size_t i = 0; i < SDL_arraysize(benchmarks); i++)
+    {
+        if (options->filter != NULL && SDL_strstr(benchmarks[i].name, options->filter) == NULL)
+            continue;
+
+        if (!benchmarks[i].function())
+        {
+            LOG_ERROR(LOG_CATEGORY_MAIN, "Benchmark %s failed its check", benchmarks[i].name);
+            success = false;
+        }
+    }
+
+    if (options->outputPath != NULL && !WriteResults(options->outputPath))
+    {
+        LOG_ERROR(LOG_CATEGORY_MAIN, "Failed to write benchmark results to %s", options->outputPath);
+        success = false;
+    }
+
+    if (options->baselinePath != NULL && !CompareWithBaseline(options->baselinePath, options->thresholdPercent))
+        success = false;
+
+    return success;
+}
@@ -0,0 +1,46 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+
+
+// Slower than the baseline by more than this many percent counts as a regression,
+// unless the baseline entry sets its own "threshold_percent".
+#define BENCH_DEFAULT_THRESHOLD_PERCENT (10.0)
+
+
+typedef struct
+{
+    // Run only the benchmarks whose name contains this, or all of them when NULL.
+    const char *filter;
+    // Write the results here as JSON, when not NULL.
+    const char *outputPath;
+    // Compare the results with JSON written by an earlier run, when not NULL.
+    const char *baselinePath;
+    double thresholdPercent;
+} BENCH_OPTIONS;
+
+
+// Run the benchmarks and log their results. Every subsystem must be initialized,
+// with the render backend drawing offscreen.
+// Returns false if a correctness check failed or a result regressed against the baseline.
+bool Bench_Run(const BENCH_OPTIONS *options);
@@ -20,6 +20,7 @@
 
 #include "camera.h"
 #include <stdio.h>
+#include <string.h>
 #include "list.h"                       // List data structure.
 #include "main.h"                       // Reference the SDL event buffer list provided by the game loop.
 #include "SDL.h"                        // For SDL_Event structure definition.
@@ -27,13 +28,6 @@
 #include <glm/gtc/matrix_transform.hpp> // Include matrix transform: lookAt, perspective
 #include <glm/gtc/type_ptr.hpp>         // include type_ptr to convert mat4 to float[16]
 
-// Must include Windows header prior to including OpenGL header.
-#ifdef _WIN32
-#include <Windows.h>
-#endif
-#include <gl/GL.h>
-#include <gl/GLU.h>
-
 
 float FOV = 90;
 float width = 512;
@@ -48,21 +42,10 @@ glm::mat4 view;
 glm::mat4 projection;
 
 
-bool Camera_ViewToModelView()
-{
-    glMatrixMode(GL_MODELVIEW);
-    glLoadMatrixf(glm::value_ptr(view));
-
-    return true;
-}
-
-
-bool Camera_ReloadProjection()
+void Camera_GetMatrices(float *viewMatrix, float *projectionMatrix)
 {
-    glMatrixMode(GL_PROJECTION);
-    glLoadMatrixf(glm::value_ptr(projection));
-
-    return true;
+    memcpy(viewMatrix, glm::value_ptr(view), sizeof(float) * 16);
+    memcpy(projectionMatrix, glm::value_ptr(projection), sizeof(float) * 16);
 }
 
 
@@ -78,9 +61,13 @@ void SetViewMode()
         view = glm::lookAt(cameraPos, cameraTarget, cameraUp);
         projection = glm::perspective(FOV, aspect, 0.1f, 100.0f);
     }
+}
+
 
-    Camera_ViewToModelView();
-    Camera_ReloadProjection();
+void Camera_SetViewMode2D(bool enabled)
+{
+    viewMode2D = enabled;
+    SetViewMode();
 }
 
 
@@ -146,13 +133,12 @@ void ProcessMotion(SDL_Event *sdlEvent)
 
 void Camera_Logic(uint32_t currentTick)
 {
-    void *listIterator = List_IteratorCreate(sdlEventBuffer);
+    LIST_ITERATOR iteratorStorage;
+    void *listIterator = List_IteratorInit(&iteratorStorage, sdlEventBuffer);
 
     SDL_Event *currentEvent;
     while (List_IteratorNext(listIterator, (void **)&currentEvent))
         ProcessMotion(currentEvent);
-
-    List_IteratorDestroy(listIterator);
 }
 
 
@@ -24,8 +24,11 @@
 #include <stdint.h>
 
 extern bool viewMode2D;
-extern bool Camera_ViewToModelView(void);
-bool Camera_ReloadProjection(void);
+// Copy the current view and projection matrices, in column-major order, into two float[16] arrays.
+// The renderer reads them from here; the camera talks to no graphics API itself.
+void Camera_GetMatrices(float *viewMatrix, float *projectionMatrix);
+// Switch between the 2D and the 3D view, as the T key does.
+void Camera_SetViewMode2D(bool enabled);
 bool Camera_Init(void);
 void Camera_Logic(uint32_t currentTick);
 void Camera_Quit(void);
@@ -0,0 +1,432 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "renderbackend.h"
+#include "main.h"
+#include "meshraster.h"
+#include "SDL.h"
+
+
+// Pixels are R, G, B, A bytes, rows packed.
+struct RENDER_TEXTURE
+{
+    int width;
+    int height;
+    unsigned char *pixels;
+    RENDER_BLEND blend;
+    // One depth value per pixel, created by the first Clear, so every target keeps its own.
+    float *depth;
+};
+
+// The output. Grows to the window, or has the size given at Init without one.
+static RENDER_TEXTURE framebuffer;
+static int headlessWidth = 0;
+static int headlessHeight = 0;
+
+static RENDER_TEXTURE *target = &framebuffer;
+static SDL_Rect viewport;
+
+
+// Internal function.
+// x / 255, rounded, for x up to 255 * 255.
+static inline int Div255(int x)
+{
+    return ((x + 128) * 257) >> 16;
+}
+
+
+// Internal function.
+static bool ResizeTexture(RENDER_TEXTURE *texture, int width, int height)
+{
+    unsigned char *pixels = new unsigned char[(size_t)width * height * 4]();
+    delete[] texture->pixels;
+    texture->pixels = pixels;
+    delete[] texture->depth;
+    texture->depth = NULL;
+    texture->width = width;
+    texture->height = height;
+    return true;
+}
+
+
+// Internal function.
+// The area drawing to the current target may touch, and where its origin is.
+static void GetDrawArea(SDL_Rect *clip, int *originX, int *originY)
+{
+    SDL_Rect bounds = { 0, 0, target->width, target->height };
+    if (target != &framebuffer)
+    {
+        *clip = bounds;
+        *originX = 0;
+        *originY = 0;
+        return;
+    }
+
+    if (!SDL_IntersectRect(&viewport, &bounds, clip))
+        SDL_zerop(clip);
+    *originX = viewport.x;
+    *originY = viewport.y;
+}
+
+
+// Internal function.
+// Blend one source pixel with the given alpha over a destination pixel, the way SDL_BLENDMODE_BLEND does.
+static inline void BlendPixel(unsigned char *destination, const unsigned char *source, int alpha)
+{
+    int inverse = 255 - alpha;
+    destination[0] = (unsigned char)Div255(source[0] * alpha + destination[0] * inverse);
+    destination[1] = (unsigned char)Div255(source[1] * alpha + destination[1] * inverse);
+    destination[2] = (unsigned char)Div255(source[2] * alpha + destination[2] * inverse);
+    destination[3] = (unsigned char)(alpha + Div255(destination[3] * inverse));
+}
+
+
+// The window surface is in pixels, like the drawable size the SDL backend reports.
+static void GetOutputSize(int *width, int *height)
+{
+    if (sdlWindow != NULL)
+    {
+        SDL_Surface *surface = SDL_GetWindowSurface(sdlWindow);
+        if (surface != NULL)
+        {
+            *width = surface->w;
+            *height = surface->h;
+        }
+        else
+            SDL_GetWindowSize(sdlWindow, width, height);
+    }
+    else
+    {
+        *width = headlessWidth;
+        *height = headlessHeight;
+    }
+}
+
+
+static bool TargetsSupported(void)
+{
+    return true;
+}
+
+
+static RENDER_TEXTURE* CreateTexture(RENDER_TEXTURE_ACCESS access, int width, int height)
+{
+    RENDER_TEXTURE *texture = new RENDER_TEXTURE();
+    texture->blend = RENDER_BLEND_NONE;
+    ResizeTexture(texture, width, height);
+    return texture;
+}
+
+
+static void DestroyTexture(RENDER_TEXTURE *texture)
+{
+    if (texture == NULL)
+        return;
+
+    MeshRaster_Flush();
+    if (target == texture)
+        target = &framebuffer;
+
+    delete[] texture->pixels;
+    delete[] texture->depth;
+    delete texture;
+}
+
+
+static void GetTextureSize(RENDER_TEXTURE *texture, int *width, int *height)
+{
+    *width = texture->width;
+    *height = texture->height;
+}
+
+
+static void SetTextureBlend(RENDER_TEXTURE *texture, RENDER_BLEND blend)
+{
+    texture->blend = blend;
+}
+
+
+static bool LockTexture(RENDER_TEXTURE *texture, const SDL_Rect *region, void **pixels, int *pitch)
+{
+    MeshRaster_Flush();
+    *pitch = texture->width * 4;
+    *pixels = &texture->pixels[(size_t)region->y * *pitch + region->x * 4];
+    return true;
+}
+
+
+static void UnlockTexture(RENDER_TEXTURE *texture)
+{
+}
+
+
+static bool SetTarget(RENDER_TEXTURE *newTarget)
+{
+    target = newTarget != NULL ? newTarget : &framebuffer;
+    return true;
+}
+
+
+static void SetViewport(const SDL_Rect *newViewport)
+{
+    MeshRaster_Flush();
+    viewport = *newViewport;
+
+    // The window may have been resized; the framebuffer follows it.
+    int width;
+    int height;
+    GetOutputSize(&width, &height);
+    if (width != framebuffer.width || height != framebuffer.height)
+        ResizeTexture(&framebuffer, width, height);
+}
+
+
+static void Clear(SDL_Color color)
+{
+    MeshRaster_Flush();
+
+    size_t pixelCount = (size_t)target->width * target->height;
+    unsigned char *pixel = target->pixels;
+    for (size_t i = 0; i < pixelCount; i++, pixel += 4)
+    {
+        pixel[0] = color.r;
+        pixel[1] = color.g;
+        pixel[2] = color.b;
+        pixel[3] = color.a;
+    }
+
+    if (target->depth == NULL)
+        target->depth = new float[pixelCount];
+    for (size_t i = 0; i < pixelCount; i++)
+        target->depth[i] = 1.0f;
+}
+
+
+static void FillRect(const SDL_Rect *rect, SDL_Color color)
+{
+    MeshRaster_Flush();
+
+    SDL_Rect clip;
+    int originX;
+    int originY;
+    GetDrawArea(&clip, &originX, &originY);
+
+    SDL_Rect area = { rect->x + originX, rect->y + originY, rect->w, rect->h };
+    if (!SDL_IntersectRect(&area, &clip, &area))
+        return;
+
+    const unsigned char source[4] = { color.r, color.g, color.b, color.a };
+    for (int y = area.y; y < area.y + area.h; y++)
+    {
+        unsigned char *pixel = &target->pixels[((size_t)y * target->width + area.x) * 4];
+        for (int x = 0; x < area.w; x++, pixel += 4)
+        {
+            if (color.a == 255)
+                memcpy(pixel, source, 4);
+            else
+                BlendPixel(pixel, source, color.a);
+        }
+    }
+}
+
+
+// Nearest neighbour scaling, like SDL's default scale quality.
+static void Blit(RENDER_TEXTURE *texture, const SDL_Rect *source, const SDL_Rect *destination, uint8_t alpha)
+{
+    MeshRaster_Flush();
+
+    SDL_Rect clip;
+    int originX;
+    int originY;
+    GetDrawArea(&clip, &originX, &originY);
+
+    SDL_Rect full = { 0, 0, texture->width, texture->height };
+    SDL_Rect from = source != NULL ? *source : full;
+    SDL_Rect to = { destination->x + originX, destination->y + originY, destination->w, destination->h };
+    SDL_Rect area;
+    if (from.w <= 0 || from.h <= 0 || !SDL_IntersectRect(&to, &clip, &area))
+        return;
+
+    // Source position in 16.16 fixed point, stepped once per destination pixel.
+    int64_t stepX = ((int64_t)from.w << 16) / to.w;
+    int64_t stepY = ((int64_t)from.h << 16) / to.h;
+
+    for (int y = area.y; y < area.y + area.h; y++)
+    {
+        int sourceY = from.y + (int)(((y - to.y) * stepY + (stepY >> 1)) >> 16);
+        const unsigned char *sourceRow = &texture->pixels[(size_t)sourceY * texture->width * 4];
+        unsigned char *pixel = &target->pixels[((size_t)y * target->width + area.x) * 4];
+
+        int64_t sourceX = (area.x - to.x) * stepX + (stepX >> 1);
+        for (int x = 0; x < area.w; x++, pixel += 4, sourceX += stepX)
+        {
+            const unsigned char *texel = &sourceRow[(from.x + (int)(sourceX >> 16)) * 4];
+            if (texture->blend == RENDER_BLEND_NONE)
+                memcpy(pixel, texel, 4);
+            else
+            {
+                int texelAlpha = alpha == 255 ? texel[3] : Div255(texel[3] * alpha);
+                if (texelAlpha == 255)
+                    memcpy(pixel, texel, 4);
+                else if (texelAlpha != 0)
+                    BlendPixel(pixel, texel, texelAlpha);
+            }
+        }
+    }
+}
+
+
+// A RENDER_MODEL of this backend is the MODEL itself; the mesh rasterizer draws straight from it.
+static RENDER_MODEL* CreateModel(const MODEL *model)
+{
+    return (RENDER_MODEL*)model;
+}
+
+
+static void DestroyModel(RENDER_MODEL *model)
+{
+}
+
+
+// Binned now, rasterized by the next command that touches the pixels.
+static bool DrawModel(RENDER_MODEL *model, int firstIndex, int indexCount, const float *viewProjection, const RENDER_INSTANCE *instances, int instanceCount)
+{
+    MESH_RASTER_TARGET meshTarget;
+    int originX;
+    int originY;
+    GetDrawArea(&meshTarget.clip, &originX, &originY);
+    if (meshTarget.clip.w <= 0 || meshTarget.clip.h <= 0 || target->depth == NULL)
+        return false;
+
+    meshTarget.pixels = target->pixels;
+    meshTarget.depth = target->depth;
+    meshTarget.width = target->width;
+    meshTarget.height = target->height;
+    meshTarget.viewport.x = originX;
+    meshTarget.viewport.y = originY;
+    meshTarget.viewport.w = target == &framebuffer ? viewport.w : target->width;
+    meshTarget.viewport.h = target == &framebuffer ? viewport.h : target->height;
+
+    MeshRaster_Draw(&meshTarget, (const MODEL*)model, firstIndex, indexCount, viewProjection, instances, instanceCount);
+    return true;
+}
+
+
+static bool ReadPixels(const SDL_Rect *area, void *pixels, int pitch)
+{
+    MeshRaster_Flush();
+
+    SDL_Rect bounds = { 0, 0, framebuffer.width, framebuffer.height };
+    SDL_Rect from = { viewport.x, viewport.y, viewport.w, viewport.h };
+    if (area != NULL)
+    {
+        from.x += area->x;
+        from.y += area->y;
+        from.w = area->w;
+        from.h = area->h;
+    }
+
+    SDL_Rect inside;
+    if (!SDL_IntersectRect(&from, &bounds, &inside) || !SDL_RectEquals(&from, &inside))
+        return false;
+
+    for (int y = 0; y < from.h; y++)
+        memcpy((unsigned char*)pixels + (size_t)y * pitch, &framebuffer.pixels[((size_t)(from.y + y) * framebuffer.width + from.x) * 4], (size_t)from.w * 4);
+
+    return true;
+}
+
+
+// With a window, the framebuffer is copied into its surface; without one there is nothing to show.
+static void Present(void)
+{
+    MeshRaster_Flush();
+    MeshRaster_EndFrame();
+
+    if (sdlWindow == NULL)
+        return;
+
+    SDL_Surface *surface = SDL_GetWindowSurface(sdlWindow);
+    if (surface == NULL || SDL_LockSurface(surface) != 0)
+        return;
+
+    SDL_ConvertPixels(SDL_min(surface->w, framebuffer.width), SDL_min(surface->h, framebuffer.height),
+        SDL_PIXELFORMAT_RGBA32, framebuffer.pixels, framebuffer.width * 4,
+        surface->format->format, surface->pixels, surface->pitch);
+
+    SDL_UnlockSurface(surface);
+    SDL_UpdateWindowSurface(sdlWindow);
+}
+
+
+bool CPUBackend_Init(int width, int height)
+{
+    headlessWidth = width;
+    headlessHeight = height;
+
+    GetOutputSize(&width, &height);
+    if (width <= 0 || height <= 0)
+        return false;
+
+    ResizeTexture(&framebuffer, width, height);
+    target = &framebuffer;
+    viewport.x = 0;
+    viewport.y = 0;
+    viewport.w = width;
+    viewport.h = height;
+
+    return true;
+}
+
+
+void CPUBackend_Quit(void)
+{
+    MeshRaster_Flush();
+
+    delete[] framebuffer.pixels;
+    delete[] framebuffer.depth;
+    SDL_zero(framebuffer);
+    target = &framebuffer;
+}
+
+
+const RENDER_BACKEND cpuRenderBackend =
+{
+    "CPU",
+    GetOutputSize,
+    TargetsSupported,
+    CreateTexture,
+    DestroyTexture,
+    GetTextureSize,
+    SetTextureBlend,
+    LockTexture,
+    UnlockTexture,
+    SetTarget,
+    SetViewport,
+    Clear,
+    FillRect,
+    Blit,
+    CreateModel,
+    DestroyModel,
+    DrawModel,
+    ReadPixels,
+    Present
+};
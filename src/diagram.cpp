@@ -0,0 +1,326 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <vector>
+#include "asset.h"
+#include "diagram.h"
+#include "logger.h"
+#include "png.h"
+#include "raster.h"
+#include "render.h"
+#include "spritecache.h"
+#include "util.h"
+#include "SDL.h"
+
+
+#define DIAGRAM_MAX_THREADS (16)
+#define DIAGRAM_PATH_LENGTH (1024)
+// Keeps the diagram sprite sheets apart from the renderer's atlases in the sprite cache.
+#define DIAGRAM_SHEET_THEME (0x6469616772616d00ULL)
+
+#define NO_PIECE (-1)
+
+
+// Every piece at one tile size, side by side in SVGAssetIndex order.
+typedef struct
+{
+    const unsigned char *pixels;
+    int tileSize;
+    int pitch;
+} SPRITE_SHEET;
+
+// State shared by the workers of one run.
+typedef struct
+{
+    const DIAGRAM_OPTIONS *options;
+    const SPRITE_SHEET *sheet;
+    // Start of each line of the input, NUL-terminated.
+    std::vector<char*> lines;
+    SDL_atomic_t nextLine;
+    SDL_atomic_t rendered;
+    SDL_atomic_t failed;
+} DIAGRAM_JOB;
+
+
+static int PieceFromFEN(char c)
+{
+    switch (c)
+    {
+        case 'P': return SVG_PAWN_LIGHT;
+        case 'N': return SVG_KNIGHT_LIGHT;
+        case 'B': return SVG_BISHOP_LIGHT;
+        case 'R': return SVG_ROOK_LIGHT;
+        case 'Q': return SVG_QUEEN_LIGHT;
+        case 'K': return SVG_KING_LIGHT;
+        case 'p': return SVG_PAWN_DARK;
+        case 'n': return SVG_KNIGHT_DARK;
+        case 'b': return SVG_BISHOP_DARK;
+        case 'r': return SVG_ROOK_DARK;
+        case 'q': return SVG_QUEEN_DARK;
+        case 'k': return SVG_KING_DARK;
+        default: return NO_PIECE;
+    }
+}
+
+
+// Read the piece placement field of a FEN or EPD line into squares, from a8 to h1.
+static bool ParsePlacement(const char *line, int squares[64])
+{
+    int row = 0;
+    int column = 0;
+    for (const char *c = line; *c != '\0' && *c != ' '; c++)
+    {
+        if (*c == '/')
+        {
+            if (column != 8 || ++row >= 8)
+                return false;
+            column = 0;
+        }
+        else if (*c >= '1' && *c <= '8')
+        {
+            for (int empty = *c - '0'; empty > 0; empty--)
+            {
+                if (column >= 8)
+                    return false;
+                squares[(row * 8) + column++] = NO_PIECE;
+            }
+        }
+        else
+        {
+            int piece = PieceFromFEN(*c);
+            if (piece == NO_PIECE || column >= 8)
+                return false;
+            squares[(row * 8) + column++] = piece;
+        }
+    }
+
+    return row == 7 && column == 8;
+}
+
+
+// Draw the board and blend the pieces over it. The image is opaque.
+static void ComposeDiagram(const SPRITE_SHEET *sheet, const int squares[64], unsigned char *image)
+{
+    int tileSize = sheet->tileSize;
+    int pitch = tileSize * 8 * 4;
+
+    for (int row = 0; row < 8; row++)
+    {
+        for (int column = 0; column < 8; column++)
+        {
+            const SDL_Color *color = (((row + column) % 2) == 0) ? &boardLightColor : &boardDarkColor;
+            int piece = squares[(row * 8) + column];
+            unsigned char *tile = image + ((size_t)row * tileSize * pitch) + ((size_t)column * tileSize * 4);
+
+            for (int y = 0; y < tileSize; y++)
+            {
+                unsigned char *destination = tile + ((size_t)y * pitch);
+                const unsigned char *source = NULL;
+                if (piece != NO_PIECE)
+                    source = sheet->pixels + ((size_t)y * sheet->pitch) + ((size_t)piece * tileSize * 4);
+
+                for (int x = 0; x < tileSize; x++, destination += 4)
+                {
+                    // nanosvg does not premultiply alpha.
+                    int alpha = (source != NULL) ? source[3] : 0;
+                    destination[0] = (unsigned char)(((source != NULL ? source[0] * alpha : 0) + (color->r * (255 - alpha)) + 127) / 255);
+                    destination[1] = (unsigned char)(((source != NULL ? source[1] * alpha : 0) + (color->g * (255 - alpha)) + 127) / 255);
+                    destination[2] = (unsigned char)(((source != NULL ? source[2] * alpha : 0) + (color->b * (255 - alpha)) + 127) / 255);
+                    destination[3] = 255;
+
+                    if (source != NULL)
+                        source += 4;
+                }
+            }
+        }
+    }
+}
+
+
+// Claim lines until none are left. Each worker composes into buffers of its own.
+static int SDLCALL DiagramWorker(void *data)
+{
+    DIAGRAM_JOB *job = (DIAGRAM_JOB*)data;
+    const DIAGRAM_OPTIONS *options = job->options;
+    int boardSize = job->sheet->tileSize * 8;
+
+    std::vector<unsigned char> image((size_t)boardSize * boardSize * 4);
+    std::vector<unsigned char> filtered;
+    std::vector<unsigned char> compressed;
+    std::vector<unsigned char> png;
+    char path[DIAGRAM_PATH_LENGTH];
+    int squares[64];
+
+    for (;;)
+    {
+        int index = SDL_AtomicAdd(&job->nextLine, 1);
+        if (index >= (int)job->lines.size())
+            break;
+
+        const char *line = job->lines[index];
+        if (*line == '\0' || *line == '#')
+            continue;
+
+        if (!ParsePlacement(line, squares))
+        {
+            LOG_WARN(LOG_CATEGORY_MAIN, "Diagram: line %d is not a FEN or EPD position", index + 1);
+            SDL_AtomicAdd(&job->failed, 1);
+            continue;
+        }
+
+        ComposeDiagram(job->sheet, squares, image.data());
+
+        bool success;
+        if (options->format == DIAGRAM_FORMAT_PNG)
+        {
+            SDL_snprintf(path, sizeof(path), "%s/%06d.png", options->outputDirectory, index + 1);
+            success = PNG_Encode(image.data(), boardSize, boardSize, &filtered, &compressed, &png)
+                && Util_WriteFile(path, png.data(), png.size());
+        }
+        else
+        {
+            SDL_snprintf(path, sizeof(path), "%s/%06d.rgba", options->outputDirectory, index + 1);
+            success = Util_WriteFile(path, image.data(), image.size());
+        }
+
+        if (success)
+            SDL_AtomicAdd(&job->rendered, 1);
+        else
+        {
+            LOG_WARN(LOG_CATEGORY_MAIN, "Diagram: could not write the diagram of line %d", index + 1);
+            SDL_AtomicAdd(&job->failed, 1);
+        }
+    }
+
+    return 0;
+}
+
+
+// Cut a file read with Util_ReadFile into NUL-terminated lines, in place.
+static void SplitLines(std::vector<char> *text, std::vector<char*> *lines)
+{
+    char *line = text->data();
+    for (char *c = text->data(); ; c++)
+    {
+        if (*c == '\n' || *c == '\r' || *c == '\0')
+        {
+            bool end = *c == '\0';
+            // A Windows line ending is one terminator, so line numbers match the file's.
+            bool windowsEnding = c[0] == '\r' && c[1] == '\n';
+            *c = '\0';
+            lines->push_back(line);
+            if (end)
+                break;
+            if (windowsEnding)
+                c++;
+            line = c + 1;
+        }
+    }
+}
+
+
+bool Diagram_Run(const DIAGRAM_OPTIONS *options)
+{
+    int tileSize = options->size / 8;
+    if (tileSize <= 0)
+    {
+        LOG_ERROR(LOG_CATEGORY_MAIN, "Diagram: a board of %d pixels is too small", options->size);
+        return false;
+    }
+
+    DIAGRAM_JOB job;
+    job.options = options;
+    SDL_AtomicSet(&job.nextLine, 0);
+    SDL_AtomicSet(&job.rendered, 0);
+    SDL_AtomicSet(&job.failed, 0);
+
+    std::vector<char> text;
+    if (!Util_ReadFile(options->inputPath, &text))
+    {
+        LOG_ERROR(LOG_CATEGORY_MAIN, "Diagram: could not read %s", options->inputPath);
+        return false;
+    }
+    SplitLines(&text, &job.lines);
+
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    // The pieces are rasterized once per size, or not at all when the sprite cache has them.
+    SPRITE_SHEET sheet;
+    sheet.tileSize = tileSize;
+    sheet.pitch = SVG_ASSET_COUNT * tileSize * 4;
+    size_t sheetBytes = (size_t)tileSize * sheet.pitch;
+
+    unsigned char *rasterized = NULL;
+    sheet.pixels = SpriteCache_Find(tileSize, svgAssetHash ^ DIAGRAM_SHEET_THEME, sheetBytes);
+    if (sheet.pixels == NULL)
+    {
+        rasterized = new unsigned char[sheetBytes]();
+
+        RASTER_ITEM items[SVG_ASSET_COUNT];
+        for (int piece = 0; piece < SVG_ASSET_COUNT; piece++)
+        {
+            items[piece].image = svgAssets[piece];
+            items[piece].scale = tileSize / svgAssets[piece]->width;
+            items[piece].destination = rasterized + ((size_t)piece * tileSize * 4);
+            items[piece].width = tileSize;
+            items[piece].height = tileSize;
+            items[piece].stride = sheet.pitch;
+        }
+        Raster_Run(items, SVG_ASSET_COUNT);
+
+        sheet.pixels = rasterized;
+    }
+    job.sheet = &sheet;
+
+    int threadCount = options->threadCount;
+    if (threadCount <= 0)
+        threadCount = SDL_GetCPUCount();
+    if (threadCount > DIAGRAM_MAX_THREADS)
+        threadCount = DIAGRAM_MAX_THREADS;
+
+    // The calling thread works through the lines too.
+    SDL_Thread *workers[DIAGRAM_MAX_THREADS];
+    int workerCount = 0;
+    for (int i = 1; i < threadCount; i++)
+    {
+        workers[workerCount] = SDL_CreateThread(DiagramWorker, "DiagramWorker", &job);
+        if (workers[workerCount] != NULL)
+            workerCount++;
+    }
+
+    DiagramWorker(&job);
+
+    for (int i = 0; i < workerCount; i++)
+        SDL_WaitThread(workers[i], NULL);
+
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    int rendered = SDL_AtomicGet(&job.rendered);
+    int failed = SDL_AtomicGet(&job.failed);
+
+    LOG_INFO(LOG_CATEGORY_MAIN, "Diagram: %d diagrams of %d pixels in %.3f s, %.1f diagrams/s on %d threads, %d failed",
+        rendered, tileSize * 8, seconds, (seconds > 0.0) ? rendered / seconds : 0.0, workerCount + 1, failed);
+
+    // Only now, since the cache frees a sheet that does not fit.
+    if (rasterized != NULL)
+        SpriteCache_Insert(tileSize, svgAssetHash ^ DIAGRAM_SHEET_THEME, rasterized, sheetBytes);
+
+    return failed == 0;
+}
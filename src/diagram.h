@@ -0,0 +1,52 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+
+
+#define DIAGRAM_DEFAULT_SIZE (360)
+
+
+typedef enum {
+    DIAGRAM_FORMAT_PNG,
+    // Bare R, G, B, A bytes, row by row from the top.
+    DIAGRAM_FORMAT_RGBA
+} DIAGRAM_FORMAT;
+
+typedef struct
+{
+    // One position per line, as FEN or EPD. Only the piece placement is used.
+    const char *inputPath;
+    // Must exist. Diagrams are named after the line of their position.
+    const char *outputDirectory;
+    // Edge of the board in pixels, rounded down to a multiple of 8.
+    int size;
+    DIAGRAM_FORMAT format;
+    // Worker threads that compose and write the diagrams. 0 means one per core.
+    int threadCount;
+} DIAGRAM_OPTIONS;
+
+
+// Render a board diagram for every position of the input and log the diagrams per second.
+// Needs the asset, raster and sprite cache subsystems, but no window or renderer.
+// Returns false if the input could not be read or any diagram failed.
+bool Diagram_Run(const DIAGRAM_OPTIONS *options);
@@ -18,9 +18,10 @@
     along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "animation.h"
 #include "game.h"
+#include "logger.h"
 #include "render.h"
-#include "SDL_log.h"
 
 Position currentPosition;
 StateListPtr States(new std::deque<StateInfo>(1));
@@ -32,13 +33,84 @@ BOARD_STATE boardState = {};
 
 GAME_STATUS gameStatus = GSTATUS_NOCHANGE;
 
+int selectedRank = -1;
+int selectedFile = -1;
+
+uint64_t lastInputTime = 0;
+LATENCY_KIND lastInputKind = LATENCY_NONE;
+
 BOARD_STATE getEmptyBoard(void);
-void refreshBoardState(Position *newPosition);
 
 Square fromSquare = SQ_NONE;
 
-inline bool IsCorrectSide(Position &position, Move moveAttempt) {
-    return color_of(position.moved_piece(moveAttempt)) == position.side_to_move();
+static GAME_PIECE ToGamePiece(Piece piece);
+
+// Find the legal move that matches a pair of clicked squares.
+// Castling is accepted by clicking either the king's destination or the rook.
+// Pawns reaching the last rank are promoted to queens.
+static Move ResolveMove(Position &position, Square from, Square to)
+{
+    for (const auto &generatedMove : MoveList<LEGAL>(position))
+    {
+        Move move = generatedMove;
+        if (from_sq(move) != from)
+            continue;
+
+        switch (type_of(move))
+        {
+        case CASTLING:
+            // Stockfish encodes castling as the king capturing its own rook.
+            if (to_sq(move) == to || make_square(to_sq(move) > from ? FILE_G : FILE_C, rank_of(from)) == to)
+                return move;
+            break;
+        case PROMOTION:
+            if (to_sq(move) == to && promotion_type(move) == QUEEN)
+                return move;
+            break;
+        default:
+            if (to_sq(move) == to)
+                return move;
+            break;
+        }
+    }
+
+    return MOVE_NONE;
+}
+
+// Queue the animations that show a move. Must be called before the move is made.
+static void StartMoveAnimations(Position &position, Move move, uint32_t currentTick)
+{
+    Square from = from_sq(move);
+    Square to = to_sq(move);
+    GAME_PIECE movedPiece = ToGamePiece(position.moved_piece(move));
+
+    // Never let animations queue up behind each other.
+    Animation_SkipAll();
+
+    if (type_of(move) == CASTLING)
+    {
+        bool kingSide = to > from;
+        Rank rank = rank_of(from);
+        GAME_PIECE rook = ToGamePiece(position.piece_on(to));
+
+        Animation_Start(ANIMATION_MOVE, movedPiece, rank, file_of(from), rank, kingSide ? FILE_G : FILE_C, currentTick);
+        Animation_Start(ANIMATION_MOVE, rook, rank, file_of(to), rank, kingSide ? FILE_F : FILE_D, currentTick);
+        return;
+    }
+
+    // The captured pawn sits beside the destination square.
+    Square captureSquare = to;
+    if (type_of(move) == ENPASSANT)
+        captureSquare = make_square(file_of(to), rank_of(from));
+
+    if (position.piece_on(captureSquare) != NO_PIECE)
+    {
+        GAME_PIECE capturedPiece = ToGamePiece(position.piece_on(captureSquare));
+        Animation_Start(ANIMATION_CAPTURE, capturedPiece, rank_of(captureSquare), file_of(captureSquare),
+                        rank_of(captureSquare), file_of(captureSquare), currentTick);
+    }
+
+    Animation_Start(ANIMATION_MOVE, movedPiece, rank_of(from), file_of(from), rank_of(to), file_of(to), currentTick);
 }
 
 bool Game_Init(void)
@@ -65,58 +137,82 @@ void Game_Logic(uint32_t currentTick)
 {
     Square square = SQ_NONE;
     Move moveAttempt = MOVE_NONE;
-    StateInfo *st = nullptr;
 
     if (userClickedTileLastFrame) 
     {
-        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Clicked rank/file: %d / %d", lastFrameClickedRank, lastFrameClickedFile);
+        // Any click finishes running animations, so rapid play never waits on them.
+        Animation_SkipAll();
+
+        // Every click at least changes the selection. A legal move upgrades this below.
+        lastInputTime = lastFrameClickTime;
+        lastInputKind = LATENCY_SELECT;
+
+        LOG_DEBUG(LOG_CATEGORY_GAME, "Clicked rank/file: %d / %d", lastFrameClickedRank, lastFrameClickedFile);
         square = make_square((File)lastFrameClickedFile, (Rank)lastFrameClickedRank);
 
-        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Stockfish tile no: %d", square);
+        LOG_DEBUG(LOG_CATEGORY_GAME, "Stockfish tile no: %d", square);
 
         if (fromSquare == square && fromSquare != SQ_NONE)
         {
             // If the square is clicked again, clear it.
             fromSquare = SQ_NONE;
-            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Source square was clicked. Unselecting...", square);
+            LOG_DEBUG(LOG_CATEGORY_GAME, "Source square was clicked. Unselecting...");
         }
         else if (fromSquare != SQ_NONE)
         {
             // If a different target square is clicked, build a move attempt.
             moveAttempt = make_move(fromSquare, square);
-            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Constructing move attempt.", square);
+            LOG_DEBUG(LOG_CATEGORY_GAME, "Constructing move attempt.");
             fromSquare = SQ_NONE;
         }
         else
         {
             fromSquare = square;
         }
+
+        if (fromSquare != SQ_NONE)
+        {
+            selectedRank = rank_of(fromSquare);
+            selectedFile = file_of(fromSquare);
+        }
+        else
+        {
+            selectedRank = -1;
+            selectedFile = -1;
+        }
     }
 
     if (moveAttempt != MOVE_NONE && moveAttempt != MOVE_NULL) 
     {
-        if (IsCorrectSide(currentPosition, moveAttempt) && currentPosition.legal(moveAttempt)) {
+        // Clicked squares don't carry castling, en passant or promotion, so look up the full move.
+        Move legalMove = ResolveMove(currentPosition, from_sq(moveAttempt), to_sq(moveAttempt));
+
+        if (legalMove != MOVE_NONE) {
             // Move is legal. Update board state, change move, etc.
 
             gameStatus = GSTATUS_MOVE_SUCCESS;
 
-            if (currentPosition.gives_check(moveAttempt))
+            if (currentPosition.gives_check(legalMove))
                 gameStatus = GSTATUS_MOVE_SUCCESS_CHECK;
 
-            st = new StateInfo();
-            States->push_back(*st);
-            currentPosition.do_move(moveAttempt, *st);
+            StartMoveAnimations(currentPosition, legalMove, currentTick);
+
+            // The position keeps a pointer to its state, so it has to live in the state list.
+            States->emplace_back();
+            currentPosition.do_move(legalMove, States->back());
 
             // Refresh our board state.
             refreshBoardState(&currentPosition);
 
-            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Move performed.", square);
+            lastInputKind = LATENCY_MOVE;
+
+            LOG_INFO(LOG_CATEGORY_GAME, "Move performed: %d to %d", from_sq(legalMove), to_sq(legalMove));
         } else {
             // Move is not legal.
 
             gameStatus = GSTATUS_MOVE_INVALID;
 
-            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Illegal move!", square);
+            LOG_INFO(LOG_CATEGORY_GAME, "Illegal move!");
         }
     } else {
         gameStatus = GSTATUS_NOCHANGE;
@@ -192,53 +288,41 @@ BOARD_STATE getEmptyBoard(void) {
     return freshBoard;
 }
 
+static GAME_PIECE ToGamePiece(Piece piece) {
+    switch (piece) {
+    case W_PAWN:
+        return PIECE_PAWN;
+    case W_KNIGHT:
+        return PIECE_KNIGHT;
+    case W_BISHOP:
+        return PIECE_BISHOP;
+    case W_ROOK:
+        return PIECE_ROOK;
+    case W_QUEEN:
+        return PIECE_QUEEN;
+    case W_KING:
+        return PIECE_KING;
+    case B_PAWN:
+        return PIECE_BPAWN;
+    case B_KNIGHT:
+        return PIECE_BKNIGHT;
+    case B_BISHOP:
+        return PIECE_BBISHOP;
+    case B_ROOK:
+        return PIECE_BROOK;
+    case B_QUEEN:
+        return PIECE_BQUEEN;
+    case B_KING:
+        return PIECE_BKING;
+    default:
+        return PIECE_EMPTY;
+    }
+}
+
 void refreshBoardState(Position *newPosition) {
     for (int rank = 0; rank < NUM_RANKS; rank++) {
         for (int file = 0; file < NUM_FILES; file++) {
-            GAME_PIECE piece = PIECE_EMPTY;
-            switch (newPosition->piece_on(make_square((File)file, (Rank)rank))) {
-            case NO_PIECE:
-                piece = PIECE_EMPTY;
-                break;
-            case W_PAWN:
-                piece = PIECE_PAWN;
-                break;
-            case W_KNIGHT:
-                piece = PIECE_KNIGHT;
-                break;
-            case W_BISHOP:
-                piece = PIECE_BISHOP;
-                break;
-            case W_ROOK:
-                piece = PIECE_ROOK;
-                break;
-            case W_QUEEN:
-                piece = PIECE_QUEEN;
-                break;
-            case W_KING:
-                piece = PIECE_KING;
-                break;
-            case B_PAWN:
-                piece = PIECE_BPAWN;
-                break;
-            case B_KNIGHT:
-                piece = PIECE_BKNIGHT;
-                break;
-            case B_BISHOP:
-                piece = PIECE_BBISHOP;
-                break;
-            case B_ROOK:
-                piece = PIECE_BROOK;
-                break;
-            case B_QUEEN:
-                piece = PIECE_BQUEEN;
-                break;
-            case B_KING:
-                piece = PIECE_BKING;
-                break;
-            }
-
-            boardState.pieces[rank][file] = piece;
+            boardState.pieces[rank][file] = ToGamePiece(newPosition->piece_on(make_square((File)file, (Rank)rank)));
         }
     }
 }
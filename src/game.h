@@ -23,7 +23,10 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "latency.h"
+
 #include "Stockfish\src\bitboard.h"
+#include "Stockfish\src\movegen.h"
 #include "Stockfish\src\position.h"
 #include "Stockfish\src\search.h"
 #include "Stockfish\src\thread.h"
@@ -68,12 +71,26 @@ typedef enum {
     GSTATUS_MOVE_INVALID
 } GAME_STATUS;
 
+// The position the game is played in.
+extern Position currentPosition;
+
 // The current state of the board.
 extern BOARD_STATE boardState;
 
 // The current status of the game module.
 extern GAME_STATUS gameStatus;
 
+// The rank and file of the square selected as the source of the next move, or -1 when nothing is selected.
+extern int selectedRank;
+extern int selectedFile;
+
+// Arrival time of the last click the game responded to, and what the response was.
+extern uint64_t lastInputTime;
+extern LATENCY_KIND lastInputKind;
+
+// Update boardState from a position.
+void refreshBoardState(Position *newPosition);
+
 bool Game_Init(void);
 void Game_Logic(uint32_t currentTick);
 void Game_Quit(void);
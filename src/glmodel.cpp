@@ -0,0 +1,355 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+#include "glmodel.h"
+#include "logger.h"
+#include "SDL.h"
+#include "SDL_opengl.h"
+
+
+// Attribute locations. The transform takes four, one per column.
+#define GL_MODEL_POSITION (0)
+#define GL_MODEL_NORMAL (1)
+#define GL_MODEL_TRANSFORM (2)
+#define GL_MODEL_COLOR (6)
+
+// Everything past OpenGL 1.1 is looked up at runtime.
+#define GL_MODEL_FUNCTIONS \
+    GL_MODEL_FUNCTION(PFNGLGENBUFFERSPROC, GenBuffers) \
+    GL_MODEL_FUNCTION(PFNGLDELETEBUFFERSPROC, DeleteBuffers) \
+    GL_MODEL_FUNCTION(PFNGLBINDBUFFERPROC, BindBuffer) \
+    GL_MODEL_FUNCTION(PFNGLBUFFERDATAPROC, BufferData) \
+    GL_MODEL_FUNCTION(PFNGLBUFFERSUBDATAPROC, BufferSubData) \
+    GL_MODEL_FUNCTION(PFNGLGENVERTEXARRAYSPROC, GenVertexArrays) \
+    GL_MODEL_FUNCTION(PFNGLDELETEVERTEXARRAYSPROC, DeleteVertexArrays) \
+    GL_MODEL_FUNCTION(PFNGLBINDVERTEXARRAYPROC, BindVertexArray) \
+    GL_MODEL_FUNCTION(PFNGLVERTEXATTRIBPOINTERPROC, VertexAttribPointer) \
+    GL_MODEL_FUNCTION(PFNGLENABLEVERTEXATTRIBARRAYPROC, EnableVertexAttribArray) \
+    GL_MODEL_FUNCTION(PFNGLVERTEXATTRIBDIVISORPROC, VertexAttribDivisor) \
+    GL_MODEL_FUNCTION(PFNGLDRAWELEMENTSINSTANCEDPROC, DrawElementsInstanced) \
+    GL_MODEL_FUNCTION(PFNGLCREATESHADERPROC, CreateShader) \
+    GL_MODEL_FUNCTION(PFNGLDELETESHADERPROC, DeleteShader) \
+    GL_MODEL_FUNCTION(PFNGLSHADERSOURCEPROC, ShaderSource) \
+    GL_MODEL_FUNCTION(PFNGLCOMPILESHADERPROC, CompileShader) \
+    GL_MODEL_FUNCTION(PFNGLGETSHADERIVPROC, GetShaderiv) \
+    GL_MODEL_FUNCTION(PFNGLGETSHADERINFOLOGPROC, GetShaderInfoLog) \
+    GL_MODEL_FUNCTION(PFNGLCREATEPROGRAMPROC, CreateProgram) \
+    GL_MODEL_FUNCTION(PFNGLDELETEPROGRAMPROC, DeleteProgram) \
+    GL_MODEL_FUNCTION(PFNGLATTACHSHADERPROC, AttachShader) \
+    GL_MODEL_FUNCTION(PFNGLBINDATTRIBLOCATIONPROC, BindAttribLocation) \
+    GL_MODEL_FUNCTION(PFNGLLINKPROGRAMPROC, LinkProgram) \
+    GL_MODEL_FUNCTION(PFNGLGETPROGRAMIVPROC, GetProgramiv) \
+    GL_MODEL_FUNCTION(PFNGLGETPROGRAMINFOLOGPROC, GetProgramInfoLog) \
+    GL_MODEL_FUNCTION(PFNGLUSEPROGRAMPROC, UseProgram) \
+    GL_MODEL_FUNCTION(PFNGLGETUNIFORMLOCATIONPROC, GetUniformLocation) \
+    GL_MODEL_FUNCTION(PFNGLUNIFORM1FPROC, Uniform1f) \
+    GL_MODEL_FUNCTION(PFNGLUNIFORM3FVPROC, Uniform3fv) \
+    GL_MODEL_FUNCTION(PFNGLUNIFORMMATRIX4FVPROC, UniformMatrix4fv)
+
+
+struct GL_MODEL
+{
+    GLuint vertexArray;
+    GLuint vertexBuffer;
+    GLuint indexBuffer;
+    GLenum indexType;
+    int indexSize;
+};
+
+static struct
+{
+#define GL_MODEL_FUNCTION(type, name) type name;
+    GL_MODEL_FUNCTIONS
+#undef GL_MODEL_FUNCTION
+} gl;
+
+static GLuint program = 0;
+static GLint viewProjectionLocation = -1;
+
+// Every draw's instances go through this one buffer, which only ever grows.
+static GLuint instanceBuffer = 0;
+static size_t instanceCapacity = 0;
+
+// Lit per vertex; the models are smooth enough that it looks the same as per pixel.
+static const char *vertexShaderSource =
+    "#version 130\n"
+    "uniform mat4 viewProjection;\n"
+    "uniform vec3 lightDirection;\n"
+    "uniform float ambient;\n"
+    "in vec3 position;\n"
+    "in vec3 normal;\n"
+    "in mat4 transform;\n"
+    "in vec4 color;\n"
+    "out vec4 shade;\n"
+    "void main()\n"
+    "{\n"
+    "    vec3 worldNormal = normalize(mat3(transform) * normal);\n"
+    "    float diffuse = max(dot(worldNormal, lightDirection), 0.0);\n"
+    "    shade = vec4(color.rgb * (ambient + ((1.0 - ambient) * diffuse)), 1.0);\n"
+    "    gl_Position = viewProjection * (transform * vec4(position, 1.0));\n"
+    "}\n";
+
+static const char *fragmentShaderSource =
+    "#version 130\n"
+    "in vec4 shade;\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = shade;\n"
+    "}\n";
+
+
+// Internal function.
+static GLuint CompileShader(GLenum type, const char *source)
+{
+    GLuint shader = gl.CreateShader(type);
+    gl.ShaderSource(shader, 1, &source, NULL);
+    gl.CompileShader(shader);
+
+    GLint compiled = GL_FALSE;
+    gl.GetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled != GL_TRUE)
+    {
+        char infoLog[1024];
+        gl.GetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+        LOG_ERROR(LOG_CATEGORY_RENDER, "GLModel_Init: shader did not compile: %s", infoLog);
+        gl.DeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
+
+
+// Internal function.
+static bool BuildProgram(void)
+{
+    GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexShaderSource);
+    GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+    if (vertexShader == 0 || fragmentShader == 0)
+    {
+        if (vertexShader != 0)
+            gl.DeleteShader(vertexShader);
+        if (fragmentShader != 0)
+            gl.DeleteShader(fragmentShader);
+        return false;
+    }
+
+    program = gl.CreateProgram();
+    gl.AttachShader(program, vertexShader);
+    gl.AttachShader(program, fragmentShader);
+    gl.BindAttribLocation(program, GL_MODEL_POSITION, "position");
+    gl.BindAttribLocation(program, GL_MODEL_NORMAL, "normal");
+    gl.BindAttribLocation(program, GL_MODEL_TRANSFORM, "transform");
+    gl.BindAttribLocation(program, GL_MODEL_COLOR, "color");
+    gl.LinkProgram(program);
+
+    // The program keeps what it needs.
+    gl.DeleteShader(vertexShader);
+    gl.DeleteShader(fragmentShader);
+
+    GLint linked = GL_FALSE;
+    gl.GetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE)
+    {
+        char infoLog[1024];
+        gl.GetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+        LOG_ERROR(LOG_CATEGORY_RENDER, "GLModel_Init: program did not link: %s", infoLog);
+        gl.DeleteProgram(program);
+        program = 0;
+        return false;
+    }
+
+    viewProjectionLocation = gl.GetUniformLocation(program, "viewProjection");
+
+    GLint previousProgram = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+    gl.UseProgram(program);
+    gl.Uniform3fv(gl.GetUniformLocation(program, "lightDirection"), 1, renderLightDirection);
+    gl.Uniform1f(gl.GetUniformLocation(program, "ambient"), RENDER_LIGHT_AMBIENT);
+    gl.UseProgram(previousProgram);
+
+    return true;
+}
+
+
+bool GLModel_Init(void)
+{
+#define GL_MODEL_FUNCTION(type, name) gl.name = (type)SDL_GL_GetProcAddress("gl" #name);
+    GL_MODEL_FUNCTIONS
+#undef GL_MODEL_FUNCTION
+
+    // Instancing was an extension until OpenGL 3.3.
+    if (gl.VertexAttribDivisor == NULL)
+        gl.VertexAttribDivisor = (PFNGLVERTEXATTRIBDIVISORPROC)SDL_GL_GetProcAddress("glVertexAttribDivisorARB");
+
+#define GL_MODEL_FUNCTION(type, name) \
+    if (gl.name == NULL) \
+    { \
+        LOG_WARN(LOG_CATEGORY_RENDER, "GLModel_Init: OpenGL %s has no gl" #name, (const char*)glGetString(GL_VERSION)); \
+        return false; \
+    }
+    GL_MODEL_FUNCTIONS
+#undef GL_MODEL_FUNCTION
+
+    if (!BuildProgram())
+        return false;
+
+    gl.GenBuffers(1, &instanceBuffer);
+    instanceCapacity = 0;
+
+    LOG_INFO(LOG_CATEGORY_RENDER, "Drawing models with OpenGL %s on %s", (const char*)glGetString(GL_VERSION), (const char*)glGetString(GL_RENDERER));
+
+    return true;
+}
+
+
+void GLModel_Quit(void)
+{
+    if (program != 0)
+        gl.DeleteProgram(program);
+    program = 0;
+
+    if (instanceBuffer != 0)
+        gl.DeleteBuffers(1, &instanceBuffer);
+    instanceBuffer = 0;
+    instanceCapacity = 0;
+}
+
+
+GL_MODEL* GLModel_Create(const MODEL *model)
+{
+    if (program == 0)
+        return NULL;
+
+    GL_MODEL *glModel = new GL_MODEL();
+    glModel->indexType = model->wideIndices ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+    glModel->indexSize = model->wideIndices ? sizeof(uint32_t) : sizeof(uint16_t);
+
+    gl.GenVertexArrays(1, &glModel->vertexArray);
+    gl.BindVertexArray(glModel->vertexArray);
+
+    // Position and normal, interleaved as the model stores them.
+    GLsizei stride = sizeof(float) * MODEL_VERTEX_FLOATS;
+    gl.GenBuffers(1, &glModel->vertexBuffer);
+    gl.BindBuffer(GL_ARRAY_BUFFER, glModel->vertexBuffer);
+    gl.BufferData(GL_ARRAY_BUFFER, (GLsizeiptr)stride * model->vertexCount, model->vertices, GL_STATIC_DRAW);
+    gl.EnableVertexAttribArray(GL_MODEL_POSITION);
+    gl.VertexAttribPointer(GL_MODEL_POSITION, 3, GL_FLOAT, GL_FALSE, stride, (const void*)0);
+    gl.EnableVertexAttribArray(GL_MODEL_NORMAL);
+    gl.VertexAttribPointer(GL_MODEL_NORMAL, 3, GL_FLOAT, GL_FALSE, stride, (const void*)(sizeof(float) * 3));
+
+    // The instances advance once per copy of the model rather than per vertex.
+    gl.BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (int column = 0; column < 4; column++)
+    {
+        gl.EnableVertexAttribArray(GL_MODEL_TRANSFORM + column);
+        gl.VertexAttribPointer(GL_MODEL_TRANSFORM + column, 4, GL_FLOAT, GL_FALSE, sizeof(RENDER_INSTANCE),
+            (const void*)(offsetof(RENDER_INSTANCE, transform) + (sizeof(float) * 4 * column)));
+        gl.VertexAttribDivisor(GL_MODEL_TRANSFORM + column, 1);
+    }
+    gl.EnableVertexAttribArray(GL_MODEL_COLOR);
+    gl.VertexAttribPointer(GL_MODEL_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(RENDER_INSTANCE), (const void*)offsetof(RENDER_INSTANCE, color));
+    gl.VertexAttribDivisor(GL_MODEL_COLOR, 1);
+
+    gl.GenBuffers(1, &glModel->indexBuffer);
+    gl.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, glModel->indexBuffer);
+    gl.BufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)glModel->indexSize * model->indexCount, model->indices, GL_STATIC_DRAW);
+
+    // The SDL renderer draws from client memory, which needs no vertex array or buffer bound.
+    gl.BindVertexArray(0);
+    gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return glModel;
+}
+
+
+void GLModel_Destroy(GL_MODEL *model)
+{
+    if (model == NULL)
+        return;
+
+    if (program != 0)
+    {
+        gl.DeleteVertexArrays(1, &model->vertexArray);
+        gl.DeleteBuffers(1, &model->vertexBuffer);
+        gl.DeleteBuffers(1, &model->indexBuffer);
+    }
+
+    delete model;
+}
+
+
+// The SDL renderer keeps track of its own state, so whatever is changed here is put back.
+bool GLModel_Draw(GL_MODEL *model, int firstIndex, int indexCount, const float *viewProjection, const RENDER_INSTANCE *instances, int instanceCount)
+{
+    if (program == 0)
+        return false;
+    if (instanceCount <= 0)
+        return true;
+
+    GLint previousProgram = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+    // Orphan the old contents instead of waiting for draws that still read them.
+    size_t bytes = sizeof(RENDER_INSTANCE) * instanceCount;
+    gl.BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    if (bytes > instanceCapacity)
+        instanceCapacity = bytes;
+    gl.BufferData(GL_ARRAY_BUFFER, (GLsizeiptr)instanceCapacity, NULL, GL_STREAM_DRAW);
+    gl.BufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)bytes, instances);
+
+    gl.UseProgram(program);
+    gl.UniformMatrix4fv(viewProjectionLocation, 1, GL_FALSE, viewProjection);
+
+    glDisable(GL_BLEND);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+
+    gl.BindVertexArray(model->vertexArray);
+    gl.DrawElementsInstanced(GL_TRIANGLES, indexCount, model->indexType, (const void*)((size_t)firstIndex * model->indexSize), instanceCount);
+    gl.BindVertexArray(0);
+    gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (blend)
+        glEnable(GL_BLEND);
+    if (cullFace)
+        glEnable(GL_CULL_FACE);
+    if (!depthTest)
+        glDisable(GL_DEPTH_TEST);
+    gl.UseProgram(previousProgram);
+
+    return true;
+}
+
+
+void GLModel_ClearDepth(void)
+{
+    if (program == 0)
+        return;
+
+    glDepthMask(GL_TRUE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
@@ -0,0 +1,44 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include "renderbackend.h"
+
+
+// Models drawn with OpenGL into the context of an "opengl" SDL renderer, instanced, with one draw per model.
+// Every function must be called with that context current.
+
+
+// A model in buffers of its own.
+typedef struct GL_MODEL GL_MODEL;
+
+
+// Load the functions and build the shaders. Returns false if the context cannot draw instanced models,
+// which needs OpenGL 3.3 or 3.1 with ARB_instanced_arrays.
+bool GLModel_Init(void);
+void GLModel_Quit(void);
+
+// Upload the vertices and indices into buffers of their own.
+GL_MODEL* GLModel_Create(const MODEL *model);
+void GLModel_Destroy(GL_MODEL *model);
+bool GLModel_Draw(GL_MODEL *model, int firstIndex, int indexCount, const float *viewProjection, const RENDER_INSTANCE *instances, int instanceCount);
+void GLModel_ClearDepth(void);
@@ -0,0 +1,579 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "golden.h"
+#include "logger.h"
+#include "png.h"
+#include "render.h"
+#include "util.h"
+#include "SDL.h"
+
+
+#define GOLDEN_MAX_COMMANDS (1024)
+#define GOLDEN_NAME_LENGTH (64)
+#define GOLDEN_PATH_LENGTH (1024)
+#define GOLDEN_TIMING_FILE "timing.json"
+
+
+typedef enum {
+    GOLDEN_CLICK,
+    GOLDEN_KEY,
+    GOLDEN_CAPTURE
+} GOLDEN_COMMAND_KIND;
+
+typedef struct
+{
+    uint32_t tick;
+    GOLDEN_COMMAND_KIND kind;
+    int rank;
+    int file;
+    SDL_Keycode key;
+    char name[GOLDEN_NAME_LENGTH];
+
+    // Results of a capture.
+    bool captured;
+    double renderMilliseconds;
+    bool compared;
+    bool matched;
+    uint32_t differingPixels;
+    int maxChannelDelta;
+    double psnr;
+} GOLDEN_COMMAND;
+
+typedef struct
+{
+    uint32_t tick;
+    double renderMilliseconds;
+} GOLDEN_FRAME;
+
+typedef struct
+{
+    const char *name;
+    double renderMilliseconds;
+    // Whether being slower than the baseline fails the run. The others vary too much from run to run.
+    bool checked;
+} GOLDEN_STATISTIC;
+
+// The script, in file order.
+static GOLDEN_COMMAND commands[GOLDEN_MAX_COMMANDS];
+static int commandCount = 0;
+
+
+// Names of the summary statistics in the timing file.
+static const char *statisticNames[] = { "mean", "median", "p95", "max" };
+
+
+// Internal function.
+// Captures become file names, so they may not leave the output directory.
+static bool IsFileName(const char *name)
+{
+    return name[0] != '\0' && name[0] != '.' && SDL_strchr(name, '/') == NULL && SDL_strchr(name, '\\') == NULL && SDL_strchr(name, ':') == NULL;
+}
+
+
+// Internal function.
+static bool ParseCommand(char *line, int lineNumber, GOLDEN_COMMAND *command)
+{
+    unsigned int tick;
+    char kind[16];
+    char argument[GOLDEN_NAME_LENGTH];
+    if (SDL_sscanf(line, "%u %15s %63s", &tick, kind, argument) != 3)
+    {
+        LOG_ERROR(LOG_CATEGORY_MAIN, "Golden: line %d is not \"<tick> <command> <argument>\"", lineNumber);
+        return false;
+    }
+
+    SDL_zerop(command);
+    command->tick = tick;
+    SDL_strlcpy(command->name, argument, sizeof(command->name));
+
+    if (SDL_strcmp(kind, "click") == 0)
+    {
+        command->kind = GOLDEN_CLICK;
+        command->file = argument[0] - 'a';
+        command->rank = argument[1] - '1';
+        if (command->file < 0 || command->file >= 8 || command->rank < 0 || command->rank >= 8 || argument[2] != '\0')
+        {
+            LOG_ERROR(LOG_CATEGORY_MAIN, "Golden: line %d does not click a square from a1 to h8", lineNumber);
+            return false;
+        }
+    }
+    else if (SDL_strcmp(kind, "key") == 0)
+    {
+        command->kind = GOLDEN_KEY;
+        command->key = SDL_GetKeyFromName(argument);
+        if (command->key == SDLK_UNKNOWN)
+        {
+            LOG_ERROR(LOG_CATEGORY_MAIN, "Golden: line %d presses a key SDL does not know", lineNumber);
+            return false;
+        }
+    }
+    else if (SDL_strcmp(kind, "capture") == 0)
+    {
+        command->kind = GOLDEN_CAPTURE;
+        if (!IsFileName(argument))
+        {
+            LOG_ERROR(LOG_CATEGORY_MAIN, "Golden: line %d names a capture that is not a plain file name", lineNumber);
+            return false;
+        }
+    }
+    else
+    {
+        LOG_ERROR(LOG_CATEGORY_MAIN, "Golden: line %d has an unknown command", lineNumber);
+        return false;
+    }
+
+    return true;
+}
+
+
+// Internal function.
+// Ticks must not go backwards, so the commands are played in file order.
+static bool ReadScript(const char *path)
+{
+    std::vector<char> text;
+    if (!Util_ReadFile(path, &text))
+    {
+        LOG_ERROR(LOG_CATEGORY_MAIN, "Golden: could not read the script %s", path);
+        return false;
+    }
+
+    commandCount = 0;
+    int lineNumber = 0;
+    char *line = text.data();
+    while (line != NULL)
+    {
+        char *end = SDL_strchr(line, '\n');
+        if (end != NULL)
+            *end = '\0';
+        lineNumber++;
+
+        while (*line == ' ' || *line == '\t')
+            line++;
+        if (*line != '\0' && *line != '\r' && *line != '#')
+        {
+            if (commandCount == GOLDEN_MAX_COMMANDS)
+            {
+                LOG_ERROR(LOG_CATEGORY_MAIN, "Golden: the script has more than %d commands", GOLDEN_MAX_COMMANDS);
+                return false;
+            }
+
+            GOLDEN_COMMAND *command = &commands[commandCount];
+            if (!ParseCommand(line, lineNumber, command))
+                return false;
+            if (commandCount > 0 && command->tick < commands[commandCount - 1].tick)
+            {
+                LOG_ERROR(LOG_CATEGORY_MAIN, "Golden: line %d goes back in time", lineNumber);
+                return false;
+            }
+            commandCount++;
+        }
+
+        line = end != NULL ? end + 1 : NULL;
+    }
+
+    if (commandCount == 0)
+    {
+        LOG_ERROR(LOG_CATEGORY_MAIN, "Golden: the script has no commands");
+        return false;
+    }
+
+    return true;
+}
+
+
+// Internal function.
+// Queue the events of an input command, to be picked up by the input of the tick.
+static void PushInput(const GOLDEN_COMMAND *command)
+{
+    SDL_Event event;
+
+    if (command->kind == GOLDEN_CLICK)
+    {
+        // The middle of the square, in window coordinates.
+        SDL_Rect viewport;
+        Render_GetViewport(&viewport);
+        int dimension = viewport.w / 8;
+
+        SDL_zero(event);
+        event.type = SDL_MOUSEBUTTONDOWN;
+        event.button.button = SDL_BUTTON_LEFT;
+        event.button.state = SDL_PRESSED;
+        event.button.clicks = 1;
+        event.button.x = viewport.x + (command->file * dimension) + (dimension / 2);
+        event.button.y = viewport.y + (((8 - 1) - command->rank) * dimension) + (dimension / 2);
+        SDL_PushEvent(&event);
+
+        event.type = SDL_MOUSEBUTTONUP;
+        event.button.state = SDL_RELEASED;
+        SDL_PushEvent(&event);
+    }
+    else if (command->kind == GOLDEN_KEY)
+    {
+        SDL_zero(event);
+        event.type = SDL_KEYDOWN;
+        event.key.state = SDL_PRESSED;
+        event.key.keysym.sym = command->key;
+        event.key.keysym.scancode = SDL_GetScancodeFromKey(command->key);
+        SDL_PushEvent(&event);
+
+        event.type = SDL_KEYUP;
+        event.key.state = SDL_RELEASED;
+        SDL_PushEvent(&event);
+    }
+}
+
+
+// Internal function.
+// Count the pixels with a channel further from the baseline than the tolerance, and mark them in a
+// difference image: red where they differ, the capture faded to gray elsewhere.
+static void CompareCapture(GOLDEN_COMMAND *command, const unsigned char *pixels, const unsigned char *baseline, int pixelCount, int channelTolerance, unsigned char *difference)
+{
+    double squaredError = 0.0;
+    command->differingPixels = 0;
+    command->maxChannelDelta = 0;
+
+    for (int i = 0; i < pixelCount * 4; i += 4)
+    {
+        int pixelDelta = 0;
+        for (int channel = 0; channel < 4; channel++)
+        {
+            int delta = SDL_abs(pixels[i + channel] - baseline[i + channel]);
+            squaredError += (double)delta * delta;
+            pixelDelta = SDL_max(pixelDelta, delta);
+        }
+
+        command->maxChannelDelta = SDL_max(command->maxChannelDelta, pixelDelta);
+        if (pixelDelta > channelTolerance)
+        {
+            command->differingPixels++;
+            difference[i] = 255;
+            difference[i + 1] = 0;
+            difference[i + 2] = 0;
+        }
+        else
+        {
+            unsigned char gray = (unsigned char)(((pixels[i] * 77) + (pixels[i + 1] * 150) + (pixels[i + 2] * 29)) >> 10);
+            difference[i] = gray + 128;
+            difference[i + 1] = gray + 128;
+            difference[i + 2] = gray + 128;
+        }
+        difference[i + 3] = 255;
+    }
+
+    double meanSquaredError = squaredError / ((double)pixelCount * 4);
+    command->psnr = meanSquaredError > 0.0 ? 10.0 * log10((255.0 * 255.0) / meanSquaredError) : INFINITY;
+    command->matched = command->differingPixels == 0;
+}
+
+
+// Internal function.
+// Save the frame captured after a tick under the name of every capture command of that tick,
+// and compare each with its baseline.
+static bool SaveCaptures(int first, int last, const unsigned char *pixels, int width, int height, double renderMilliseconds, const GOLDEN_OPTIONS *options)
+{
+    bool success = true;
+    char path[GOLDEN_PATH_LENGTH];
+    std::vector<unsigned char> baseline;
+    std::vector<unsigned char> difference;
+
+    for (int i = first; i < last; i++)
+    {
+        GOLDEN_COMMAND *command = &commands[i];
+        if (command->kind != GOLDEN_CAPTURE)
+            continue;
+
+        command->captured = true;
+        command->renderMilliseconds = renderMilliseconds;
+
+        SDL_snprintf(path, sizeof(path), "%s/%s.png", options->outputDirectory, command->name);
+        if (!PNG_Save(path, pixels, width, height))
+        {
+            LOG_ERROR(LOG_CATEGORY_MAIN, "Golden: could not write the capture %s", command->name);
+            success = false;
+            continue;
+        }
+
+        if (options->baselineDirectory == NULL)
+        {
+            LOG_INFO(LOG_CATEGORY_MAIN, "%-24s tick %5u %8.3f ms", command->name, command->tick, renderMilliseconds);
+            continue;
+        }
+
+        int baselineWidth;
+        int baselineHeight;
+        SDL_snprintf(path, sizeof(path), "%s/%s.png", options->baselineDirectory, command->name);
+        if (!PNG_Load(path, &baseline, &baselineWidth, &baselineHeight))
+        {
+            LOG_ERROR(LOG_CATEGORY_MAIN, "%-24s has no baseline image", command->name);
+            success = false;
+            continue;
+        }
+        if (baselineWidth != width || baselineHeight != height)
+        {
+            LOG_ERROR(LOG_CATEGORY_MAIN, "%-24s is %dx%d, baseline %dx%d", command->name, width, height, baselineWidth, baselineHeight);
+            success = false;
+            continue;
+        }
+
+        difference.resize((size_t)width * height * 4);
+        CompareCapture(command, pixels, baseline.data(), width * height, options->channelTolerance, difference.data());
+        command->compared = true;
+
+        if (command->matched)
+        {
+            LOG_INFO(LOG_CATEGORY_MAIN, "%-24s tick %5u %8.3f ms, matches (max channel delta %d)",
+                command->name, command->tick, renderMilliseconds, command->maxChannelDelta);
+            continue;
+        }
+
+        LOG_ERROR(LOG_CATEGORY_MAIN, "%-24s tick %5u %8.3f ms, %u pixels (%.3f%%) differ, max channel delta %d, PSNR %.2f dB",
+            command->name, command->tick, renderMilliseconds, command->differingPixels,
+            (command->differingPixels * 100.0) / (width * height), command->maxChannelDelta, command->psnr);
+        success = false;
+
+        SDL_snprintf(path, sizeof(path), "%s/%s.diff.png", options->outputDirectory, command->name);
+        if (!PNG_Save(path, difference.data(), width, height))
+            LOG_WARN(LOG_CATEGORY_MAIN, "Golden: could not write the difference image of %s", command->name);
+    }
+
+    return success;
+}
+
+
+// Internal function.
+// Mean, median, 95th percentile and maximum of the presented frames. Captured frames are left out,
+// since they include reading the frame back.
+static void ComputeStatistics(const std::vector<GOLDEN_FRAME> &frames, GOLDEN_STATISTIC statistics[SDL_arraysize(statisticNames)])
+{
+    std::vector<double> sorted;
+    double total = 0.0;
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        sorted.push_back(frames[i].renderMilliseconds);
+        total += frames[i].renderMilliseconds;
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    size_t count = sorted.size();
+    statistics[0].name = statisticNames[0];
+    statistics[0].renderMilliseconds = count > 0 ? total / count : 0.0;
+    statistics[0].checked = false;
+    statistics[1].name = statisticNames[1];
+    statistics[1].renderMilliseconds = count > 0 ? sorted[count / 2] : 0.0;
+    statistics[1].checked = true;
+    statistics[2].name = statisticNames[2];
+    statistics[2].renderMilliseconds = count > 0 ? sorted[SDL_min(count - 1, (count * 95) / 100)] : 0.0;
+    statistics[2].checked = true;
+    statistics[3].name = statisticNames[3];
+    statistics[3].renderMilliseconds = count > 0 ? sorted[count - 1] : 0.0;
+    statistics[3].checked = false;
+}
+
+
+// Internal function.
+static bool WriteLine(SDL_RWops *file, const char *format, ...)
+{
+    char line[256];
+    va_list arguments;
+    va_start(arguments, format);
+    int length = SDL_vsnprintf(line, sizeof(line), format, arguments);
+    va_end(arguments);
+
+    return length > 0 && length < (int)sizeof(line) && SDL_RWwrite(file, line, length, 1) == 1;
+}
+
+
+// Internal function.
+// One entry per line, so the baseline can be read back a line at a time.
+static bool WriteTiming(const char *path, const std::vector<GOLDEN_FRAME> &frames, const GOLDEN_STATISTIC statistics[SDL_arraysize(statisticNames)])
+{
+    SDL_RWops *file = SDL_RWFromFile(path, "w");
+    if (file == NULL)
+        return false;
+
+    bool success = WriteLine(file, "{\n  \"summary\": [\n");
+    for (size_t i = 0; i < SDL_arraysize(statisticNames) && success; i++)
+        success = WriteLine(file, "    { \"name\": \"%s\", \"render_ms\": %.4f }%s\n", statistics[i].name, statistics[i].renderMilliseconds, (i + 1 < SDL_arraysize(statisticNames)) ? "," : "");
+
+    int captureCount = 0;
+    for (int i = 0; i < commandCount; i++)
+        captureCount += commands[i].captured ? 1 : 0;
+
+    if (success)
+        success = WriteLine(file, "  ],\n  \"captures\": [\n");
+    for (int i = 0, written = 0; i < commandCount && success; i++)
+    {
+        const GOLDEN_COMMAND *command = &commands[i];
+        if (!command->captured)
+            continue;
+
+        written++;
+        success = WriteLine(file, "    { \"name\": \"%s\", \"tick\": %u, \"render_ms\": %.4f }%s\n",
+            command->name, command->tick, command->renderMilliseconds, (written < captureCount) ? "," : "");
+    }
+
+    if (success)
+        success = WriteLine(file, "  ],\n  \"frames\": [\n");
+    for (size_t i = 0; i < frames.size() && success; i++)
+        success = WriteLine(file, "    { \"tick\": %u, \"render_ms\": %.4f }%s\n", frames[i].tick, frames[i].renderMilliseconds, (i + 1 < frames.size()) ? "," : "");
+
+    if (success)
+        success = WriteLine(file, "  ]\n}\n");
+
+    if (SDL_RWclose(file) != 0)
+        success = false;
+
+    return success;
+}
+
+
+// Internal function.
+static bool CompareTiming(const char *path, const GOLDEN_STATISTIC statistics[SDL_arraysize(statisticNames)], double thresholdPercent)
+{
+    std::vector<char> baseline;
+    if (!Util_ReadFile(path, &baseline))
+    {
+        LOG_ERROR(LOG_CATEGORY_MAIN, "Golden: could not read the baseline timings");
+        return false;
+    }
+
+    bool success = true;
+    for (size_t i = 0; i < SDL_arraysize(statisticNames); i++)
+    {
+        double baselineMilliseconds;
+        if (!Util_FindResultNumber(baseline.data(), "summary", statistics[i].name, "render_ms", &baselineMilliseconds) || baselineMilliseconds <= 0.0)
+        {
+            LOG_INFO(LOG_CATEGORY_MAIN, "render %-17s not in baseline", statistics[i].name);
+            continue;
+        }
+
+        double changePercent = ((statistics[i].renderMilliseconds - baselineMilliseconds) * 100.0) / baselineMilliseconds;
+        if (statistics[i].checked && changePercent > thresholdPercent)
+        {
+            LOG_ERROR(LOG_CATEGORY_MAIN, "render %-17s %8.3f ms, baseline %.3f ms: %+.1f%% exceeds %.1f%%",
+                statistics[i].name, statistics[i].renderMilliseconds, baselineMilliseconds, changePercent, thresholdPercent);
+            success = false;
+        }
+        else
+        {
+            LOG_INFO(LOG_CATEGORY_MAIN, "render %-17s %8.3f ms, baseline %.3f ms: %+.1f%%",
+                statistics[i].name, statistics[i].renderMilliseconds, baselineMilliseconds, changePercent);
+        }
+    }
+
+    // The captured frames, too, for a look at where the time went. They never fail the run.
+    for (int i = 0; i < commandCount; i++)
+    {
+        const GOLDEN_COMMAND *command = &commands[i];
+        if (!command->captured)
+            continue;
+
+        double baselineMilliseconds;
+        if (Util_FindResultNumber(baseline.data(), "captures", command->name, "render_ms", &baselineMilliseconds) && baselineMilliseconds > 0.0)
+        {
+            LOG_INFO(LOG_CATEGORY_MAIN, "capture %-16s %8.3f ms, baseline %.3f ms: %+.1f%%", command->name, command->renderMilliseconds,
+                baselineMilliseconds, ((command->renderMilliseconds - baselineMilliseconds) * 100.0) / baselineMilliseconds);
+        }
+    }
+
+    return success;
+}
+
+
+bool Golden_Run(const GOLDEN_OPTIONS *options, GOLDEN_TICK_FUNCTION runTick, GOLDEN_DRAW_FUNCTION drawFrame)
+{
+    if (!ReadScript(options->scriptPath))
+        return false;
+
+    bool success = true;
+    std::vector<GOLDEN_FRAME> frames;
+    std::vector<unsigned char> pixels;
+    uint64_t frequency = SDL_GetPerformanceFrequency();
+    uint32_t lastTick = commands[commandCount - 1].tick;
+
+    // Commands of the same tick are played together.
+    int next = 0;
+    for (uint32_t tick = 0; tick <= lastTick; tick++)
+    {
+        int first = next;
+        bool capture = false;
+        for (; next < commandCount && commands[next].tick == tick; next++)
+        {
+            PushInput(&commands[next]);
+            capture = capture || commands[next].kind == GOLDEN_CAPTURE;
+        }
+
+        runTick(tick);
+
+        SDL_Rect viewport;
+        Render_GetViewport(&viewport);
+        if (capture)
+        {
+            pixels.resize((size_t)viewport.w * viewport.h * 4);
+            Render_RequestCapture(pixels.data(), viewport.w, viewport.h, viewport.w * 4);
+        }
+
+        uint64_t start = SDL_GetPerformanceCounter();
+        bool presented = drawFrame(tick);
+        double renderMilliseconds = ((SDL_GetPerformanceCounter() - start) * 1000.0) / frequency;
+
+        if (capture)
+        {
+            if (Render_CaptureFinished())
+                success = SaveCaptures(first, next, pixels.data(), viewport.w, viewport.h, renderMilliseconds, options) && success;
+            else
+            {
+                LOG_ERROR(LOG_CATEGORY_MAIN, "Golden: the frame after tick %u could not be captured", tick);
+                success = false;
+            }
+        }
+        else if (presented)
+        {
+            GOLDEN_FRAME frame = { tick, renderMilliseconds };
+            frames.push_back(frame);
+        }
+    }
+
+    GOLDEN_STATISTIC statistics[SDL_arraysize(statisticNames)];
+    ComputeStatistics(frames, statistics);
+    LOG_INFO(LOG_CATEGORY_MAIN, "Golden: %u ticks, %u frames presented, median %.3f ms, p95 %.3f ms",
+        lastTick + 1, (uint32_t)frames.size(), statistics[1].renderMilliseconds, statistics[2].renderMilliseconds);
+
+    char path[GOLDEN_PATH_LENGTH];
+    SDL_snprintf(path, sizeof(path), "%s/%s", options->outputDirectory, GOLDEN_TIMING_FILE);
+    if (!WriteTiming(path, frames, statistics))
+    {
+        LOG_ERROR(LOG_CATEGORY_MAIN, "Golden: could not write " GOLDEN_TIMING_FILE);
+        success = false;
+    }
+
+    if (options->baselineDirectory != NULL)
+    {
+        SDL_snprintf(path, sizeof(path), "%s/%s", options->baselineDirectory, GOLDEN_TIMING_FILE);
+        success = CompareTiming(path, statistics, options->thresholdPercent) && success;
+    }
+
+    return success;
+}
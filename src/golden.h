@@ -0,0 +1,57 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+// Median or 95th percentile render time slower than the baseline by more than this many percent counts as a regression.
+#define GOLDEN_DEFAULT_THRESHOLD_PERCENT (20.0)
+
+
+typedef struct
+{
+    // One command per line, "<tick> <command> [argument]":
+    //   <tick> click <square>   Left click on a square, e.g. "12 click e2".
+    //   <tick> key <name>       Press and release a key, by its SDL name, e.g. "40 key t".
+    //   <tick> capture <name>   Save the frame drawn after that tick as <name>.png.
+    // Empty lines and lines starting with # are skipped. The run ends after the last command.
+    const char *scriptPath;
+    // Must exist. Receives the captures, images of their differences and timing.json.
+    const char *outputDirectory;
+    // Compare with the output of an earlier run in this directory, when not NULL.
+    const char *baselineDirectory;
+    // Channels that differ from the baseline by at most this much still match.
+    int channelTolerance;
+    double thresholdPercent;
+} GOLDEN_OPTIONS;
+
+// Run the input and logic of one tick.
+typedef void (*GOLDEN_TICK_FUNCTION)(uint32_t tick);
+// Draw a frame after the given tick. Returns false if nothing changed and the frame was skipped.
+typedef bool (*GOLDEN_DRAW_FUNCTION)(uint32_t tick);
+
+
+// Play the script one tick at a time as fast as possible, capturing frames and timing every presented one.
+// Every subsystem must be initialized, with the render backend drawing offscreen.
+// Returns false if the script could not be run, or a capture or the timings did not match the baseline.
+bool Golden_Run(const GOLDEN_OPTIONS *options, GOLDEN_TICK_FUNCTION runTick, GOLDEN_DRAW_FUNCTION drawFrame);
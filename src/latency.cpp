@@ -0,0 +1,135 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "latency.h"
+#include "logger.h"
+#include "SDL.h"
+
+
+static LATENCY_HISTOGRAM histograms[LATENCY_KIND_COUNT];
+
+static const char *kindNames[LATENCY_KIND_COUNT] =
+{
+    "none",
+    "select",
+    "move",
+    "resize",
+    "resize_sharp"
+};
+
+
+// The upper edge of the bucket that holds the given fraction of the samples, in milliseconds.
+static uint32_t Percentile(const LATENCY_HISTOGRAM *histogram, double fraction)
+{
+    uint32_t target = (uint32_t)(histogram->count * fraction);
+    uint32_t seen = 0;
+
+    for (uint32_t i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        seen += histogram->buckets[i];
+        if (seen > target)
+            return i + 1;
+    }
+
+    return LATENCY_BUCKET_COUNT;
+}
+
+
+bool Latency_Init(void)
+{
+    memset(histograms, 0, sizeof(histograms));
+    return true;
+}
+
+
+void Latency_Quit(void)
+{
+    Latency_LogStatistics();
+}
+
+
+void Latency_Record(LATENCY_KIND kind, uint64_t inputTime)
+{
+    uint64_t now = SDL_GetPerformanceCounter();
+    double milliseconds = 0.0;
+    if (now > inputTime)
+        milliseconds = ((now - inputTime) * 1000.0) / SDL_GetPerformanceFrequency();
+
+    LATENCY_HISTOGRAM *histogram = &histograms[kind];
+
+    uint32_t bucket = (uint32_t)milliseconds;
+    if (bucket >= LATENCY_BUCKET_COUNT)
+        bucket = LATENCY_BUCKET_COUNT - 1;
+    histogram->buckets[bucket]++;
+
+    if (histogram->count == 0 || milliseconds < histogram->minimum)
+        histogram->minimum = milliseconds;
+    if (histogram->count == 0 || milliseconds > histogram->maximum)
+        histogram->maximum = milliseconds;
+    histogram->sum += milliseconds;
+    histogram->count++;
+
+    LOG_DEBUG(LOG_CATEGORY_MAIN, "Input to present (%s): %.2f ms", kindNames[kind], milliseconds);
+}
+
+
+void Latency_LogStatistics(void)
+{
+    for (int kind = LATENCY_NONE + 1; kind < LATENCY_KIND_COUNT; kind++)
+    {
+        const LATENCY_HISTOGRAM *histogram = &histograms[kind];
+        if (histogram->count == 0)
+            continue;
+
+        LOG_INFO(LOG_CATEGORY_MAIN, "Input to present (%s): %u samples, mean %.2f ms, min %.2f ms, max %.2f ms, p50 <%u ms, p95 <%u ms, p99 <%u ms",
+            kindNames[kind], histogram->count, histogram->sum / histogram->count, histogram->minimum, histogram->maximum,
+            Percentile(histogram, 0.50), Percentile(histogram, 0.95), Percentile(histogram, 0.99));
+    }
+}
+
+
+bool Latency_Export(const char *path)
+{
+    SDL_RWops *file = SDL_RWFromFile(path, "w");
+    if (file == NULL)
+        return false;
+
+    char line[64];
+    int length = SDL_snprintf(line, sizeof(line), "kind,bucket_ms,count\n");
+    bool success = SDL_RWwrite(file, line, length, 1) == 1;
+
+    for (int kind = LATENCY_NONE + 1; kind < LATENCY_KIND_COUNT && success; kind++)
+    {
+        for (uint32_t i = 0; i < LATENCY_BUCKET_COUNT && success; i++)
+        {
+            if (histograms[kind].buckets[i] == 0)
+                continue;
+
+            length = SDL_snprintf(line, sizeof(line), "%s,%u,%u\n", kindNames[kind], i, histograms[kind].buckets[i]);
+            success = SDL_RWwrite(file, line, length, 1) == 1;
+        }
+    }
+
+    if (SDL_RWclose(file) != 0)
+        success = false;
+
+    return success;
+}
@@ -0,0 +1,65 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+// Histogram buckets are one millisecond wide. The last bucket holds everything slower.
+#define LATENCY_BUCKET_COUNT (250)
+
+
+// What the input caused, as seen by the player.
+typedef enum {
+    LATENCY_NONE,
+    // A click that selected or unselected a square.
+    LATENCY_SELECT,
+    // A click that moved a piece.
+    LATENCY_MOVE,
+    // A window resize, until a frame of the new size is presented.
+    LATENCY_RESIZE,
+    // A window resize, until the pieces are drawn rasterized for the new size rather than scaled.
+    LATENCY_RESIZE_SHARP,
+    LATENCY_KIND_COUNT
+} LATENCY_KIND;
+
+typedef struct
+{
+    uint32_t buckets[LATENCY_BUCKET_COUNT];
+    uint32_t count;
+    double sum;
+    double minimum;
+    double maximum;
+} LATENCY_HISTOGRAM;
+
+
+bool Latency_Init(void);
+void Latency_Quit(void);
+
+// Render thread: an input that arrived at the given performance counter value is now on screen.
+void Latency_Record(LATENCY_KIND kind, uint64_t inputTime);
+
+// Log the sample count, mean, extremes and percentiles of every histogram.
+void Latency_LogStatistics(void);
+
+// Write every histogram to a CSV file.
+bool Latency_Export(const char *path);
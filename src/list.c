@@ -19,6 +19,7 @@
 */
 
 #include "list.h"
+#include "memtrack.h"
 
 
 typedef struct Node
@@ -28,27 +29,80 @@ typedef struct Node
     struct Node *previous;
 } Node;
 
+// Nodes are allocated from pages of contiguous nodes owned by the list.
+// Freed nodes go onto a free list and are reused; pages are only released when the list is destroyed.
+#define NODES_PER_PAGE (64)
+
+typedef struct NodePage
+{
+    struct NodePage *next;
+    Node nodes[NODES_PER_PAGE];
+} NodePage;
+
+// Array lists start with this many slots and double whenever they are full.
+// The capacity is always a power of two, so positions wrap around with a mask.
+#define ARRAY_INITIAL_CAPACITY (16)
+
 typedef struct List
 {
+    LIST_KIND kind;
     size_t count;
+
+    // LIST_KIND_LINKED
     Node *head;
     Node *tail;
+
+    NodePage *pages;
+    // Unused nodes, linked through their next field.
+    Node *freeNodes;
+
+    // LIST_KIND_ARRAY
+    void **items;
+    size_t capacity;
+    // Position of the first item in the ring.
+    size_t first;
 } List;
 
 
 // Internal function.
-// Allocates a new node and initializes its item field.
-static Node* CreateNode(void *newItem)
+// Takes a node from the free list, adding a page of nodes if it is empty, and initializes its item field.
+static Node* CreateNode(List *linkedList, void *newItem)
 {
-    Node *newNode = malloc(sizeof(Node));
+    if (linkedList->freeNodes == NULL)
+    {
+        NodePage *newPage = Memory_Allocate(sizeof(NodePage));
+        if (newPage == NULL)
+            return NULL;
+
+        newPage->next = linkedList->pages;
+        linkedList->pages = newPage;
 
-    if (newNode != NULL)
-        newNode->item = newItem;
+        // Thread the new nodes onto the free list in address order.
+        for (size_t i = 0; i < NODES_PER_PAGE - 1; i++)
+            newPage->nodes[i].next = &newPage->nodes[i + 1];
+        newPage->nodes[NODES_PER_PAGE - 1].next = NULL;
+
+        linkedList->freeNodes = &newPage->nodes[0];
+    }
+
+    Node *newNode = linkedList->freeNodes;
+    linkedList->freeNodes = newNode->next;
+
+    newNode->item = newItem;
 
     return newNode;
 }
 
 
+// Internal function.
+// Returns a node to the free list.
+static void DestroyNode(List *linkedList, Node *node)
+{
+    node->next = linkedList->freeNodes;
+    linkedList->freeNodes = node;
+}
+
+
 // Internal function.
 // Gets the node at the specified index.
 static Node* GetNodeAt(List *linkedList, size_t index)
@@ -82,6 +136,101 @@ static Node* GetNodeAt(List *linkedList, size_t index)
 }
 
 
+// Internal function.
+// Gets the slot of the item at the specified index of an array list.
+static void** ArraySlot(List *arrayList, size_t index)
+{
+    return &arrayList->items[(arrayList->first + index) & (arrayList->capacity - 1)];
+}
+
+
+// Internal function.
+// Makes room for one more item in an array list, keeping the items in order.
+static bool ArrayReserve(List *arrayList)
+{
+    if (arrayList->count < arrayList->capacity)
+        return true;
+
+    size_t newCapacity = arrayList->capacity == 0 ? ARRAY_INITIAL_CAPACITY : arrayList->capacity * 2;
+    void **newItems = Memory_Allocate(newCapacity * sizeof(void*));
+    if (newItems == NULL)
+        return false;
+
+    // Unwrap the ring into the start of the new storage.
+    for (size_t i = 0; i < arrayList->count; i++)
+        newItems[i] = *ArraySlot(arrayList, i);
+
+    Memory_Free(arrayList->items);
+    arrayList->items = newItems;
+    arrayList->capacity = newCapacity;
+    arrayList->first = 0;
+
+    return true;
+}
+
+
+// Internal function.
+// Inserts an item into an array list, moving whichever side of the index is shorter.
+static bool ArrayAdd(List *arrayList, size_t index, void *newItem)
+{
+    if (index > arrayList->count)
+        return false;
+
+    if (!ArrayReserve(arrayList))
+        return false;
+
+    if (index < arrayList->count / 2)
+    {
+        // Move the items before the index one slot towards the front.
+        arrayList->first = (arrayList->first - 1) & (arrayList->capacity - 1);
+        for (size_t i = 0; i < index; i++)
+            *ArraySlot(arrayList, i) = *ArraySlot(arrayList, i + 1);
+    }
+    else
+    {
+        // Move the items from the index on one slot towards the back.
+        for (size_t i = arrayList->count; i > index; i--)
+            *ArraySlot(arrayList, i) = *ArraySlot(arrayList, i - 1);
+    }
+
+    *ArraySlot(arrayList, index) = newItem;
+    arrayList->count++;
+
+    return true;
+}
+
+
+// Internal function.
+// Removes an item from an array list, moving whichever side of the index is shorter.
+static bool ArrayRemove(List *arrayList, size_t index, void **removedItem)
+{
+    if (removedItem == NULL)
+        return false;
+    if (index >= arrayList->count)
+        return false;
+
+    *removedItem = *ArraySlot(arrayList, index);
+
+    if (index < arrayList->count / 2)
+    {
+        // Move the items before the index one slot towards the back.
+        for (size_t i = index; i > 0; i--)
+            *ArraySlot(arrayList, i) = *ArraySlot(arrayList, i - 1);
+        arrayList->first = (arrayList->first + 1) & (arrayList->capacity - 1);
+    }
+    else
+    {
+        // Move the items after the index one slot towards the front.
+        for (size_t i = index; i < arrayList->count - 1; i++)
+            *ArraySlot(arrayList, i) = *ArraySlot(arrayList, i + 1);
+    }
+
+    arrayList->count--;
+
+    return true;
+}
+
+
 static bool RemoveFirstInternal(void *list, void **removedItem, void **lastNode)
 {
     if (list == NULL)
@@ -101,7 +250,7 @@ static bool RemoveFirstInternal(void *list, void **removedItem, void **lastNode)
     linkedList->head = newHead;
 
     *removedItem = nodeToDelete->item;
-    free(nodeToDelete);
+    DestroyNode(linkedList, nodeToDelete);
 
     // List is now empty.
     if (linkedList->head == NULL)
@@ -140,7 +289,7 @@ static bool RemoveLastInternal(void *list, void **removedItem, void **lastNode)
     linkedList->tail = newTail;
 
     *removedItem = nodeToDelete->item;
-    free(nodeToDelete);
+    DestroyNode(linkedList, nodeToDelete);
 
     // List is now empty.
     if (linkedList->tail == NULL)
@@ -197,7 +346,7 @@ static bool RemoveInternal(void *list, size_t index, void **removedItem, void **
         Node *rightNode = centerNode->next;
 
         *removedItem = centerNode->item;
-        free(centerNode);
+        DestroyNode(linkedList, centerNode);
 
         leftNode->next = rightNode;
         rightNode->previous = leftNode;
@@ -216,13 +365,25 @@ static bool RemoveInternal(void *list, size_t index, void **removedItem, void **
 
 void* List_Create(void)
 {
-    List *newList = malloc(sizeof(List));
+    return List_CreateWithKind(LIST_DEFAULT_KIND);
+}
+
+
+void* List_CreateWithKind(LIST_KIND kind)
+{
+    List *newList = Memory_Allocate(sizeof(List));
 
     if (newList != NULL)
     {
+        newList->kind = kind;
         newList->count = 0;
         newList->head = NULL;
         newList->tail = NULL;
+        newList->pages = NULL;
+        newList->freeNodes = NULL;
+        newList->items = NULL;
+        newList->capacity = 0;
+        newList->first = 0;
     }
 
     return newList;
@@ -237,8 +398,20 @@ void List_Destroy(void *list, void (*itemDestroyFunction)(void*))
     // Free all nodes and (potentially) destroy all items.
     List_Clear(list, itemDestroyFunction);
 
+    // Free the node pages.
+    NodePage *currentPage = ((List*)list)->pages;
+    while (currentPage != NULL)
+    {
+        NodePage *nextPage = currentPage->next;
+        Memory_Free(currentPage);
+        currentPage = nextPage;
+    }
+
+    // Free the item array.
+    Memory_Free(((List*)list)->items);
+
     // Free the list.
-    free(list);
+    Memory_Free(list);
 }
 
 
@@ -249,6 +422,21 @@ void List_Clear(void *list, void (*itemDestroyFunction)(void*))
 
     List *linkedList = (List*)list;
 
+    if (linkedList->kind == LIST_KIND_ARRAY)
+    {
+        // If a function to destroy items was provided, destroy the items.
+        if (itemDestroyFunction != NULL)
+        {
+            for (size_t i = 0; i < linkedList->count; i++)
+                itemDestroyFunction(*ArraySlot(linkedList, i));
+        }
+
+        // The storage is kept for reuse.
+        linkedList->count = 0;
+        linkedList->first = 0;
+        return;
+    }
+
     // Start at the head of the list.
     Node *currentNode = linkedList->head;
     Node *nextNode = NULL;
@@ -264,7 +452,7 @@ void List_Clear(void *list, void (*itemDestroyFunction)(void*))
             itemDestroyFunction(currentNode->item);
 
         // Free the current node.
-        free(currentNode);
+        DestroyNode(linkedList, currentNode);
 
         // Set the next node as the current node.
         currentNode = nextNode;
@@ -284,6 +472,9 @@ bool List_Add(void *list, size_t index, void *newItem)
 
     List *linkedList = (List*)list;
 
+    if (linkedList->kind == LIST_KIND_ARRAY)
+        return ArrayAdd(linkedList, index, newItem);
+
     // Can specify insertion at the tail of the list.
     size_t maxIndex = linkedList->count;
 
@@ -301,7 +492,7 @@ bool List_Add(void *list, size_t index, void *newItem)
     else
     {
         // Create a new node.
-        Node *centerNode = CreateNode(newItem);
+        Node *centerNode = CreateNode(linkedList, newItem);
         if (centerNode == NULL)
             return false;
 
@@ -332,15 +523,17 @@ bool List_AddFirst(void *list, void *newItem)
     if (list == NULL)
         return false;
 
+    List *linkedList = (List*)list;
+
+    if (linkedList->kind == LIST_KIND_ARRAY)
+        return ArrayAdd(linkedList, 0, newItem);
+
     // Create a new node.
-    Node *newNode = CreateNode(newItem);
+    Node *newNode = CreateNode(linkedList, newItem);
     if (newNode == NULL)
         return false;
 
 
-    List *linkedList = (List*)list;
-
-
     // If the list is empty.
     if (linkedList->head == NULL)
     {
@@ -379,15 +572,17 @@ bool List_AddLast(void *list, void *newItem)
     if (list == NULL)
         return false;
 
+    List *linkedList = (List*)list;
+
+    if (linkedList->kind == LIST_KIND_ARRAY)
+        return ArrayAdd(linkedList, linkedList->count, newItem);
+
     // Create a new node.
-    Node *newNode = CreateNode(newItem);
+    Node *newNode = CreateNode(linkedList, newItem);
     if (newNode == NULL)
         return false;
 
 
-    List *linkedList = (List*)list;
-
-
     // If the list is empty.
     if (linkedList->tail == NULL)
     {
@@ -423,18 +618,27 @@ bool List_AddLast(void *list, void *newItem)
 
 bool List_Remove(void *list, size_t index, void **removedItem)
 {
+    if (list != NULL && ((List*)list)->kind == LIST_KIND_ARRAY)
+        return ArrayRemove((List*)list, index, removedItem);
+
     return RemoveInternal(list, index, removedItem, NULL);
 }
 
 
 bool List_RemoveFirst(void *list, void **removedItem)
 {
+    if (list != NULL && ((List*)list)->kind == LIST_KIND_ARRAY)
+        return ArrayRemove((List*)list, 0, removedItem);
+
     return RemoveFirstInternal(list, removedItem, NULL);
 }
 
 
 bool List_RemoveLast(void *list, void **removedItem)
 {
+    if (list != NULL && ((List*)list)->kind == LIST_KIND_ARRAY)
+        return ArrayRemove((List*)list, ((List*)list)->count - 1, removedItem);
+
     return RemoveLastInternal(list, removedItem, NULL);
 }
 
@@ -451,7 +655,10 @@ bool List_Get(void *list, size_t index, void **existingItem)
     if (index >= linkedList->count)
         return false;
 
-    *existingItem = GetNodeAt(linkedList, index)->item;
+    if (linkedList->kind == LIST_KIND_ARRAY)
+        *existingItem = *ArraySlot(linkedList, index);
+    else
+        *existingItem = GetNodeAt(linkedList, index)->item;
 
     return true;
 }
@@ -466,10 +673,13 @@ bool List_GetFirst(void *list, void **existingItem)
 
     List *linkedList = (List*)list;
 
-    if (linkedList->head == NULL)
+    if (linkedList->count == 0)
         return false;
 
-    *existingItem = linkedList->head->item;
+    if (linkedList->kind == LIST_KIND_ARRAY)
+        *existingItem = *ArraySlot(linkedList, 0);
+    else
+        *existingItem = linkedList->head->item;
 
     return true;
 }
@@ -484,10 +694,13 @@ bool List_GetLast(void *list, void **existingItem)
 
     List *linkedList = (List*)list;
 
-    if (linkedList->tail == NULL)
+    if (linkedList->count == 0)
         return false;
 
-    *existingItem = linkedList->tail->item;
+    if (linkedList->kind == LIST_KIND_ARRAY)
+        *existingItem = *ArraySlot(linkedList, linkedList->count - 1);
+    else
+        *existingItem = linkedList->tail->item;
 
     return true;
 }
@@ -502,6 +715,15 @@ size_t List_Count(void *list)
 }
 
 
+LIST_KIND List_Kind(void *list)
+{
+    if (list == NULL)
+        return LIST_DEFAULT_KIND;
+    else
+        return ((List*)list)->kind;
+}
+
+
 
 
 typedef struct Iterator
@@ -513,22 +735,33 @@ typedef struct Iterator
     Node *current;
 } Iterator;
 
+// An iterator has to fit into the storage callers provide for List_IteratorInit.
+typedef char IteratorFitsStorage[(sizeof(Iterator) <= sizeof(LIST_ITERATOR)) ? 1 : -1];
+
 
 void* List_IteratorCreate(void *list)
 {
     if (list == NULL)
         return NULL;
 
-    Iterator *newIterator = malloc(sizeof(Iterator));
+    Iterator *newIterator = Memory_Allocate(sizeof(Iterator));
+
+    return List_IteratorInit((LIST_ITERATOR*)newIterator, list);
+}
 
-    if (newIterator != NULL)
-    {
-        newIterator->list = (List*)list;
-        newIterator->nextIsHead = true;
-        newIterator->index = 0;
-        newIterator->canRemove = false;
-        newIterator->current = NULL;
-    }
+
+void* List_IteratorInit(LIST_ITERATOR *storage, void *list)
+{
+    if (storage == NULL || list == NULL)
+        return NULL;
+
+    Iterator *newIterator = (Iterator*)storage;
+
+    newIterator->list = (List*)list;
+    newIterator->nextIsHead = true;
+    newIterator->index = 0;
+    newIterator->canRemove = false;
+    newIterator->current = NULL;
 
     return newIterator;
 }
@@ -536,7 +769,7 @@ void* List_IteratorCreate(void *list)
 
 void List_IteratorDestroy(void *iterator)
 {
-    free(iterator);
+    Memory_Free(iterator);
 }
 
 
@@ -549,6 +782,24 @@ bool List_IteratorNext(void *iterator, void **existingItem)
 
     Iterator *it = (Iterator*)iterator;
 
+    if (it->list->kind == LIST_KIND_ARRAY)
+    {
+        // Step to the next index.
+        if (it->nextIsHead)
+        {
+            it->nextIsHead = false;
+            it->index = 0;
+        }
+        else if (it->index < it->list->count)
+            it->index++;
+
+        it->canRemove = it->index < it->list->count;
+        if (it->canRemove)
+            *existingItem = *ArraySlot(it->list, it->index);
+
+        return it->canRemove;
+    }
+
     // Jump to the list head.
     if (it->nextIsHead)
     {
@@ -597,19 +848,38 @@ bool List_IteratorRemove(void *iterator, void **removedItem)
     if (!it->canRemove)
         return false;
 
+    if (it->list->kind == LIST_KIND_ARRAY)
+    {
+        if (!ArrayRemove(it->list, it->index, removedItem))
+            return false;
+
+        it->canRemove = false;
+
+        // The next item has moved into the removed item's index.
+        if (it->index == 0)
+            it->nextIsHead = true;
+        else
+            it->index--;
+
+        return true;
+    }
+
     // Remove the item.
-    Node *lastNode;
+    void *lastNode;
     if (!RemoveInternal((void*)it->list, it->index, removedItem, &lastNode))
         return false;
 
     // Point to the node before the removed node.
-    it->current = lastNode;
+    it->current = (Node*)lastNode;
     it->canRemove = false;
 
     // Special conditions.
-    // List is empty, so next node is head.
+    // Removed the head, so next node is head.
     if (lastNode == NULL)
         it->nextIsHead = true;
+    // The node before the removed node has the index before it.
+    else
+        it->index--;
 
     return true;
 }
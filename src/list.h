@@ -30,7 +30,22 @@ extern "C"
 #endif
 
 
+// How a list stores its items.
+typedef enum {
+    // Doubly linked nodes: O(1) insertion and removal next to an iterator, O(n) indexed access.
+    LIST_KIND_LINKED,
+    // Growable ring buffer: contiguous items, O(1) indexed access and O(1) insertion and removal at both ends.
+    LIST_KIND_ARRAY
+} LIST_KIND;
+
+// The kind of list List_Create makes. Define LIST_DEFAULT_KIND to change it for the whole build.
+#ifndef LIST_DEFAULT_KIND
+#define LIST_DEFAULT_KIND LIST_KIND_LINKED
+#endif
+
+
 void* List_Create(void);
+void* List_CreateWithKind(LIST_KIND kind);
 void List_Destroy(void *list, void (*itemDestroyFunction)(void*));
 
 void List_Clear(void *list, void (*itemDestroyFunction)(void*));
@@ -48,11 +63,22 @@ bool List_GetFirst(void *list, void **existingItem);
 bool List_GetLast(void *list, void **existingItem);
 
 size_t List_Count(void *list);
+LIST_KIND List_Kind(void *list);
+
+
+// Storage for an iterator that does not need to be allocated, such as one on the stack.
+typedef struct
+{
+    void *reserved[5];
+} LIST_ITERATOR;
 
 
 void* List_IteratorCreate(void *list);
 void List_IteratorDestroy(void *iterator);
 
+// Initialize an iterator in caller-provided storage. It must not be passed to List_IteratorDestroy.
+void* List_IteratorInit(LIST_ITERATOR *storage, void *list);
+
 bool List_IteratorNext(void *iterator, void **existingItem);
 bool List_IteratorRemove(void *iterator, void **removedItem);
 
@@ -0,0 +1,445 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "logger.h"
+#include "SDL.h"
+
+
+// Records per thread queue. Must be a power of two.
+#define LOG_QUEUE_CAPACITY (256)
+// Threads that can log at once. Further threads have their records dropped until one exits.
+#define LOG_MAX_THREADS (32)
+// How often the background thread drains the queues.
+#define LOG_FLUSH_INTERVAL_MS (5)
+#define LOG_LINE_LENGTH (512)
+
+
+// Single producer, single consumer ring of records.
+// Only the owning thread advances tail. Only the background thread advances head.
+typedef struct LogQueue
+{
+    SDL_atomic_t head;
+    SDL_atomic_t tail;
+    LOG_RECORD records[LOG_QUEUE_CAPACITY];
+} LogQueue;
+
+typedef enum {
+    LOG_SLOT_FREE,
+    LOG_SLOT_OWNED,
+    // The owning thread has exited. Freed for reuse once its queue is drained.
+    LOG_SLOT_RELEASED
+} LOG_SLOT_STATE;
+
+// A queue stays with its slot and is reused by the next thread to claim it, until Log_Quit.
+typedef struct
+{
+    LogQueue *queue;
+    SDL_atomic_t state;
+} LogSlot;
+
+
+int logCategoryLevels[LOG_CATEGORY_COUNT] =
+{
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_INFO
+};
+
+static const char *categoryNames[LOG_CATEGORY_COUNT] =
+{
+    "Main",
+    "Game",
+    "Render",
+    "Asset"
+};
+
+static LogSlot logSlots[LOG_MAX_THREADS];
+static SDL_atomic_t droppedRecords;
+// Bumped by Log_Quit, so threads that outlived the logger drop their freed queues.
+static SDL_atomic_t logGeneration;
+
+// The calling thread's claim on a slot. Handed back when the thread exits.
+struct ThreadQueue
+{
+    LogQueue *queue = NULL;
+    int slot = 0;
+    int generation = 0;
+
+    ~ThreadQueue()
+    {
+        if (queue == NULL || generation != SDL_AtomicGet(&logGeneration))
+            return;
+
+        // The last records must be visible before the slot is released.
+        SDL_MemoryBarrierRelease();
+        SDL_AtomicSet(&logSlots[slot].state, LOG_SLOT_RELEASED);
+    }
+};
+
+static thread_local ThreadQueue threadQueue;
+
+static SDL_Thread *logThread = NULL;
+static SDL_atomic_t logThreadRunning;
+static uint64_t startTime;
+
+
+// Internal function.
+// Format a single conversion specification with an argument of the recorded type.
+// Length modifiers in the format are replaced with the ones matching the recorded type.
+static int FormatArgument(char *buffer, size_t size, const char *flags, size_t flagsLength, char conversion, const LOG_RECORD *record, const LOG_ARGUMENT *argument)
+{
+    char specification[32];
+    if (flagsLength > sizeof(specification) - 5)
+        flagsLength = sizeof(specification) - 5;
+
+    specification[0] = '%';
+    memcpy(&specification[1], flags, flagsLength);
+    char *end = &specification[1 + flagsLength];
+
+    bool isFloating = strchr("fFeEgGaA", conversion) != NULL;
+
+    switch (argument->type)
+    {
+    case LOG_ARGUMENT_SIGNED:
+    case LOG_ARGUMENT_UNSIGNED:
+        if (isFloating)
+        {
+            end[0] = conversion;
+            end[1] = '\0';
+            double value = (argument->type == LOG_ARGUMENT_SIGNED) ? (double)argument->value.s : (double)argument->value.u;
+            return SDL_snprintf(buffer, size, specification, value);
+        }
+
+        end[0] = 'l';
+        end[1] = 'l';
+        if (conversion == 'd' || conversion == 'i' || conversion == 'u' || conversion == 'x' || conversion == 'X' || conversion == 'o')
+            end[2] = conversion;
+        else
+            end[2] = (argument->type == LOG_ARGUMENT_SIGNED) ? 'd' : 'u';
+        end[3] = '\0';
+
+        if (argument->type == LOG_ARGUMENT_SIGNED)
+            return SDL_snprintf(buffer, size, specification, (long long)argument->value.s);
+        else
+            return SDL_snprintf(buffer, size, specification, (unsigned long long)argument->value.u);
+
+    case LOG_ARGUMENT_DOUBLE:
+        if (isFloating)
+        {
+            end[0] = conversion;
+            end[1] = '\0';
+            return SDL_snprintf(buffer, size, specification, argument->value.d);
+        }
+
+        end[0] = 'g';
+        end[1] = '\0';
+        return SDL_snprintf(buffer, size, specification, argument->value.d);
+
+    case LOG_ARGUMENT_STRING:
+        end[0] = 's';
+        end[1] = '\0';
+        return SDL_snprintf(buffer, size, specification, &record->strings[argument->value.string]);
+
+    default:
+        end[0] = 'p';
+        end[1] = '\0';
+        return SDL_snprintf(buffer, size, specification, argument->value.pointer);
+    }
+}
+
+
+// Internal function.
+// Expand a record's format string with its recorded arguments.
+static void FormatRecord(const LOG_RECORD *record, char *line, size_t size)
+{
+    size_t length = 0;
+    int argumentIndex = 0;
+
+    // Prefix with the time since the logger started and the category.
+    double seconds = (record->timestamp - startTime) / (double)SDL_GetPerformanceFrequency();
+    int written = SDL_snprintf(line, size, "[%10.6f] %s: ", seconds, categoryNames[record->category]);
+    if (written > 0)
+        length = ((size_t)written < size) ? (size_t)written : size - 1;
+
+    const char *p = record->format;
+    while (*p != '\0' && length < size - 1)
+    {
+        if (*p != '%')
+        {
+            line[length++] = *p++;
+            continue;
+        }
+
+        if (p[1] == '%')
+        {
+            line[length++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // Flags, width and precision are kept.
+        const char *flags = ++p;
+        while (*p != '\0' && strchr("-+ #0123456789.", *p) != NULL)
+            p++;
+        size_t flagsLength = p - flags;
+
+        // Length modifiers are dropped.
+        while (*p != '\0' && strchr("hljztL", *p) != NULL)
+            p++;
+
+        if (*p == '\0')
+            break;
+        char conversion = *p++;
+
+        if (argumentIndex >= record->argumentCount)
+        {
+            written = SDL_snprintf(&line[length], size - length, "<missing>");
+        }
+        else
+        {
+            written = FormatArgument(&line[length], size - length, flags, flagsLength, conversion, record, &record->arguments[argumentIndex]);
+            argumentIndex++;
+        }
+
+        if (written > 0)
+        {
+            length += written;
+            if (length >= size)
+                length = size - 1;
+        }
+    }
+
+    line[length] = '\0';
+}
+
+
+// Internal function.
+static void WriteRecord(const LOG_RECORD *record)
+{
+    static const SDL_LogPriority priorities[] =
+    {
+        SDL_LOG_PRIORITY_DEBUG,
+        SDL_LOG_PRIORITY_INFO,
+        SDL_LOG_PRIORITY_WARN,
+        SDL_LOG_PRIORITY_ERROR
+    };
+
+    char line[LOG_LINE_LENGTH];
+    FormatRecord(record, line, sizeof(line));
+
+    SDL_LogMessage(SDL_LOG_CATEGORY_APPLICATION, priorities[record->level], "%s", line);
+}
+
+
+// Internal function.
+// Give the calling thread a queue of its own, the first time it logs.
+// Returns NULL while every slot is taken.
+static LogQueue* GetThreadQueue(void)
+{
+    int generation = SDL_AtomicGet(&logGeneration);
+    if (threadQueue.queue != NULL && threadQueue.generation == generation)
+        return threadQueue.queue;
+
+    threadQueue.queue = NULL;
+
+    for (int i = 0; i < LOG_MAX_THREADS; i++)
+    {
+        LogSlot *slot = &logSlots[i];
+        if (!SDL_AtomicCAS(&slot->state, LOG_SLOT_FREE, LOG_SLOT_OWNED))
+            continue;
+
+        // Reuse the queue left by the last owner. The background thread emptied it before freeing the slot.
+        LogQueue *queue = (LogQueue*)SDL_AtomicGetPtr((void**)&slot->queue);
+        if (queue == NULL)
+        {
+            queue = (LogQueue*)calloc(1, sizeof(LogQueue));
+            if (queue == NULL)
+            {
+                SDL_AtomicSet(&slot->state, LOG_SLOT_FREE);
+                return NULL;
+            }
+
+            // Publish the queue to the background thread.
+            SDL_MemoryBarrierRelease();
+            SDL_AtomicSetPtr((void**)&slot->queue, queue);
+        }
+
+        threadQueue.queue = queue;
+        threadQueue.slot = i;
+        threadQueue.generation = generation;
+        return queue;
+    }
+
+    return NULL;
+}
+
+
+// Internal function.
+// Write out everything currently queued. Returns the number of records written.
+static int DrainQueues(void)
+{
+    int written = 0;
+
+    for (int i = 0; i < LOG_MAX_THREADS; i++)
+    {
+        LogSlot *slot = &logSlots[i];
+        LogQueue *queue = (LogQueue*)SDL_AtomicGetPtr((void**)&slot->queue);
+        // Never claimed, or not yet published.
+        if (queue == NULL)
+            continue;
+
+        // Read before the tail, so a released queue is drained up to its owner's last record.
+        bool released = SDL_AtomicGet(&slot->state) == LOG_SLOT_RELEASED;
+        SDL_MemoryBarrierAcquire();
+
+        int head = SDL_AtomicGet(&queue->head);
+        int tail = SDL_AtomicGet(&queue->tail);
+        SDL_MemoryBarrierAcquire();
+
+        while (head != tail)
+        {
+            WriteRecord(&queue->records[head & (LOG_QUEUE_CAPACITY - 1)]);
+            head++;
+            written++;
+        }
+
+        // Hand the slots back to the producer.
+        SDL_MemoryBarrierRelease();
+        SDL_AtomicSet(&queue->head, head);
+
+        // Its owner is gone and it is empty, so another thread can have it.
+        if (released)
+        {
+            SDL_MemoryBarrierRelease();
+            SDL_AtomicSet(&slot->state, LOG_SLOT_FREE);
+        }
+    }
+
+    int dropped = SDL_AtomicSet(&droppedRecords, 0);
+    if (dropped > 0)
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Logger: Dropped %d records.", dropped);
+
+    return written;
+}
+
+
+static int SDLCALL LogThread(void *data)
+{
+    while (SDL_AtomicGet(&logThreadRunning))
+    {
+        DrainQueues();
+        SDL_Delay(LOG_FLUSH_INTERVAL_MS);
+    }
+
+    // Flush whatever was logged during shutdown.
+    DrainQueues();
+
+    return 0;
+}
+
+
+bool Log_Init(void)
+{
+    startTime = SDL_GetPerformanceCounter();
+
+    SDL_AtomicSet(&logThreadRunning, 1);
+    logThread = SDL_CreateThread(LogThread, "log", NULL);
+    if (logThread == NULL)
+    {
+        SDL_AtomicSet(&logThreadRunning, 0);
+        return false;
+    }
+
+    return true;
+}
+
+
+void Log_Quit(void)
+{
+    if (logThread == NULL)
+        return;
+
+    SDL_AtomicSet(&logThreadRunning, 0);
+    SDL_WaitThread(logThread, NULL);
+    logThread = NULL;
+
+    for (int i = 0; i < LOG_MAX_THREADS; i++)
+    {
+        free(logSlots[i].queue);
+        logSlots[i].queue = NULL;
+        SDL_AtomicSet(&logSlots[i].state, LOG_SLOT_FREE);
+    }
+
+    // Every thread still holding one of the queues sees this and claims a new slot, if the logger is started again.
+    SDL_AtomicIncRef(&logGeneration);
+}
+
+
+void Log_SetLevel(LOG_CATEGORY category, int level)
+{
+    logCategoryLevels[category] = level;
+}
+
+
+void Log_Push(const LOG_RECORD *record)
+{
+    // Without the background thread, write synchronously.
+    if (logThread == NULL)
+    {
+        if (startTime == 0)
+            startTime = SDL_GetPerformanceCounter();
+
+        LOG_RECORD stampedRecord = *record;
+        stampedRecord.timestamp = SDL_GetPerformanceCounter();
+        WriteRecord(&stampedRecord);
+        return;
+    }
+
+    LogQueue *queue = GetThreadQueue();
+    if (queue == NULL)
+    {
+        SDL_AtomicIncRef(&droppedRecords);
+        return;
+    }
+
+    int tail = SDL_AtomicGet(&queue->tail);
+    int head = SDL_AtomicGet(&queue->head);
+
+    // Queue is full. Never wait for the background thread.
+    if ((tail - head) >= LOG_QUEUE_CAPACITY)
+    {
+        SDL_AtomicIncRef(&droppedRecords);
+        return;
+    }
+
+    // Only copy the arguments and strings that were set.
+    LOG_RECORD *slot = &queue->records[tail & (LOG_QUEUE_CAPACITY - 1)];
+    memcpy(slot, record, offsetof(LOG_RECORD, arguments) + (record->argumentCount * sizeof(LOG_ARGUMENT)));
+    memcpy(slot->strings, record->strings, record->stringBytes);
+    slot->timestamp = SDL_GetPerformanceCounter();
+
+    // Make the record visible before the new tail.
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&queue->tail, tail + 1);
+}
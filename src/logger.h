@@ -0,0 +1,243 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+
+/*
+    Logger Notes:
+
+    Logging calls never format or write anything on the calling thread.
+    Each call packs its arguments into a fixed-size binary record and pushes
+    it onto a lock-free queue owned by the calling thread.
+    A background thread drains every queue, formats the records and hands
+    them to SDL_LogMessage.
+
+    If a queue is full the record is dropped and counted, so logging never
+    blocks a tick.
+
+    Format strings are stored by pointer and formatted later, so they must
+    outlive the call (string literals are fine). String arguments are copied
+    into the record, and cut short when they do not fit.
+*/
+
+
+#define LOG_LEVEL_DEBUG (0)
+#define LOG_LEVEL_INFO (1)
+#define LOG_LEVEL_WARN (2)
+#define LOG_LEVEL_ERROR (3)
+
+// Logging calls below this level are removed at compile time.
+#ifndef LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+// Per category overrides of LOG_COMPILE_LEVEL, so one category can keep its debug logging in a release build
+// or drop its noise in a debug one.
+#ifndef LOG_COMPILE_LEVEL_MAIN
+#define LOG_COMPILE_LEVEL_MAIN LOG_COMPILE_LEVEL
+#endif
+#ifndef LOG_COMPILE_LEVEL_GAME
+#define LOG_COMPILE_LEVEL_GAME LOG_COMPILE_LEVEL
+#endif
+#ifndef LOG_COMPILE_LEVEL_RENDER
+#define LOG_COMPILE_LEVEL_RENDER LOG_COMPILE_LEVEL
+#endif
+#ifndef LOG_COMPILE_LEVEL_ASSET
+#define LOG_COMPILE_LEVEL_ASSET LOG_COMPILE_LEVEL
+#endif
+
+#define LOG_MAX_ARGUMENTS (8)
+// Room in each record for the copies of its string arguments, terminators included.
+#define LOG_STRING_BYTES (128)
+
+
+typedef enum {
+    LOG_CATEGORY_MAIN,
+    LOG_CATEGORY_GAME,
+    LOG_CATEGORY_RENDER,
+    LOG_CATEGORY_ASSET,
+    LOG_CATEGORY_COUNT
+} LOG_CATEGORY;
+
+typedef enum {
+    LOG_ARGUMENT_SIGNED,
+    LOG_ARGUMENT_UNSIGNED,
+    LOG_ARGUMENT_DOUBLE,
+    LOG_ARGUMENT_STRING,
+    LOG_ARGUMENT_POINTER
+} LOG_ARGUMENT_TYPE;
+
+typedef struct {
+    uint8_t type;
+    union {
+        int64_t s;
+        uint64_t u;
+        double d;
+        // Offset of the copy in the record's strings.
+        uint16_t string;
+        const void *pointer;
+    } value;
+} LOG_ARGUMENT;
+
+typedef struct {
+    uint64_t timestamp;
+    const char *format;
+    uint8_t level;
+    uint8_t category;
+    uint8_t argumentCount;
+    uint16_t stringBytes;
+    LOG_ARGUMENT arguments[LOG_MAX_ARGUMENTS];
+    char strings[LOG_STRING_BYTES];
+} LOG_RECORD;
+
+
+// Compile time level of a category. Categories are always constants at the call site,
+// so the check in LOG_AT folds away along with the call.
+constexpr int Log_CompileLevel(LOG_CATEGORY category)
+{
+    return category == LOG_CATEGORY_MAIN ? LOG_COMPILE_LEVEL_MAIN
+        : category == LOG_CATEGORY_GAME ? LOG_COMPILE_LEVEL_GAME
+        : category == LOG_CATEGORY_RENDER ? LOG_COMPILE_LEVEL_RENDER
+        : category == LOG_CATEGORY_ASSET ? LOG_COMPILE_LEVEL_ASSET
+        : LOG_COMPILE_LEVEL;
+}
+
+// Minimum level that is written for each category. Changed at runtime with Log_SetLevel.
+extern int logCategoryLevels[LOG_CATEGORY_COUNT];
+
+bool Log_Init(void);
+void Log_Quit(void);
+
+void Log_SetLevel(LOG_CATEGORY category, int level);
+
+// Copy a finished record onto the calling thread's queue.
+void Log_Push(const LOG_RECORD *record);
+
+
+inline void Log_SetArgument(LOG_RECORD *record, LOG_ARGUMENT *argument, double value)
+{
+    argument->type = LOG_ARGUMENT_DOUBLE;
+    argument->value.d = value;
+}
+
+inline void Log_SetArgument(LOG_RECORD *record, LOG_ARGUMENT *argument, float value)
+{
+    Log_SetArgument(record, argument, (double)value);
+}
+
+inline void Log_SetArgument(LOG_RECORD *record, LOG_ARGUMENT *argument, const char *value)
+{
+    if (value == NULL)
+        value = "(null)";
+
+    // Once the strings are full, later ones share the terminator at the very end.
+    size_t offset = record->stringBytes;
+    if (offset >= LOG_STRING_BYTES)
+        offset = LOG_STRING_BYTES - 1;
+
+    size_t length = strlen(value);
+    if (length > LOG_STRING_BYTES - 1 - offset)
+        length = LOG_STRING_BYTES - 1 - offset;
+
+    memcpy(&record->strings[offset], value, length);
+    record->strings[offset + length] = '\0';
+    record->stringBytes = (uint16_t)(offset + length + 1);
+
+    argument->type = LOG_ARGUMENT_STRING;
+    argument->value.string = (uint16_t)offset;
+}
+
+inline void Log_SetArgument(LOG_RECORD *record, LOG_ARGUMENT *argument, char *value)
+{
+    Log_SetArgument(record, argument, (const char*)value);
+}
+
+inline void Log_SetArgument(LOG_RECORD *record, LOG_ARGUMENT *argument, const void *value)
+{
+    argument->type = LOG_ARGUMENT_POINTER;
+    argument->value.pointer = value;
+}
+
+// Integers, booleans and enumerations.
+template<typename T>
+inline void Log_SetArgument(LOG_RECORD *record, LOG_ARGUMENT *argument, T value)
+{
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "Unsupported log argument type.");
+
+    if (std::is_signed<T>::value || std::is_enum<T>::value)
+    {
+        argument->type = LOG_ARGUMENT_SIGNED;
+        argument->value.s = (int64_t)value;
+    }
+    else
+    {
+        argument->type = LOG_ARGUMENT_UNSIGNED;
+        argument->value.u = (uint64_t)value;
+    }
+}
+
+inline void Log_PackArguments(LOG_RECORD *record)
+{
+}
+
+template<typename T, typename... Rest>
+inline void Log_PackArguments(LOG_RECORD *record, T value, Rest... rest)
+{
+    static_assert(sizeof...(Rest) < LOG_MAX_ARGUMENTS, "Too many log arguments.");
+
+    Log_SetArgument(record, &record->arguments[record->argumentCount++], value);
+    Log_PackArguments(record, rest...);
+}
+
+template<typename... Args>
+inline void Log_Write(int level, LOG_CATEGORY category, const char *format, Args... args)
+{
+    if (level < logCategoryLevels[category])
+        return;
+
+    LOG_RECORD record;
+    record.format = format;
+    record.level = (uint8_t)level;
+    record.category = (uint8_t)category;
+    record.argumentCount = 0;
+    record.stringBytes = 0;
+    Log_PackArguments(&record, args...);
+
+    Log_Push(&record);
+}
+
+
+#define LOG_AT(level, category, ...) \
+    do { if ((level) >= Log_CompileLevel(category)) Log_Write((level), (category), __VA_ARGS__); } while (0)
+
+#define LOG_DEBUG(category, ...) LOG_AT(LOG_LEVEL_DEBUG, category, __VA_ARGS__)
+#define LOG_INFO(category, ...) LOG_AT(LOG_LEVEL_INFO, category, __VA_ARGS__)
+#define LOG_WARN(category, ...) LOG_AT(LOG_LEVEL_WARN, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) LOG_AT(LOG_LEVEL_ERROR, category, __VA_ARGS__)
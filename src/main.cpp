@@ -22,13 +22,29 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include "animation.h"
+#include "arena.h"
 #include "asset.h"
+#include "bench.h"
 #include "camera.h"
+#include "diagram.h"
 #include "game.h"
+#include "golden.h"
 #include "input.h"
+#include "latency.h"
 #include "list.h"
+#include "logger.h"
 #include "main.h"
+#include "memtrack.h"
+#include "meshraster.h"
+#include "mipchain.h"
+#include "model.h"
+#include "raster.h"
 #include "render.h"
+#include "renderbackend.h"
+#include "snapshot.h"
+#include "spritecache.h"
+#include "timestep.h"
 #include "SDL.h"
 
 
@@ -36,53 +52,466 @@
 #define WINDOW_DEFAULT_WIDTH (512)
 #define WINDOW_DEFAULT_HEIGHT (512)
 
-#define TICKS_PER_SECOND (60)
-#define MS_PER_TICK (1000 / TICKS_PER_SECOND)
+#define DEFAULT_TICKS_PER_SECOND (60)
+// Never run more than this many logic ticks to catch up before rendering a frame.
+#define DEFAULT_MAX_CATCH_UP_TICKS (5)
 
 #define FIRST_AVAILABLE_DEVICE (-1)
 
+// Room for the copies of the events gathered between two logic ticks.
+#define EVENT_ARENA_SIZE (256 * 1024)
 
-bool isRunning = false;
+
+SDL_atomic_t isRunning;
 void *sdlEventBuffer = NULL;
 SDL_Window *sdlWindow = NULL;
 SDL_Renderer *sdlRenderer;
+uint32_t ticksPerSecond = DEFAULT_TICKS_PER_SECOND;
+
+static uint32_t maxCatchUpTicks = DEFAULT_MAX_CATCH_UP_TICKS;
+
+// Events gathered by the input function that the game logic has not yet taken.
+static void *pendingEventBuffer = NULL;
+static SDL_mutex *eventBufferMutex = NULL;
+// Events thrown away because the event arena was full.
+static uint32_t droppedEvents = 0;
+
+// The event copies of each buffer live in an arena that is swapped along with it.
+static ARENA eventArenas[2];
+static ARENA *sdlEventArena = &eventArenas[0];
+static ARENA *pendingEventArena = &eventArenas[1];
+
+// Whether the game logic runs on its own thread.
+static bool threadedMode = false;
+static SDL_Thread *logicThread = NULL;
+
+// Allocation check mode: after the warm-up frames, every frame must be free of allocations.
+static uint32_t allocationCheckWarmupFrames = 0;
+static uint32_t allocationCheckFrames = 0;
+static bool allocationCheckFailed = false;
+
+// Where to write the input latency histograms on exit.
+static const char *latencyOutputPath = NULL;
+
+// Threads that rasterize the piece sprites. 0 means one per core.
+static int rasterThreads = 0;
+// Whether the rasterizers may use SIMD kernels. The output is the same either way.
+static bool rasterSIMD = true;
+
+// Resolution of the mip chain the piece sprites are resampled from. 0 rasterizes every size directly.
+static int mipMasterSize = MIP_CHAIN_DEFAULT_MASTER_SIZE;
+
+// Byte budget of the rasterized sprite cache, and whether it is kept on disk between runs.
+static size_t spriteCacheBudget = SPRITE_CACHE_DEFAULT_BUDGET;
+static bool spriteCachePersistent = true;
+
+// Benchmark mode runs the benchmarks instead of the game, drawing into an offscreen surface.
+static bool benchMode = false;
+static BENCH_OPTIONS benchOptions = { NULL, NULL, NULL, BENCH_DEFAULT_THRESHOLD_PERCENT };
+static SDL_Surface *benchSurface = NULL;
+
+// Golden mode plays a script of input offscreen, capturing frames and timing the renderer.
+static bool goldenMode = false;
+static GOLDEN_OPTIONS goldenOptions = { NULL, NULL, NULL, 0, GOLDEN_DEFAULT_THRESHOLD_PERCENT };
+
+// Which backend Render_Draw goes through. The CPU backend needs neither a GPU nor, in benchmarks, a display.
+static RENDER_BACKEND_KIND renderBackendKind = RENDER_BACKEND_SDL;
+// SDL render driver to ask for, e.g. "opengl", which the SDL backend needs to draw the 3D view.
+// Benchmarks and golden runs given one draw into a hidden window with it instead of a surface.
+static const char *renderDriver = NULL;
+// Size of what benchmarks and golden runs draw into, instead of a window.
+static int offscreenWidth = WINDOW_DEFAULT_WIDTH;
+static int offscreenHeight = WINDOW_DEFAULT_HEIGHT;
+
+// Diagram mode renders board diagrams for a file of positions instead of running the game.
+static bool diagramMode = false;
+static DIAGRAM_OPTIONS diagramOptions = { NULL, NULL, DIAGRAM_DEFAULT_SIZE, DIAGRAM_FORMAT_PNG, 0 };
+
+// Allocations since the last performance statistics.
+static MEMORY_FRAME_STATS intervalMemory;
 
 
 static void DoInput(uint32_t currentTick)
 {
     SDL_Event sdlEvent;
+
+    // SDL timestamps events in milliseconds since initialization.
+    // Convert the age of each event into the performance counter time it arrived at.
+    uint64_t pollTime = SDL_GetPerformanceCounter();
+    uint32_t pollTicks = SDL_GetTicks();
+    uint64_t frequency = SDL_GetPerformanceFrequency();
+
+    // Asked at most once per poll, and only when a window event needs it.
+    int outputWidth = 0;
+    int outputHeight = 0;
+    bool outputSizeKnown = false;
+    uint32_t droppedThisPoll = 0;
+
+    SDL_LockMutex(eventBufferMutex);
     while (SDL_PollEvent(&sdlEvent))
     {
         switch (sdlEvent.type)
         {
             case SDL_QUIT:
-                isRunning = false;
+                SDL_AtomicSet(&isRunning, 0);
                 break;
             default:
-                SDL_Event *bufferedEvent = (SDL_Event*)malloc(sizeof(SDL_Event));
-                memcpy(bufferedEvent, &sdlEvent, sizeof(SDL_Event));
-                List_AddLast(sdlEventBuffer, bufferedEvent);
+            {
+                BUFFERED_EVENT *bufferedEvent = ARENA_NEW(pendingEventArena, BUFFERED_EVENT);
+                if (bufferedEvent == NULL)
+                {
+                    droppedThisPoll++;
+                    break;
+                }
+                memcpy(&bufferedEvent->event, &sdlEvent, sizeof(SDL_Event));
+
+                uint32_t age = 0;
+                if (SDL_TICKS_PASSED(pollTicks, sdlEvent.common.timestamp))
+                    age = pollTicks - sdlEvent.common.timestamp;
+                bufferedEvent->arrivalTime = pollTime - (age * frequency) / 1000;
+
+                if (sdlEvent.type == SDL_WINDOWEVENT && !outputSizeKnown)
+                {
+                    renderBackend->GetOutputSize(&outputWidth, &outputHeight);
+                    outputSizeKnown = true;
+                }
+                bufferedEvent->outputWidth = outputWidth;
+                bufferedEvent->outputHeight = outputHeight;
+
+                List_AddLast(pendingEventBuffer, bufferedEvent);
                 break;
+            }
         }
     }
+    SDL_UnlockMutex(eventBufferMutex);
+
+    if (droppedThisPoll > 0)
+    {
+        droppedEvents += droppedThisPoll;
+        LOG_WARN(LOG_CATEGORY_MAIN, "Event arena full: dropped %" PRIu32 " events (%" PRIu32 " in total)", droppedThisPoll, droppedEvents);
+    }
 }
 
 
 static void DoLogic(uint32_t currentTick)
 {
+    Arena_Reset(&logicArena);
+
+    // Take every event gathered since the last tick.
+    SDL_LockMutex(eventBufferMutex);
+    void *takenEvents = pendingEventBuffer;
+    pendingEventBuffer = sdlEventBuffer;
+    sdlEventBuffer = takenEvents;
+    ARENA *takenArena = pendingEventArena;
+    pendingEventArena = sdlEventArena;
+    sdlEventArena = takenArena;
+    SDL_UnlockMutex(eventBufferMutex);
+
+    Memory_SetSubsystem(MEMORY_SUBSYSTEM_CAMERA);
     Camera_Logic(currentTick);
+    Memory_SetSubsystem(MEMORY_SUBSYSTEM_INPUT);
     Input_Logic(currentTick);
+    Memory_SetSubsystem(MEMORY_SUBSYSTEM_GAME);
     Game_Logic(currentTick);
+    Animation_Logic(currentTick);
 
+    Memory_SetSubsystem(MEMORY_SUBSYSTEM_RENDER);
     Render_Logic(currentTick);
 
-    List_Clear(sdlEventBuffer, free);
+    Snapshot_Publish(currentTick);
+
+    Memory_SetSubsystem(MEMORY_SUBSYSTEM_OTHER);
+    List_Clear(sdlEventBuffer, NULL);
+    Arena_Reset(sdlEventArena);
+}
+
+
+// Returns false if there was nothing new to present.
+static bool DoRender(uint32_t currentTick, double interpolation)
+{
+    Arena_Reset(&renderArena);
+    Snapshot_Acquire();
+
+    Memory_SetSubsystem(MEMORY_SUBSYSTEM_RENDER);
+    bool presented = Render_Draw(currentTick, interpolation);
+    Memory_SetSubsystem(MEMORY_SUBSYSTEM_OTHER);
+
+    return presented;
+}
+
+
+// Collect the allocations of the frame that just ended.
+// In allocation check mode, a frame past the warm-up that allocates ends the run with a failure.
+static void EndFrameAllocations(uint32_t currentFrame)
+{
+    MEMORY_FRAME_STATS frameMemory;
+    Memory_EndFrame(&frameMemory);
+
+    for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++)
+    {
+        intervalMemory.allocations[i] += frameMemory.allocations[i];
+        intervalMemory.bytes[i] += frameMemory.bytes[i];
+    }
+    intervalMemory.totalAllocations += frameMemory.totalAllocations;
+    intervalMemory.totalBytes += frameMemory.totalBytes;
+
+    if (allocationCheckFrames == 0)
+        return;
+
+    if (currentFrame > allocationCheckWarmupFrames && frameMemory.totalAllocations > 0)
+    {
+        for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++)
+        {
+            if (frameMemory.allocations[i] > 0)
+                LOG_ERROR(LOG_CATEGORY_MAIN, "Frame %" PRIu32 ": %s made %" PRIu32 " allocations (%" PRIu32 " bytes)", currentFrame, Memory_SubsystemName((MEMORY_SUBSYSTEM)i), frameMemory.allocations[i], frameMemory.bytes[i]);
+        }
+        allocationCheckFailed = true;
+        SDL_AtomicSet(&isRunning, 0);
+    }
+    else if (currentFrame >= allocationCheckWarmupFrames + allocationCheckFrames)
+    {
+        LOG_INFO(LOG_CATEGORY_MAIN, "Allocation check passed: %" PRIu32 " frames without allocations", allocationCheckFrames);
+        SDL_AtomicSet(&isRunning, 0);
+    }
+}
+
+
+// Log and reset the allocations since the last performance statistics.
+static void LogAllocations(void)
+{
+    uint32_t liveAllocations;
+    uint32_t liveBytes;
+    Memory_GetLive(&liveAllocations, &liveBytes);
+
+    LOG_INFO(LOG_CATEGORY_MAIN, "Allocations: %" PRIu32 " (%" PRIu32 " bytes) Live: %" PRIu32 " (%" PRIu32 " bytes)", intervalMemory.totalAllocations, intervalMemory.totalBytes, liveAllocations, liveBytes);
+    for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++)
+    {
+        if (intervalMemory.allocations[i] > 0)
+            LOG_DEBUG(LOG_CATEGORY_MAIN, "  %s: %" PRIu32 " (%" PRIu32 " bytes)", Memory_SubsystemName((MEMORY_SUBSYSTEM)i), intervalMemory.allocations[i], intervalMemory.bytes[i]);
+    }
+
+    memset(&intervalMemory, 0, sizeof(intervalMemory));
+}
+
+
+// Fixed logic timestep on a thread of its own.
+// The render loop on the main thread only ever sees published snapshots.
+static int SDLCALL LogicThread(void *data)
+{
+    TIMESTEP logicTimestep;
+    Timestep_Init(&logicTimestep, ticksPerSecond, maxCatchUpTicks);
+
+    uint32_t currentTick = 0;
+    uint32_t lastMeasurementTick = 0;
+    while (SDL_AtomicGet(&isRunning))
+    {
+        uint32_t dueTicks = Timestep_Advance(&logicTimestep);
+        for (uint32_t i = 0; i < dueTicks; i++)
+        {
+            DoLogic(currentTick);
+
+            currentTick++;
+        }
+
+        // Performance statistics.
+        // At least one second before logging.
+        if ((currentTick - lastMeasurementTick) >= ticksPerSecond)
+        {
+            lastMeasurementTick = currentTick;
+            Timestep_LogStatistics(&logicTimestep, "Logic");
+            Timestep_ResetStatistics(&logicTimestep);
+        }
+
+        // Sleep until the next tick is due.
+        SDL_Delay(Timestep_MillisecondsUntilNextTick(&logicTimestep));
+    }
+
+    return 0;
 }
 
 
-static void DoRender(uint32_t currentTick, double interpolation)
+// How far the render thread is past the latest snapshot, in ticks.
+static double SnapshotInterpolation(void)
 {
-    Render_Draw(currentTick, interpolation);
+    uint64_t elapsedCounts = SDL_GetPerformanceCounter() - Snapshot_Current()->publishTime;
+    double interpolation = (elapsedCounts * (double)ticksPerSecond) / SDL_GetPerformanceFrequency();
+
+    if (interpolation > 1.0)
+        interpolation = 1.0;
+
+    return interpolation;
+}
+
+
+// Game Loop
+// Fixed Logic Timestep, Variable Rendering
+// Robert Nystrom's Game Programming Patterns
+// http://gameprogrammingpatterns.com/game-loop.html
+// Glenn Fiedler's Fix Your Timestep!
+// https://gafferongames.com/post/fix_your_timestep/
+static void RunGameLoop(void)
+{
+    // Performance statistics.
+    uint32_t currentFramesPerSecond = 0;
+    uint32_t lastMeasurementTick = 0;
+    uint32_t lastMeasurementFrame = 0;
+
+    // Understand that a "tick" means something different in the context of SDL, compared to the context of game logic.
+    // The SDL performance counter ticks at a platform defined frequency.
+    // A game "tick" is a logic step, with a time duration that we define.
+    TIMESTEP frameTimestep;
+    Timestep_Init(&frameTimestep, ticksPerSecond, maxCatchUpTicks);
+
+    uint32_t currentTick = 0;
+    uint32_t currentFrame = 0;
+    SDL_AtomicSet(&isRunning, 1);
+    while (SDL_AtomicGet(&isRunning))
+    {
+        uint32_t dueTicks = Timestep_Advance(&frameTimestep);
+
+
+        // Core Input Function
+        DoInput(currentTick);
+
+
+        for (uint32_t i = 0; i < dueTicks; i++)
+        {
+            // Core Logic Function
+            DoLogic(currentTick);
+
+            currentTick++;
+        }
+
+
+        // Core Render Function
+        bool presented = DoRender(currentTick, Timestep_Interpolation(&frameTimestep));
+        currentFrame++;
+        EndFrameAllocations(currentFrame);
+
+        // Without a present there is no vsync to wait on. Nothing can change before the next tick.
+        if (!presented)
+            SDL_Delay(Timestep_MillisecondsUntilNextTick(&frameTimestep));
+
+
+        // Performance statistics.
+        // At least one second before logging.
+        if ((currentTick - lastMeasurementTick) >= ticksPerSecond)
+        {
+            currentFramesPerSecond = currentFrame - lastMeasurementFrame;
+            lastMeasurementTick = currentTick;
+            lastMeasurementFrame = currentFrame;
+            LOG_INFO(LOG_CATEGORY_MAIN, "Tick: %" PRIu32 " Frame: %" PRIu32 " FPS: %" PRIu32 " Draw calls: %" PRIu32, currentTick, currentFrame, currentFramesPerSecond, Render_LastFrameDrawCalls());
+            Timestep_LogStatistics(&frameTimestep, "Frame");
+            Timestep_ResetStatistics(&frameTimestep);
+            LogAllocations();
+            Latency_LogStatistics();
+            MeshRaster_LogStatistics();
+        }
+    }
+}
+
+
+// Game logic on its own thread, rendering on the main thread.
+// The render loop draws the latest snapshot as often as the display allows.
+static bool RunThreadedLoop(void)
+{
+    // Performance statistics.
+    uint32_t currentFramesPerSecond = 0;
+    uint32_t lastMeasurementTick = 0;
+    uint32_t lastMeasurementFrame = 0;
+
+    SDL_AtomicSet(&isRunning, 1);
+    logicThread = SDL_CreateThread(LogicThread, "logic", NULL);
+    if (logicThread == NULL)
+    {
+        SDL_AtomicSet(&isRunning, 0);
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "SDL_CreateThread", SDL_GetError(), NULL);
+        return false;
+    }
+
+    uint32_t currentTick = 0;
+    uint32_t currentFrame = 0;
+    while (SDL_AtomicGet(&isRunning))
+    {
+        // Core Input Function
+        DoInput(currentTick);
+
+
+        // Core Render Function
+        Arena_Reset(&renderArena);
+        Snapshot_Acquire();
+        currentTick = Snapshot_Current()->tick;
+        Memory_SetSubsystem(MEMORY_SUBSYSTEM_RENDER);
+        bool presented = Render_Draw(currentTick, SnapshotInterpolation());
+        Memory_SetSubsystem(MEMORY_SUBSYSTEM_OTHER);
+        currentFrame++;
+        EndFrameAllocations(currentFrame);
+
+        // Without a present there is no vsync to wait on; poll for the next snapshot instead.
+        if (!presented)
+            SDL_Delay(1);
+
+
+        // Performance statistics.
+        // At least one second before logging.
+        if ((currentTick - lastMeasurementTick) >= ticksPerSecond)
+        {
+            currentFramesPerSecond = currentFrame - lastMeasurementFrame;
+            lastMeasurementTick = currentTick;
+            lastMeasurementFrame = currentFrame;
+            LOG_INFO(LOG_CATEGORY_MAIN, "Tick: %" PRIu32 " Frame: %" PRIu32 " FPS: %" PRIu32 " Draw calls: %" PRIu32, currentTick, currentFrame, currentFramesPerSecond, Render_LastFrameDrawCalls());
+            LogAllocations();
+            Latency_LogStatistics();
+            MeshRaster_LogStatistics();
+        }
+    }
+
+    SDL_WaitThread(logicThread, NULL);
+    logicThread = NULL;
+
+    return true;
+}
+
+
+// One tick of a golden run: the scripted input, then the logic.
+static void GoldenTick(uint32_t tick)
+{
+    DoInput(tick);
+    DoLogic(tick);
+}
+
+
+// Frames are drawn exactly at the tick, so animations look the same in every run.
+static bool GoldenDraw(uint32_t tick)
+{
+    return DoRender(tick + 1, 0.0);
+}
+
+
+// Only the subsystems that diagrams need. No window, renderer or video subsystem is created.
+static bool RunDiagramMode(void)
+{
+    bool success = false;
+
+    Memory_SetSubsystem(MEMORY_SUBSYSTEM_ASSET);
+    bool assetsLoaded = Asset_Init();
+    Memory_SetSubsystem(MEMORY_SUBSYSTEM_OTHER);
+
+    if (!assetsLoaded)
+        LOG_ERROR(LOG_CATEGORY_MAIN, "Asset_Init: Failed to initialize asset subsystem.");
+    else if (!Raster_Init(rasterThreads, rasterSIMD))
+        LOG_ERROR(LOG_CATEGORY_MAIN, "Raster_Init: Failed to initialize raster subsystem.");
+    else if (!SpriteCache_Init(spriteCacheBudget, spriteCachePersistent))
+        LOG_ERROR(LOG_CATEGORY_MAIN, "SpriteCache_Init: Failed to initialize sprite cache subsystem.");
+    else
+        success = Diagram_Run(&diagramOptions);
+
+    SpriteCache_Quit();
+    Raster_Quit();
+    if (assetsLoaded)
+        Asset_Quit();
+
+    return success;
 }
 
 
@@ -90,40 +519,201 @@ int main(int argc, char *argv[])
 {
     int retCode = EXIT_FAILURE;
 
+    for (int i = 1; i < argc; i++)
+    {
+        if (SDL_strcmp(argv[i], "--threaded") == 0)
+            threadedMode = true;
+        else if (SDL_strcmp(argv[i], "--tick-rate") == 0 && (i + 1) < argc)
+            ticksPerSecond = SDL_atoi(argv[++i]);
+        else if (SDL_strcmp(argv[i], "--max-catch-up") == 0 && (i + 1) < argc)
+            maxCatchUpTicks = SDL_atoi(argv[++i]);
+        else if (SDL_strcmp(argv[i], "--alloc-check") == 0 && (i + 2) < argc)
+        {
+            allocationCheckWarmupFrames = SDL_atoi(argv[++i]);
+            allocationCheckFrames = SDL_atoi(argv[++i]);
+        }
+        else if (SDL_strcmp(argv[i], "--raster-threads") == 0 && (i + 1) < argc)
+            rasterThreads = SDL_atoi(argv[++i]);
+        else if (SDL_strcmp(argv[i], "--no-raster-simd") == 0)
+            rasterSIMD = false;
+        else if (SDL_strcmp(argv[i], "--mip-master-size") == 0 && (i + 1) < argc)
+            mipMasterSize = SDL_atoi(argv[++i]);
+        else if (SDL_strcmp(argv[i], "--sprite-cache-mb") == 0 && (i + 1) < argc)
+            spriteCacheBudget = (size_t)SDL_atoi(argv[++i]) * 1024 * 1024;
+        else if (SDL_strcmp(argv[i], "--no-sprite-disk-cache") == 0)
+            spriteCachePersistent = false;
+        else if (SDL_strcmp(argv[i], "--cpu-renderer") == 0)
+            renderBackendKind = RENDER_BACKEND_CPU;
+        else if (SDL_strcmp(argv[i], "--render-driver") == 0 && (i + 1) < argc)
+            renderDriver = argv[++i];
+        else if (SDL_strcmp(argv[i], "--offscreen-size") == 0 && (i + 2) < argc)
+        {
+            offscreenWidth = SDL_atoi(argv[++i]);
+            offscreenHeight = SDL_atoi(argv[++i]);
+        }
+        else if (SDL_strcmp(argv[i], "--no-board-layer") == 0)
+            boardLayerEnabled = false;
+        else if (SDL_strcmp(argv[i], "--latency-out") == 0 && (i + 1) < argc)
+            latencyOutputPath = argv[++i];
+        else if (SDL_strcmp(argv[i], "--bench") == 0)
+        {
+            benchMode = true;
+            if ((i + 1) < argc && SDL_strncmp(argv[i + 1], "--", 2) != 0)
+                benchOptions.filter = argv[++i];
+        }
+        else if (SDL_strcmp(argv[i], "--diagrams") == 0 && (i + 2) < argc)
+        {
+            diagramMode = true;
+            diagramOptions.inputPath = argv[++i];
+            diagramOptions.outputDirectory = argv[++i];
+        }
+        else if (SDL_strcmp(argv[i], "--diagram-size") == 0 && (i + 1) < argc)
+            diagramOptions.size = SDL_atoi(argv[++i]);
+        else if (SDL_strcmp(argv[i], "--diagram-threads") == 0 && (i + 1) < argc)
+            diagramOptions.threadCount = SDL_atoi(argv[++i]);
+        else if (SDL_strcmp(argv[i], "--diagram-rgba") == 0)
+            diagramOptions.format = DIAGRAM_FORMAT_RGBA;
+        else if (SDL_strcmp(argv[i], "--golden") == 0 && (i + 2) < argc)
+        {
+            goldenMode = true;
+            goldenOptions.scriptPath = argv[++i];
+            goldenOptions.outputDirectory = argv[++i];
+        }
+        else if (SDL_strcmp(argv[i], "--golden-baseline") == 0 && (i + 1) < argc)
+            goldenOptions.baselineDirectory = argv[++i];
+        else if (SDL_strcmp(argv[i], "--golden-tolerance") == 0 && (i + 1) < argc)
+            goldenOptions.channelTolerance = SDL_atoi(argv[++i]);
+        else if (SDL_strcmp(argv[i], "--golden-threshold") == 0 && (i + 1) < argc)
+            goldenOptions.thresholdPercent = SDL_atof(argv[++i]);
+        else if (SDL_strcmp(argv[i], "--bench-out") == 0 && (i + 1) < argc)
+            benchOptions.outputPath = argv[++i];
+        else if (SDL_strcmp(argv[i], "--bench-baseline") == 0 && (i + 1) < argc)
+            benchOptions.baselinePath = argv[++i];
+        else if (SDL_strcmp(argv[i], "--bench-threshold") == 0 && (i + 1) < argc)
+            benchOptions.thresholdPercent = SDL_atof(argv[++i]);
+    }
+
+    if (ticksPerSecond == 0)
+        ticksPerSecond = DEFAULT_TICKS_PER_SECOND;
+    if (maxCatchUpTicks == 0)
+        maxCatchUpTicks = DEFAULT_MAX_CATCH_UP_TICKS;
+    if (offscreenWidth <= 0 || offscreenHeight <= 0)
+    {
+        offscreenWidth = WINDOW_DEFAULT_WIDTH;
+        offscreenHeight = WINDOW_DEFAULT_HEIGHT;
+    }
+
     // Initialize SDL
-    if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
+    // Diagrams are drawn without any display, so they need none of the subsystems.
+    if (SDL_Init(diagramMode ? 0 : SDL_INIT_EVERYTHING) != 0)
     {
         SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "SDL_Init", SDL_GetError(), NULL);
         return EXIT_FAILURE;
     }
 
-    // Create an SDL window.
-    sdlWindow = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-                                360, 360, 0);
-    // Check if window was created successfully.
-    if (sdlWindow == NULL)
+    // Start the background logger before anything logs from the game loop.
+    if (!Log_Init())
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Log_Init: Logging synchronously: %s", SDL_GetError());
+
+    if (diagramMode)
     {
-        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "SDL_CreateWindow", SDL_GetError(), NULL);
-        goto cleanup;
+        if (RunDiagramMode())
+            retCode = EXIT_SUCCESS;
+
+        Log_Quit();
+        SDL_Quit();
+        return retCode;
     }
 
-    // Create an SDL renderer context.
-    sdlRenderer = SDL_CreateRenderer(sdlWindow, FIRST_AVAILABLE_DEVICE, SDL_RENDERER_PRESENTVSYNC);
-    if (sdlRenderer == NULL)
+    if (renderDriver != NULL)
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, renderDriver);
+
+    if ((benchMode || goldenMode) && renderBackendKind == RENDER_BACKEND_CPU)
     {
-        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "SDL_CreateRenderer", SDL_GetError(), NULL);
-        goto cleanup;
+        // The CPU backend draws into its own framebuffer; there is nothing to create.
+    }
+    else if ((benchMode || goldenMode) && renderDriver != NULL)
+    {
+        // The chosen driver draws into a window that is never shown, at the size the surface would have.
+        sdlWindow = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                    offscreenWidth, offscreenHeight, SDL_WINDOW_HIDDEN);
+        if (sdlWindow == NULL)
+        {
+            SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "SDL_CreateWindow", SDL_GetError(), NULL);
+            goto cleanup;
+        }
+
+        sdlRenderer = SDL_CreateRenderer(sdlWindow, FIRST_AVAILABLE_DEVICE, 0);
+        if (sdlRenderer == NULL)
+        {
+            SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "SDL_CreateRenderer", SDL_GetError(), NULL);
+            goto cleanup;
+        }
+    }
+    else if (benchMode || goldenMode)
+    {
+        // Benchmarks and golden runs draw with the software renderer into a surface, so they need no window or display.
+        benchSurface = SDL_CreateRGBSurfaceWithFormat(0, offscreenWidth, offscreenHeight, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (benchSurface == NULL)
+        {
+            SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "SDL_CreateRGBSurfaceWithFormat", SDL_GetError(), NULL);
+            goto cleanup;
+        }
+
+        sdlRenderer = SDL_CreateSoftwareRenderer(benchSurface);
+        if (sdlRenderer == NULL)
+        {
+            SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "SDL_CreateSoftwareRenderer", SDL_GetError(), NULL);
+            goto cleanup;
+        }
+    }
+    else
+    {
+        // Create an SDL window.
+        sdlWindow = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                    360, 360, 0);
+        // Check if window was created successfully.
+        if (sdlWindow == NULL)
+        {
+            SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "SDL_CreateWindow", SDL_GetError(), NULL);
+            goto cleanup;
+        }
+
+        // Create an SDL renderer context. The CPU backend shows its frames through the window surface instead.
+        if (renderBackendKind == RENDER_BACKEND_SDL)
+            sdlRenderer = SDL_CreateRenderer(sdlWindow, FIRST_AVAILABLE_DEVICE, SDL_RENDERER_PRESENTVSYNC);
+        if (renderBackendKind == RENDER_BACKEND_SDL && sdlRenderer == NULL)
+        {
+            SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "SDL_CreateRenderer", SDL_GetError(), NULL);
+            goto cleanup;
+        }
     }
 
 
     // Initialize subsystems.
 
+    // Arena Subsystem
+    if (!Arena_Init())
+    {
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Arena_Init", "Failed to initialize arena subsystem.", NULL);
+        goto cleanup;
+    }
+
     // Asset Subsystem
+    Memory_SetSubsystem(MEMORY_SUBSYSTEM_ASSET);
     if (!Asset_Init())
     {
         SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Asset_Init", "Failed to initialize asset subsystem.", NULL);
         goto cleanup;
     }
+    Memory_SetSubsystem(MEMORY_SUBSYSTEM_OTHER);
+
+    // Model Subsystem
+    if (!Model_Init())
+    {
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Model_Init", "Failed to initialize model subsystem.", NULL);
+        goto cleanup;
+    }
 
     // Input Subsystem
     if (!Input_Init())
@@ -146,99 +736,154 @@ int main(int argc, char *argv[])
         goto cleanup;
     }
 
-    // Render Subsystem
-    if (!Render_Init())
+    // Animation Subsystem
+    if (!Animation_Init())
     {
-        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Render_Init", "Failed to initialize render subsystem.", NULL);
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Animation_Init", "Failed to initialize animation subsystem.", NULL);
         goto cleanup;
     }
 
-    // Allocate SDL event buffer.
-    sdlEventBuffer = List_Create();
-    if (sdlEventBuffer == NULL)
+    // Raster Subsystem
+    if (!Raster_Init(rasterThreads, rasterSIMD))
     {
-        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "main", "Failed to create buffer for SDL events.", NULL);
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Raster_Init", "Failed to initialize raster subsystem.", NULL);
         goto cleanup;
     }
 
+    // Mesh Raster Subsystem
+    // Models drawn on the CPU use the same threads and kernels as the pieces' rasterizer.
+    if (!MeshRaster_Init(rasterThreads, rasterSIMD))
+    {
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "MeshRaster_Init", "Failed to initialize mesh raster subsystem.", NULL);
+        goto cleanup;
+    }
 
-    // Performance statistics.
-    uint32_t currentFramesPerSecond = 0;
-    uint32_t lastMeasurementTick = 0;
-    uint32_t lastMeasurementFrame = 0;
-
-
-    // Game Loop
-    // Fixed Logic Timestep, Variable Rendering
-    // Robert Nystrom's Game Programming Patterns
-    // http://gameprogrammingpatterns.com/game-loop.html
-    uint32_t previousTime = SDL_GetTicks();
-    uint32_t laggedTime = 0;
-    uint32_t currentTick = 0;
-    uint32_t currentFrame = 0;
-    isRunning = true;
-    while (isRunning)
+    // Mip Chain Subsystem
+    if (!MipChain_Init(mipMasterSize))
     {
-        // Understand that a "tick" means something different in the context of SDL, compared to the context of game logic.
-        // An SDL "tick" is a millisecond.
-        // A game "tick" is a logic step, with a time duration that we define.
-        uint32_t currentTime = SDL_GetTicks();
-        uint32_t elapsedTime = currentTime - previousTime;
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "MipChain_Init", "Failed to initialize mip chain subsystem.", NULL);
+        goto cleanup;
+    }
 
-        // Handle overflow of SDL ticks.
-        if (currentTime < previousTime)
-        {
-            elapsedTime = currentTime + (UINT32_MAX - previousTime) + 1;
-            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "SDL ticks overflowed: currentTime: %" PRIu32 "ms previousTime: %" PRIu32 "ms", currentTime, previousTime);
-        }
+    // Sprite Cache Subsystem
+    // Benchmarks and golden runs leave no cache files behind.
+    if (!SpriteCache_Init(spriteCacheBudget, spriteCachePersistent && !benchMode && !goldenMode))
+    {
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "SpriteCache_Init", "Failed to initialize sprite cache subsystem.", NULL);
+        goto cleanup;
+    }
 
-        previousTime = currentTime;
-        laggedTime += elapsedTime;
+    // Render Backend Subsystem
+    // Without a window, the CPU backend draws at the offscreen size.
+    if (!RenderBackend_Init(renderBackendKind, offscreenWidth, offscreenHeight))
+    {
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "RenderBackend_Init", "Failed to initialize render backend subsystem.", NULL);
+        goto cleanup;
+    }
 
+    // Render Subsystem
+    if (!Render_Init())
+    {
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Render_Init", "Failed to initialize render subsystem.", NULL);
+        goto cleanup;
+    }
 
-        // Core Input Function
-        DoInput(currentTick);
+    // Latency Subsystem
+    if (!Latency_Init())
+    {
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Latency_Init", "Failed to initialize latency subsystem.", NULL);
+        goto cleanup;
+    }
 
+    // Snapshot Subsystem
+    if (!Snapshot_Init())
+    {
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Snapshot_Init", "Failed to initialize snapshot subsystem.", NULL);
+        goto cleanup;
+    }
 
-        while (laggedTime >= MS_PER_TICK)
-        {
-            // Core Logic Function
-            DoLogic(currentTick);
+    // Allocate SDL event buffers.
+    sdlEventBuffer = List_Create();
+    pendingEventBuffer = List_Create();
+    eventBufferMutex = SDL_CreateMutex();
+    if (sdlEventBuffer == NULL || pendingEventBuffer == NULL || eventBufferMutex == NULL
+        || !Arena_Create(&eventArenas[0], EVENT_ARENA_SIZE) || !Arena_Create(&eventArenas[1], EVENT_ARENA_SIZE))
+    {
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "main", "Failed to create buffer for SDL events.", NULL);
+        goto cleanup;
+    }
 
-            currentTick++;
+    // The renderer always needs a snapshot to draw.
+    Snapshot_Publish(0);
+    Snapshot_Acquire();
 
-            laggedTime -= MS_PER_TICK;
-        }
+    if (benchMode)
+    {
+        if (Bench_Run(&benchOptions))
+            retCode = EXIT_SUCCESS;
+        goto cleanup;
+    }
 
+    if (goldenMode)
+    {
+        if (Golden_Run(&goldenOptions, GoldenTick, GoldenDraw))
+            retCode = EXIT_SUCCESS;
+        goto cleanup;
+    }
 
-        // Core Render Function
-        DoRender(currentTick, (laggedTime / (MS_PER_TICK * 1.0)));
-        currentFrame++;
+#ifndef TRACK_ALLOCATIONS
+    if (allocationCheckFrames > 0)
+        LOG_WARN(LOG_CATEGORY_MAIN, "Allocation check requested, but this build does not track allocations");
+#endif
 
 
-        // Performance statistics.
-        // At least one second before logging.
-        if ((currentTick - lastMeasurementTick) >= TICKS_PER_SECOND)
-        {
-            currentFramesPerSecond = currentFrame - lastMeasurementFrame;
-            lastMeasurementTick = currentTick;
-            lastMeasurementFrame = currentFrame;
-            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Tick: %" PRIu32 " Frame: %" PRIu32 " FPS: %" PRIu32, currentTick, currentFrame, currentFramesPerSecond);
-        }
+    if (threadedMode)
+    {
+        if (!RunThreadedLoop())
+            goto cleanup;
     }
+    else
+        RunGameLoop();
 
-    retCode = EXIT_SUCCESS;
+    if (!allocationCheckFailed)
+        retCode = EXIT_SUCCESS;
+
+    if (latencyOutputPath != NULL && !Latency_Export(latencyOutputPath))
+        LOG_ERROR(LOG_CATEGORY_MAIN, "Failed to write input latency to %s", latencyOutputPath);
 
 cleanup:
     if (sdlEventBuffer)
-        List_Destroy(sdlEventBuffer, free);
+        List_Destroy(sdlEventBuffer, NULL);
+
+    if (pendingEventBuffer)
+        List_Destroy(pendingEventBuffer, NULL);
+
+    if (eventBufferMutex)
+        SDL_DestroyMutex(eventBufferMutex);
+
+    Arena_LogStatistics(&eventArenas[0], "First event");
+    Arena_LogStatistics(&eventArenas[1], "Second event");
+    Arena_Destroy(&eventArenas[0]);
+    Arena_Destroy(&eventArenas[1]);
 
     // Quit subsystems.
+    Snapshot_Quit();
+    Latency_Quit();
     Render_Quit();
+    RenderBackend_Quit();
+    SpriteCache_Quit();
+    MipChain_Quit();
+    MeshRaster_Quit();
+    Raster_Quit();
+    Animation_Quit();
     Game_Quit();
     Camera_Quit();
     Input_Quit();
+    Model_Quit();
     Asset_Quit();
+    Arena_Quit();
+
+    Log_Quit();
 
     if (sdlRenderer)
         SDL_DestroyRenderer(sdlRenderer);
@@ -246,6 +891,9 @@ cleanup:
     if (sdlWindow)
         SDL_DestroyWindow(sdlWindow);
 
+    if (benchSurface)
+        SDL_FreeSurface(benchSurface);
+
     SDL_Quit();
 
     return retCode;
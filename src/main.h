@@ -21,16 +21,34 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "SDL.h"
 
-// Globally accessible boolean that determines whether the game loop should continue.
-extern bool isRunning;
+// Globally accessible flag that determines whether the game loop should continue.
+// Read by the logic thread while the main thread writes it, so it is only touched with SDL_AtomicGet and SDL_AtomicSet.
+extern SDL_atomic_t isRunning;
+
+// An SDL event as stored in the event buffer.
+// The event comes first, so an item can be used as an SDL_Event pointer.
+typedef struct
+{
+    SDL_Event event;
+    // SDL performance counter value at the time SDL received the event.
+    uint64_t arrivalTime;
+    // Output size in pixels when a window event was polled, because the logic thread cannot ask the window.
+    int outputWidth;
+    int outputHeight;
+} BUFFERED_EVENT;
 
 // Globally accessible list that stores all SDL events for later processing in the game logic.
+// Items are BUFFERED_EVENT pointers.
 extern void *sdlEventBuffer;
 
 // Globally accessible SDL window that represents the game window.
 extern SDL_Window *sdlWindow;
 
-// Globally accessible SDL renderer context.
+// Globally accessible SDL renderer context. NULL when the CPU render backend draws into a window.
 extern SDL_Renderer *sdlRenderer;
+
+// Globally accessible number of logic ticks per second of game time.
+extern uint32_t ticksPerSecond;
@@ -0,0 +1,217 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include "memtrack.h"
+#include "SDL.h"
+
+
+static const char *subsystemNames[MEMORY_SUBSYSTEM_COUNT] =
+{
+    "Other",
+    "Input",
+    "Camera",
+    "Game",
+    "Render",
+    "Asset"
+};
+
+
+#ifdef TRACK_ALLOCATIONS
+
+// Every tracked block starts with a header that remembers its size and owner.
+// The header is as large as the strictest fundamental alignment, so the block stays aligned.
+typedef union AllocationHeader
+{
+    struct
+    {
+        size_t size;
+        MEMORY_SUBSYSTEM subsystem;
+    } info;
+    max_align_t alignment;
+} AllocationHeader;
+
+static SDL_atomic_t frameAllocations[MEMORY_SUBSYSTEM_COUNT];
+static SDL_atomic_t frameBytes[MEMORY_SUBSYSTEM_COUNT];
+static SDL_atomic_t liveAllocations;
+static SDL_atomic_t liveBytes;
+
+static thread_local MEMORY_SUBSYSTEM currentSubsystem = MEMORY_SUBSYSTEM_OTHER;
+
+
+void* Memory_Allocate(size_t size)
+{
+    AllocationHeader *header = (AllocationHeader*)malloc(sizeof(AllocationHeader) + size);
+    if (header == NULL)
+        return NULL;
+
+    header->info.size = size;
+    header->info.subsystem = currentSubsystem;
+
+    SDL_AtomicIncRef(&frameAllocations[currentSubsystem]);
+    SDL_AtomicAdd(&frameBytes[currentSubsystem], (int)size);
+    SDL_AtomicIncRef(&liveAllocations);
+    SDL_AtomicAdd(&liveBytes, (int)size);
+
+    return header + 1;
+}
+
+
+void Memory_Free(void *pointer)
+{
+    if (pointer == NULL)
+        return;
+
+    AllocationHeader *header = ((AllocationHeader*)pointer) - 1;
+
+    SDL_AtomicAdd(&liveAllocations, -1);
+    SDL_AtomicAdd(&liveBytes, -(int)header->info.size);
+
+    free(header);
+}
+
+
+MEMORY_SUBSYSTEM Memory_SetSubsystem(MEMORY_SUBSYSTEM subsystem)
+{
+    MEMORY_SUBSYSTEM previous = currentSubsystem;
+    currentSubsystem = subsystem;
+    return previous;
+}
+
+
+void Memory_EndFrame(MEMORY_FRAME_STATS *stats)
+{
+    stats->totalAllocations = 0;
+    stats->totalBytes = 0;
+
+    for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++)
+    {
+        stats->allocations[i] = SDL_AtomicSet(&frameAllocations[i], 0);
+        stats->bytes[i] = SDL_AtomicSet(&frameBytes[i], 0);
+
+        stats->totalAllocations += stats->allocations[i];
+        stats->totalBytes += stats->bytes[i];
+    }
+}
+
+
+void Memory_GetLive(uint32_t *allocations, uint32_t *bytes)
+{
+    *allocations = SDL_AtomicGet(&liveAllocations);
+    *bytes = SDL_AtomicGet(&liveBytes);
+}
+
+
+// Route all C++ allocations through the tracker.
+
+void* operator new(size_t size)
+{
+    void *pointer = Memory_Allocate(size == 0 ? 1 : size);
+    if (pointer == NULL)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return Memory_Allocate(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return Memory_Allocate(size == 0 ? 1 : size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    Memory_Free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    Memory_Free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    Memory_Free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    Memory_Free(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t&) noexcept
+{
+    Memory_Free(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t&) noexcept
+{
+    Memory_Free(pointer);
+}
+
+#else
+
+void* Memory_Allocate(size_t size)
+{
+    return malloc(size);
+}
+
+
+void Memory_Free(void *pointer)
+{
+    free(pointer);
+}
+
+
+MEMORY_SUBSYSTEM Memory_SetSubsystem(MEMORY_SUBSYSTEM subsystem)
+{
+    return MEMORY_SUBSYSTEM_OTHER;
+}
+
+
+void Memory_EndFrame(MEMORY_FRAME_STATS *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+
+void Memory_GetLive(uint32_t *allocations, uint32_t *bytes)
+{
+    *allocations = 0;
+    *bytes = 0;
+}
+
+#endif
+
+
+const char* Memory_SubsystemName(MEMORY_SUBSYSTEM subsystem)
+{
+    return subsystemNames[subsystem];
+}
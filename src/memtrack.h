@@ -0,0 +1,79 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// Allocation tracking is compiled into debug builds, and into any build that defines TRACK_ALLOCATIONS.
+#if !defined(NDEBUG) && !defined(TRACK_ALLOCATIONS)
+#define TRACK_ALLOCATIONS
+#endif
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+// The part of the program an allocation is charged to.
+typedef enum {
+    MEMORY_SUBSYSTEM_OTHER,
+    MEMORY_SUBSYSTEM_INPUT,
+    MEMORY_SUBSYSTEM_CAMERA,
+    MEMORY_SUBSYSTEM_GAME,
+    MEMORY_SUBSYSTEM_RENDER,
+    MEMORY_SUBSYSTEM_ASSET,
+    MEMORY_SUBSYSTEM_COUNT
+} MEMORY_SUBSYSTEM;
+
+// Allocations made since the previous call to Memory_EndFrame.
+typedef struct {
+    uint32_t allocations[MEMORY_SUBSYSTEM_COUNT];
+    uint32_t bytes[MEMORY_SUBSYSTEM_COUNT];
+    uint32_t totalAllocations;
+    uint32_t totalBytes;
+} MEMORY_FRAME_STATS;
+
+
+// malloc and free for our own C code. Tracked when TRACK_ALLOCATIONS is defined.
+// C++ new and delete are tracked automatically.
+void* Memory_Allocate(size_t size);
+void Memory_Free(void *pointer);
+
+// Charge allocations made by the calling thread to a subsystem. Returns the previous subsystem.
+MEMORY_SUBSYSTEM Memory_SetSubsystem(MEMORY_SUBSYSTEM subsystem);
+
+// Collect and reset the per-frame counters.
+void Memory_EndFrame(MEMORY_FRAME_STATS *stats);
+
+// Allocations that have not been freed yet.
+void Memory_GetLive(uint32_t *allocations, uint32_t *bytes);
+
+const char* Memory_SubsystemName(MEMORY_SUBSYSTEM subsystem);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,805 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "meshraster.h"
+#include "logger.h"
+#include "SDL.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESH_RASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+// Pixel centers this close to an edge follow the top-left rule, in pixels. Well above float rounding
+// at these coordinates, and well below anything visible.
+#define MESH_EDGE_MARGIN (1.0f / 256.0f)
+
+
+// One vertex of the instance being binned: x, y in pixels, z in 0..1 and the lit color.
+// Vertices behind the eye have w 0.
+typedef struct
+{
+    float x, y, z, w;
+    float r, g, b;
+} MESH_VERTEX;
+
+// A triangle set up for rasterizing. Every value is a plane a * x + b * y + c over the pixel centers,
+// so stepping one pixel right adds a.
+typedef struct
+{
+    // Barycentric weight of each corner, which is positive inside for either winding.
+    float edges[3][3];
+    float depth[3];
+    float colors[3][3];
+    // Pixels the triangle may cover, inclusive, already clipped.
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+    // Draws since the last flush, so tiles can replay the bins in draw order.
+    uint32_t draw;
+} MESH_TRIANGLE;
+
+// What one thread bins. Each draw splits its instances across the threads in order, so a tile replays
+// one draw at a time, in thread order.
+typedef struct
+{
+    std::vector<MESH_VERTEX> vertices;
+    std::vector<MESH_TRIANGLE> triangles;
+    // Indices into triangles, one list per tile.
+    std::vector<std::vector<uint32_t>> bins;
+    // Of the current draw, in performance counter ticks.
+    uint64_t transformTime;
+    uint64_t binTime;
+    uint32_t binnedTriangles;
+} MESH_THREAD;
+
+static MESH_THREAD threads[MESH_RASTER_MAX_THREADS];
+static SDL_Thread *workers[MESH_RASTER_MAX_THREADS - 1];
+static int workerCount = 0;
+static bool useSIMD = false;
+
+// Posted once per worker to start a job, and once by each worker when it is done.
+static SDL_sem *workAvailable = NULL;
+static SDL_sem *workDone = NULL;
+static SDL_atomic_t quitting;
+
+// The job being run. Every thread taking part claims a slot, which picks its MESH_THREAD.
+static void (*jobFunction)(int slot, int slotCount) = NULL;
+static int jobSlotCount = 0;
+static SDL_atomic_t nextSlot;
+
+// The draw being binned.
+static struct
+{
+    const MODEL *model;
+    int firstIndex;
+    int indexCount;
+    float viewProjection[16];
+    const RENDER_INSTANCE *instances;
+    int instanceCount;
+} draw;
+
+// The target everything binned so far is for, and its tile grid.
+static MESH_RASTER_TARGET target;
+static bool pending = false;
+static uint32_t pendingDraws = 0;
+static int tilesX = 0;
+static int tilesY = 0;
+
+// Tiles with anything binned, claimed one at a time while rasterizing.
+static std::vector<int> tileQueue;
+static SDL_atomic_t nextTile;
+
+static MESH_RASTER_STATS stats;
+static bool drawnThisFrame = false;
+
+
+// Internal function.
+static double TicksToMilliseconds(uint64_t ticks)
+{
+    return (ticks * 1000.0) / SDL_GetPerformanceFrequency();
+}
+
+
+// Internal function.
+// Run the job on the calling thread and on up to slotCount - 1 workers. Returns once all are done.
+static void RunJob(void (*function)(int slot, int slotCount), int slotCount)
+{
+    if (slotCount > workerCount + 1)
+        slotCount = workerCount + 1;
+    if (slotCount < 1)
+        slotCount = 1;
+
+    jobFunction = function;
+    jobSlotCount = slotCount;
+    SDL_AtomicSet(&nextSlot, 1);
+
+    for (int i = 0; i < slotCount - 1; i++)
+        SDL_SemPost(workAvailable);
+
+    function(0, slotCount);
+
+    for (int i = 0; i < slotCount - 1; i++)
+        SDL_SemWait(workDone);
+
+    jobFunction = NULL;
+}
+
+
+static int SDLCALL MeshWorker(void *data)
+{
+    for (;;)
+    {
+        SDL_SemWait(workAvailable);
+        if (SDL_AtomicGet(&quitting))
+            break;
+
+        jobFunction(SDL_AtomicAdd(&nextSlot, 1), jobSlotCount);
+        SDL_SemPost(workDone);
+    }
+
+    return 0;
+}
+
+
+// Internal function.
+// Lambert shading of one vertex color, by a world space normal that need not be unit length.
+static inline float Lighting(float normalX, float normalY, float normalZ)
+{
+    float length = sqrtf(normalX * normalX + normalY * normalY + normalZ * normalZ);
+    float diffuse = 0.0f;
+    if (length > 0.0f)
+    {
+        diffuse = (normalX * renderLightDirection[0] + normalY * renderLightDirection[1] + normalZ * renderLightDirection[2]) / length;
+        diffuse = SDL_max(diffuse, 0.0f);
+    }
+
+    return RENDER_LIGHT_AMBIENT + ((1.0f - RENDER_LIGHT_AMBIENT) * diffuse);
+}
+
+
+// Internal function.
+// Clip space to pixels, or w 0 for a vertex behind the eye.
+static inline void ProjectVertex(const float *clip, MESH_VERTEX *vertex)
+{
+    if (clip[3] <= 1e-5f)
+    {
+        vertex->w = 0.0f;
+        return;
+    }
+
+    float inverseW = 1.0f / clip[3];
+    vertex->x = target.viewport.x + ((clip[0] * inverseW) * 0.5f + 0.5f) * target.viewport.w;
+    vertex->y = target.viewport.y + (0.5f - (clip[1] * inverseW) * 0.5f) * target.viewport.h;
+    vertex->z = (clip[2] * inverseW) * 0.5f + 0.5f;
+    vertex->w = clip[3];
+}
+
+
+// Internal function.
+// result = a * b, all column-major 4x4 matrices.
+static void MultiplyMatrices(float *result, const float *a, const float *b)
+{
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            result[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1]
+                + a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+        }
+    }
+}
+
+
+// Internal function.
+static void TransformVerticesScalar(const MODEL *model, const float *transform, const float *world, SDL_Color color, MESH_VERTEX *vertices)
+{
+    for (int i = 0; i < model->vertexCount; i++)
+    {
+        const float *p = &model->vertices[i * MODEL_VERTEX_FLOATS];
+        const float *n = p + 3;
+
+        float clip[4];
+        for (int row = 0; row < 4; row++)
+            clip[row] = transform[row] * p[0] + transform[4 + row] * p[1] + transform[8 + row] * p[2] + transform[12 + row];
+        ProjectVertex(clip, &vertices[i]);
+
+        float light = Lighting(world[0] * n[0] + world[4] * n[1] + world[8] * n[2],
+            world[1] * n[0] + world[5] * n[1] + world[9] * n[2],
+            world[2] * n[0] + world[6] * n[1] + world[10] * n[2]);
+        vertices[i].r = color.r * light;
+        vertices[i].g = color.g * light;
+        vertices[i].b = color.b * light;
+    }
+}
+
+
+#ifdef MESH_RASTER_SSE2
+// Internal function.
+// The same as the scalar transform, one matrix column per register, as glm's SIMD code does it.
+static void TransformVerticesSSE2(const MODEL *model, const float *transform, const float *world, SDL_Color color, MESH_VERTEX *vertices)
+{
+    __m128 columns[4] = { _mm_loadu_ps(&transform[0]), _mm_loadu_ps(&transform[4]), _mm_loadu_ps(&transform[8]), _mm_loadu_ps(&transform[12]) };
+    __m128 normalColumns[3] = { _mm_loadu_ps(&world[0]), _mm_loadu_ps(&world[4]), _mm_loadu_ps(&world[8]) };
+
+    for (int i = 0; i < model->vertexCount; i++)
+    {
+        const float *p = &model->vertices[i * MODEL_VERTEX_FLOATS];
+        const float *n = p + 3;
+
+        __m128 clipVector = _mm_add_ps(_mm_add_ps(_mm_mul_ps(columns[0], _mm_set1_ps(p[0])), _mm_mul_ps(columns[1], _mm_set1_ps(p[1]))),
+            _mm_add_ps(_mm_mul_ps(columns[2], _mm_set1_ps(p[2])), columns[3]));
+        __m128 normal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalColumns[0], _mm_set1_ps(n[0])), _mm_mul_ps(normalColumns[1], _mm_set1_ps(n[1]))),
+            _mm_mul_ps(normalColumns[2], _mm_set1_ps(n[2])));
+
+        float clip[4];
+        float worldNormal[4];
+        _mm_storeu_ps(clip, clipVector);
+        _mm_storeu_ps(worldNormal, normal);
+        ProjectVertex(clip, &vertices[i]);
+
+        float light = Lighting(worldNormal[0], worldNormal[1], worldNormal[2]);
+        vertices[i].r = color.r * light;
+        vertices[i].g = color.g * light;
+        vertices[i].b = color.b * light;
+    }
+}
+#endif
+
+
+// Internal function.
+static inline void SetPlane(float *plane, const float *edges, const float *values)
+{
+    for (int i = 0; i < 3; i++)
+        plane[i] = edges[i] * values[0] + edges[3 + i] * values[1] + edges[6 + i] * values[2];
+}
+
+
+// Internal function.
+// Set up one triangle and add it to the bins of the tiles it touches.
+static void BinTriangle(MESH_THREAD *thread, const MESH_VERTEX *v0, const MESH_VERTEX *v1, const MESH_VERTEX *v2)
+{
+    // Triangles with a corner behind the eye are dropped whole rather than clipped.
+    if (v0->w == 0.0f || v1->w == 0.0f || v2->w == 0.0f)
+        return;
+
+    float area = (v1->x - v0->x) * (v2->y - v0->y) - (v1->y - v0->y) * (v2->x - v0->x);
+    if (!(fabsf(area) > 1e-8f))
+        return;
+
+    // The pixels whose centers may be inside.
+    const SDL_Rect *clip = &target.clip;
+    float left = SDL_min(v0->x, SDL_min(v1->x, v2->x));
+    float right = SDL_max(v0->x, SDL_max(v1->x, v2->x));
+    float top = SDL_min(v0->y, SDL_min(v1->y, v2->y));
+    float bottom = SDL_max(v0->y, SDL_max(v1->y, v2->y));
+    if (right < clip->x || left > clip->x + clip->w || bottom < clip->y || top > clip->y + clip->h)
+        return;
+
+    // The bounds reach past the corners by the edge margin, so only the edges decide pixels near them.
+    MESH_TRIANGLE triangle;
+    triangle.minX = SDL_max(clip->x, (int)ceilf(left - 0.5f - 2.0f * MESH_EDGE_MARGIN));
+    triangle.maxX = SDL_min(clip->x + clip->w - 1, (int)floorf(right - 0.5f + 2.0f * MESH_EDGE_MARGIN));
+    triangle.minY = SDL_max(clip->y, (int)ceilf(top - 0.5f - 2.0f * MESH_EDGE_MARGIN));
+    triangle.maxY = SDL_min(clip->y + clip->h - 1, (int)floorf(bottom - 0.5f + 2.0f * MESH_EDGE_MARGIN));
+    triangle.draw = pendingDraws;
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return;
+
+    // The weight of each corner is the edge function of the opposite edge over the area, with the half pixel
+    // to the centers folded into the constant.
+    const MESH_VERTEX *corners[3] = { v0, v1, v2 };
+    float inverseArea = 1.0f / area;
+    for (int i = 0; i < 3; i++)
+    {
+        const MESH_VERTEX *a = corners[(i + 1) % 3];
+        const MESH_VERTEX *b = corners[(i + 2) % 3];
+        float stepX = -(b->y - a->y) * inverseArea;
+        float stepY = (b->x - a->x) * inverseArea;
+        triangle.edges[i][0] = stepX;
+        triangle.edges[i][1] = stepY;
+        triangle.edges[i][2] = (((b->y - a->y) * a->x) - ((b->x - a->x) * a->y)) * inverseArea + (stepX + stepY) * 0.5f;
+    }
+
+    const float depths[3] = { v0->z, v1->z, v2->z };
+    const float reds[3] = { v0->r, v1->r, v2->r };
+    const float greens[3] = { v0->g, v1->g, v2->g };
+    const float blues[3] = { v0->b, v1->b, v2->b };
+    SetPlane(triangle.depth, &triangle.edges[0][0], depths);
+    SetPlane(triangle.colors[0], &triangle.edges[0][0], reds);
+    SetPlane(triangle.colors[1], &triangle.edges[0][0], greens);
+    SetPlane(triangle.colors[2], &triangle.edges[0][0], blues);
+
+    // Top-left rule: a pixel center on an edge two triangles share belongs to exactly one of them.
+    // The steps point inside, so a left edge steps right and a top edge steps down. Those take centers
+    // up to the margin outside, and the other edges give up centers up to the margin inside.
+    // Only the coverage test moves; the planes above were set up from the exact weights.
+    for (int i = 0; i < 3; i++)
+    {
+        float stepX = triangle.edges[i][0];
+        float stepY = triangle.edges[i][1];
+        float margin = (fabsf(stepX) + fabsf(stepY)) * MESH_EDGE_MARGIN;
+        bool topLeft = stepX > 0.0f || (stepX == 0.0f && stepY > 0.0f);
+        triangle.edges[i][2] += topLeft ? margin : -margin;
+    }
+
+    uint32_t index = (uint32_t)thread->triangles.size();
+    thread->triangles.push_back(triangle);
+    thread->binnedTriangles++;
+
+    int firstTileX = triangle.minX / MESH_RASTER_TILE_SIZE;
+    int lastTileX = triangle.maxX / MESH_RASTER_TILE_SIZE;
+    int firstTileY = triangle.minY / MESH_RASTER_TILE_SIZE;
+    int lastTileY = triangle.maxY / MESH_RASTER_TILE_SIZE;
+    bool single = firstTileX == lastTileX && firstTileY == lastTileY;
+
+    for (int tileY = firstTileY; tileY <= lastTileY; tileY++)
+    {
+        for (int tileX = firstTileX; tileX <= lastTileX; tileX++)
+        {
+            // Skip tiles entirely outside one of the edges. The test is exact at the tile's outermost pixels.
+            if (!single)
+            {
+                float x0 = (float)SDL_max(triangle.minX, tileX * MESH_RASTER_TILE_SIZE);
+                float x1 = (float)SDL_min(triangle.maxX, (tileX + 1) * MESH_RASTER_TILE_SIZE - 1);
+                float y0 = (float)SDL_max(triangle.minY, tileY * MESH_RASTER_TILE_SIZE);
+                float y1 = (float)SDL_min(triangle.maxY, (tileY + 1) * MESH_RASTER_TILE_SIZE - 1);
+
+                bool outside = false;
+                for (int i = 0; i < 3 && !outside; i++)
+                {
+                    const float *edge = triangle.edges[i];
+                    float best = edge[0] * (edge[0] > 0.0f ? x1 : x0) + edge[1] * (edge[1] > 0.0f ? y1 : y0) + edge[2];
+                    outside = best < 0.0f;
+                }
+                if (outside)
+                    continue;
+            }
+
+            thread->bins[tileY * tilesX + tileX].push_back(index);
+        }
+    }
+}
+
+
+// Internal function.
+// Transform and bin this slot's share of the instances.
+static void DrawJob(int slot, int slotCount)
+{
+    MESH_THREAD *thread = &threads[slot];
+    const MODEL *model = draw.model;
+
+    thread->transformTime = 0;
+    thread->binTime = 0;
+
+    int firstInstance = (int)(((int64_t)draw.instanceCount * slot) / slotCount);
+    int lastInstance = (int)(((int64_t)draw.instanceCount * (slot + 1)) / slotCount);
+    if ((int)thread->vertices.size() < model->vertexCount)
+        thread->vertices.resize(model->vertexCount);
+    MESH_VERTEX *vertices = thread->vertices.data();
+
+    for (int instance = firstInstance; instance < lastInstance; instance++)
+    {
+        uint64_t start = SDL_GetPerformanceCounter();
+
+        const RENDER_INSTANCE *copy = &draw.instances[instance];
+        float transform[16];
+        MultiplyMatrices(transform, draw.viewProjection, copy->transform);
+#ifdef MESH_RASTER_SSE2
+        if (useSIMD)
+            TransformVerticesSSE2(model, transform, copy->transform, copy->color, vertices);
+        else
+#endif
+            TransformVerticesScalar(model, transform, copy->transform, copy->color, vertices);
+
+        uint64_t transformed = SDL_GetPerformanceCounter();
+
+        for (int i = draw.firstIndex; i + 2 < draw.firstIndex + draw.indexCount; i += 3)
+        {
+            if (model->wideIndices)
+            {
+                const uint32_t *indices = (const uint32_t*)model->indices;
+                BinTriangle(thread, &vertices[indices[i]], &vertices[indices[i + 1]], &vertices[indices[i + 2]]);
+            }
+            else
+            {
+                const uint16_t *indices = (const uint16_t*)model->indices;
+                BinTriangle(thread, &vertices[indices[i]], &vertices[indices[i + 1]], &vertices[indices[i + 2]]);
+            }
+        }
+
+        uint64_t binned = SDL_GetPerformanceCounter();
+        thread->transformTime += transformed - start;
+        thread->binTime += binned - transformed;
+    }
+}
+
+
+// Internal function.
+static inline uint32_t PackColor(float r, float g, float b)
+{
+    uint32_t red = (uint32_t)SDL_min(SDL_max(r, 0.0f) + 0.5f, 255.0f);
+    uint32_t green = (uint32_t)SDL_min(SDL_max(g, 0.0f) + 0.5f, 255.0f);
+    uint32_t blue = (uint32_t)SDL_min(SDL_max(b, 0.0f) + 0.5f, 255.0f);
+    return SDL_SwapLE32(red | (green << 8) | (blue << 16) | 0xFF000000u);
+}
+
+
+// Internal function.
+// Shade the pixels of one row of a triangle from x to lastX, inclusive.
+static void RasterizeSpanScalar(const MESH_TRIANGLE *triangle, int x, int lastX, int y)
+{
+    float *depthRow = &target.depth[(size_t)y * target.width];
+    uint32_t *pixelRow = (uint32_t*)&target.pixels[(size_t)y * target.width * 4];
+
+    for (; x <= lastX; x++)
+    {
+        float px = (float)x;
+        float py = (float)y;
+        float w0 = triangle->edges[0][0] * px + triangle->edges[0][1] * py + triangle->edges[0][2];
+        float w1 = triangle->edges[1][0] * px + triangle->edges[1][1] * py + triangle->edges[1][2];
+        float w2 = triangle->edges[2][0] * px + triangle->edges[2][1] * py + triangle->edges[2][2];
+        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+            continue;
+
+        float depth = triangle->depth[0] * px + triangle->depth[1] * py + triangle->depth[2];
+        if (depth < 0.0f || depth >= depthRow[x])
+            continue;
+
+        // Colors are interpolated in screen space; the pieces are too small for it to show.
+        depthRow[x] = depth;
+        pixelRow[x] = PackColor(triangle->colors[0][0] * px + triangle->colors[0][1] * py + triangle->colors[0][2],
+            triangle->colors[1][0] * px + triangle->colors[1][1] * py + triangle->colors[1][2],
+            triangle->colors[2][0] * px + triangle->colors[2][1] * py + triangle->colors[2][2]);
+    }
+}
+
+
+#ifdef MESH_RASTER_SSE2
+// Internal function.
+// Four pixels at a time, from a multiple of four. Lanes outside x..lastX or past the end of the row are left
+// to the scalar code.
+static void RasterizeSpanSSE2(const MESH_TRIANGLE *triangle, int x, int lastX, int y)
+{
+    int firstX = x;
+    x &= ~3;
+    float *depthRow = &target.depth[(size_t)y * target.width];
+    uint32_t *pixelRow = (uint32_t*)&target.pixels[(size_t)y * target.width * 4];
+
+    const __m128 laneOffsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128i laneIndices = _mm_set_epi32(3, 2, 1, 0);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maximum = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+    const __m128i firstLane = _mm_set1_epi32(firstX);
+    const __m128i lastLane = _mm_set1_epi32(lastX);
+
+    // Each plane at the first four pixels, and its step to the next four.
+    __m128 values[7];
+    __m128 steps[7];
+    const float *planes[7] = { triangle->edges[0], triangle->edges[1], triangle->edges[2], triangle->depth,
+        triangle->colors[0], triangle->colors[1], triangle->colors[2] };
+    for (int i = 0; i < 7; i++)
+    {
+        __m128 stepX = _mm_set1_ps(planes[i][0]);
+        __m128 start = _mm_set1_ps(planes[i][0] * x + planes[i][1] * y + planes[i][2]);
+        values[i] = _mm_add_ps(start, _mm_mul_ps(stepX, laneOffsets));
+        steps[i] = _mm_mul_ps(stepX, _mm_set1_ps(4.0f));
+    }
+
+    int lastFullX = target.width - 4;
+    for (; x <= lastX; x += 4)
+    {
+        if (x > lastFullX)
+        {
+            RasterizeSpanScalar(triangle, SDL_max(x, firstX), lastX, y);
+            return;
+        }
+
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(values[0], zero), _mm_cmpge_ps(values[1], zero)), _mm_cmpge_ps(values[2], zero));
+        __m128i lanes = _mm_add_epi32(_mm_set1_epi32(x), laneIndices);
+        __m128i outsideSpan = _mm_or_si128(_mm_cmplt_epi32(lanes, firstLane), _mm_cmpgt_epi32(lanes, lastLane));
+        inside = _mm_andnot_ps(_mm_castsi128_ps(outsideSpan), inside);
+
+        if (_mm_movemask_ps(inside) != 0)
+        {
+            __m128 oldDepth = _mm_loadu_ps(&depthRow[x]);
+            __m128 write = _mm_and_ps(inside, _mm_and_ps(_mm_cmplt_ps(values[3], oldDepth), _mm_cmpge_ps(values[3], zero)));
+            if (_mm_movemask_ps(write) != 0)
+            {
+                _mm_storeu_ps(&depthRow[x], _mm_or_ps(_mm_and_ps(write, values[3]), _mm_andnot_ps(write, oldDepth)));
+
+                __m128i red = _mm_cvttps_epi32(_mm_min_ps(_mm_add_ps(_mm_max_ps(values[4], zero), half), maximum));
+                __m128i green = _mm_cvttps_epi32(_mm_min_ps(_mm_add_ps(_mm_max_ps(values[5], zero), half), maximum));
+                __m128i blue = _mm_cvttps_epi32(_mm_min_ps(_mm_add_ps(_mm_max_ps(values[6], zero), half), maximum));
+                __m128i color = _mm_or_si128(_mm_or_si128(red, _mm_slli_epi32(green, 8)), _mm_or_si128(_mm_slli_epi32(blue, 16), alpha));
+
+                __m128i writeMask = _mm_castps_si128(write);
+                __m128i oldColor = _mm_loadu_si128((const __m128i*)&pixelRow[x]);
+                _mm_storeu_si128((__m128i*)&pixelRow[x], _mm_or_si128(_mm_and_si128(writeMask, color), _mm_andnot_si128(writeMask, oldColor)));
+            }
+        }
+
+        for (int i = 0; i < 7; i++)
+            values[i] = _mm_add_ps(values[i], steps[i]);
+    }
+}
+#endif
+
+
+// Internal function.
+// Rasterize the tiles in the queue until none are left to claim.
+static void RasterJob(int slot, int slotCount)
+{
+    int threadCount = workerCount + 1;
+
+    for (;;)
+    {
+        int claimed = SDL_AtomicAdd(&nextTile, 1);
+        if (claimed >= (int)tileQueue.size())
+            break;
+
+        int tile = tileQueue[claimed];
+        int tileLeft = (tile % tilesX) * MESH_RASTER_TILE_SIZE;
+        int tileTop = (tile / tilesX) * MESH_RASTER_TILE_SIZE;
+
+        // One draw at a time, and within it every thread's share in turn, so the order does not depend on
+        // the thread count.
+        size_t cursors[MESH_RASTER_MAX_THREADS] = { 0 };
+        for (;;)
+        {
+            uint32_t nextDraw = UINT32_MAX;
+            for (int t = 0; t < threadCount; t++)
+            {
+                const std::vector<uint32_t> &bin = threads[t].bins[tile];
+                if (cursors[t] < bin.size())
+                    nextDraw = SDL_min(nextDraw, threads[t].triangles[bin[cursors[t]]].draw);
+            }
+            if (nextDraw == UINT32_MAX)
+                break;
+
+            for (int t = 0; t < threadCount; t++)
+            {
+                const std::vector<uint32_t> &bin = threads[t].bins[tile];
+                for (; cursors[t] < bin.size() && threads[t].triangles[bin[cursors[t]]].draw == nextDraw; cursors[t]++)
+                {
+                    const MESH_TRIANGLE *triangle = &threads[t].triangles[bin[cursors[t]]];
+                    int left = SDL_max(triangle->minX, tileLeft);
+                    int right = SDL_min(triangle->maxX, tileLeft + MESH_RASTER_TILE_SIZE - 1);
+                    int top = SDL_max(triangle->minY, tileTop);
+                    int bottom = SDL_min(triangle->maxY, tileTop + MESH_RASTER_TILE_SIZE - 1);
+
+                    for (int y = top; y <= bottom; y++)
+                    {
+#ifdef MESH_RASTER_SSE2
+                        if (useSIMD)
+                            RasterizeSpanSSE2(triangle, left, right, y);
+                        else
+#endif
+                            RasterizeSpanScalar(triangle, left, right, y);
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+bool MeshRaster_Init(int threadCount, bool simd)
+{
+    if (threadCount <= 0)
+        threadCount = SDL_GetCPUCount();
+    if (threadCount > MESH_RASTER_MAX_THREADS)
+        threadCount = MESH_RASTER_MAX_THREADS;
+    if (threadCount < 1)
+        threadCount = 1;
+
+#ifdef MESH_RASTER_SSE2
+    useSIMD = simd && SDL_HasSSE2();
+#else
+    useSIMD = false;
+#endif
+
+    SDL_AtomicSet(&quitting, 0);
+    workAvailable = SDL_CreateSemaphore(0);
+    workDone = SDL_CreateSemaphore(0);
+    if (workAvailable == NULL || workDone == NULL)
+        return false;
+
+    // Fewer workers than requested is not an error; the calling thread can do all the work itself.
+    for (int i = 0; i < threadCount - 1; i++)
+    {
+        SDL_Thread *worker = SDL_CreateThread(MeshWorker, "mesh raster", NULL);
+        if (worker == NULL)
+            break;
+
+        workers[workerCount] = worker;
+        workerCount++;
+    }
+
+    SDL_zero(stats);
+    LOG_INFO(LOG_CATEGORY_RENDER, "Drawing models on the CPU on %d threads with %s kernels", workerCount + 1, useSIMD ? "SSE2" : "scalar");
+
+    return true;
+}
+
+
+void MeshRaster_Quit(void)
+{
+    SDL_AtomicSet(&quitting, 1);
+    for (int i = 0; i < workerCount; i++)
+        SDL_SemPost(workAvailable);
+
+    for (int i = 0; i < workerCount; i++)
+        SDL_WaitThread(workers[i], NULL);
+    workerCount = 0;
+
+    if (workAvailable)
+        SDL_DestroySemaphore(workAvailable);
+    if (workDone)
+        SDL_DestroySemaphore(workDone);
+    workAvailable = NULL;
+    workDone = NULL;
+
+    for (int i = 0; i < MESH_RASTER_MAX_THREADS; i++)
+    {
+        std::vector<MESH_VERTEX>().swap(threads[i].vertices);
+        std::vector<MESH_TRIANGLE>().swap(threads[i].triangles);
+        std::vector<std::vector<uint32_t>>().swap(threads[i].bins);
+    }
+    std::vector<int>().swap(tileQueue);
+    pending = false;
+    pendingDraws = 0;
+    tilesX = 0;
+    tilesY = 0;
+}
+
+
+void MeshRaster_Draw(const MESH_RASTER_TARGET *drawTarget, const MODEL *model, int firstIndex, int indexCount,
+    const float *viewProjection, const RENDER_INSTANCE *instances, int instanceCount)
+{
+    if (instanceCount <= 0 || indexCount < 3)
+        return;
+
+    if (pending && memcmp(drawTarget, &target, sizeof(target)) != 0)
+        MeshRaster_Flush();
+
+    if (!pending)
+    {
+        target = *drawTarget;
+
+        // The bins only ever grow, so a steady frame allocates nothing.
+        tilesX = (target.width + MESH_RASTER_TILE_SIZE - 1) / MESH_RASTER_TILE_SIZE;
+        tilesY = (target.height + MESH_RASTER_TILE_SIZE - 1) / MESH_RASTER_TILE_SIZE;
+        for (int i = 0; i <= workerCount; i++)
+        {
+            if ((int)threads[i].bins.size() < tilesX * tilesY)
+                threads[i].bins.resize(tilesX * tilesY);
+        }
+    }
+
+    draw.model = model;
+    draw.firstIndex = firstIndex;
+    draw.indexCount = indexCount;
+    memcpy(draw.viewProjection, viewProjection, sizeof(draw.viewProjection));
+    draw.instances = instances;
+    draw.instanceCount = instanceCount;
+
+    int slotCount = SDL_min(instanceCount, workerCount + 1);
+    for (int i = 0; i < slotCount; i++)
+        threads[i].binnedTriangles = 0;
+
+    RunJob(DrawJob, slotCount);
+
+    // The stages run back to back on each thread; the slowest thread decides how long each took.
+    uint64_t transformTime = 0;
+    uint64_t binTime = 0;
+    for (int i = 0; i < slotCount; i++)
+    {
+        transformTime = SDL_max(transformTime, threads[i].transformTime);
+        binTime = SDL_max(binTime, threads[i].binTime);
+        stats.binnedTriangles += threads[i].binnedTriangles;
+    }
+
+    stats.draws++;
+    stats.instances += instanceCount;
+    stats.triangles += (uint32_t)((indexCount / 3) * instanceCount);
+    stats.transformMilliseconds += TicksToMilliseconds(transformTime);
+    stats.binMilliseconds += TicksToMilliseconds(binTime);
+
+    pending = true;
+    pendingDraws++;
+    drawnThisFrame = true;
+}
+
+
+bool MeshRaster_Flush(void)
+{
+    if (!pending)
+        return false;
+
+    uint64_t start = SDL_GetPerformanceCounter();
+    int threadCount = workerCount + 1;
+
+    tileQueue.clear();
+    for (int tile = 0; tile < tilesX * tilesY; tile++)
+    {
+        size_t count = 0;
+        for (int t = 0; t < threadCount; t++)
+            count += threads[t].bins[tile].size();
+
+        if (count > 0)
+        {
+            tileQueue.push_back(tile);
+            stats.tileTriangles += (uint32_t)count;
+        }
+    }
+
+    SDL_AtomicSet(&nextTile, 0);
+    RunJob(RasterJob, SDL_min((int)tileQueue.size(), threadCount));
+
+    for (size_t i = 0; i < tileQueue.size(); i++)
+    {
+        for (int t = 0; t < threadCount; t++)
+            threads[t].bins[tileQueue[i]].clear();
+    }
+    for (int t = 0; t < threadCount; t++)
+        threads[t].triangles.clear();
+
+    pending = false;
+    pendingDraws = 0;
+    stats.rasterMilliseconds += TicksToMilliseconds(SDL_GetPerformanceCounter() - start);
+
+    return true;
+}
+
+
+void MeshRaster_EndFrame(void)
+{
+    if (drawnThisFrame)
+        stats.frames++;
+    drawnThisFrame = false;
+}
+
+
+void MeshRaster_TakeStats(MESH_RASTER_STATS *taken)
+{
+    *taken = stats;
+    SDL_zero(stats);
+}
+
+
+void MeshRaster_LogStatistics(void)
+{
+    MESH_RASTER_STATS taken;
+    MeshRaster_TakeStats(&taken);
+    if (taken.frames == 0)
+        return;
+
+    double frames = taken.frames;
+    LOG_INFO(LOG_CATEGORY_RENDER, "Models on the CPU, per frame: %.0f triangles, %.0f binned, %.0f tile triangles; transform %.3f ms, bin %.3f ms, raster %.3f ms",
+        taken.triangles / frames, taken.binnedTriangles / frames, taken.tileTriangles / frames,
+        taken.transformMilliseconds / frames, taken.binMilliseconds / frames, taken.rasterMilliseconds / frames);
+}
@@ -0,0 +1,87 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "model.h"
+#include "renderbackend.h"
+#include "SDL_rect.h"
+
+
+// At most this many threads rasterize at once, the calling thread included.
+#define MESH_RASTER_MAX_THREADS (16)
+// Triangles are binned into square tiles of this many pixels, and each tile is rasterized by one thread.
+#define MESH_RASTER_TILE_SIZE (64)
+
+
+// Where models are drawn: packed R, G, B, A pixels and one depth value per pixel, both width wide.
+typedef struct
+{
+    unsigned char *pixels;
+    float *depth;
+    int width;
+    int height;
+    // Pixels that may be written.
+    SDL_Rect clip;
+    // The area clip space is mapped to, in pixels.
+    SDL_Rect viewport;
+} MESH_RASTER_TARGET;
+
+// What the rasterizer did since the statistics were last taken. Times are wall clock; the transform and
+// bin stages count the slowest thread of each draw.
+typedef struct
+{
+    uint32_t frames;
+    uint32_t draws;
+    uint32_t instances;
+    uint32_t triangles;
+    // Triangles left after dropping those off the target, edge-on or behind the eye.
+    uint32_t binnedTriangles;
+    // Triangle and tile pairs rasterized.
+    uint32_t tileTriangles;
+    double transformMilliseconds;
+    double binMilliseconds;
+    double rasterMilliseconds;
+} MESH_RASTER_STATS;
+
+
+// Start the worker threads. A thread count of 0 uses one thread per core; 1 draws on the calling thread only.
+// With simd set, the transform and the rasterizer use SSE2 where it is compiled in.
+bool MeshRaster_Init(int threadCount, bool simd);
+void MeshRaster_Quit(void);
+
+// Transform, light and bin the instances of a model, the way RENDER_BACKEND's DrawModel describes.
+// Nothing is written to the target until MeshRaster_Flush, which happens first if the target differs
+// from the one already binned for. Only one thread may draw at a time.
+void MeshRaster_Draw(const MESH_RASTER_TARGET *target, const MODEL *model, int firstIndex, int indexCount,
+    const float *viewProjection, const RENDER_INSTANCE *instances, int instanceCount);
+
+// Rasterize the binned triangles into their target, tiles in parallel. Returns false if nothing was binned.
+bool MeshRaster_Flush(void);
+
+// Count a frame in the statistics if anything was drawn since the last one.
+void MeshRaster_EndFrame(void);
+
+// Copy the statistics and start over.
+void MeshRaster_TakeStats(MESH_RASTER_STATS *stats);
+// Log the per frame averages since the statistics were last taken, if any frame drew models, and start over.
+void MeshRaster_LogStatistics(void);
@@ -0,0 +1,420 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <vector>
+
+#include "arena.h"
+#include "mipchain.h"
+#include "logger.h"
+#include "raster.h"
+#include "SDL.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_CHAIN_SSE2
+#include <emmintrin.h>
+#endif
+
+
+// One level of the chain: every piece at the same size, premultiplied and tightly packed.
+typedef struct
+{
+    int size;
+    unsigned char *pixels[SVG_ASSET_COUNT];
+} MIP_LEVEL;
+
+// Source pixels that make up each output pixel along one axis. Every output pixel has the same number
+// of taps, unused ones weighted 0, so the filter loops never branch on the count.
+typedef struct
+{
+    int count;
+    // First source pixel of each output pixel.
+    std::vector<int> first;
+    // count weights per output pixel.
+    std::vector<float> weights;
+} MIP_TAPS;
+
+// All levels share one allocation, largest first.
+static unsigned char *chainPixels = NULL;
+static MIP_LEVEL levels[MIP_CHAIN_MAX_LEVELS];
+static int levelCount = 0;
+
+
+// Internal function.
+// Rasterize every piece at the master size, then premultiply, since filtering needs premultiplied pixels.
+static void RasterizeMaster(const MIP_LEVEL *master)
+{
+    RASTER_ITEM items[SVG_ASSET_COUNT];
+    for (int svg = 0; svg < SVG_ASSET_COUNT; svg++)
+    {
+        items[svg].image = svgAssets[svg];
+        items[svg].scale = master->size / svgAssets[svg]->width;
+        items[svg].destination = master->pixels[svg];
+        items[svg].width = master->size;
+        items[svg].height = master->size;
+        items[svg].stride = master->size * 4;
+    }
+    Raster_Run(items, SVG_ASSET_COUNT);
+
+    size_t pixelCount = (size_t)master->size * master->size;
+    for (int svg = 0; svg < SVG_ASSET_COUNT; svg++)
+    {
+        unsigned char *pixel = master->pixels[svg];
+        for (size_t i = 0; i < pixelCount; i++, pixel += 4)
+        {
+            int alpha = pixel[3];
+            pixel[0] = (unsigned char)((pixel[0] * alpha + 127) / 255);
+            pixel[1] = (unsigned char)((pixel[1] * alpha + 127) / 255);
+            pixel[2] = (unsigned char)((pixel[2] * alpha + 127) / 255);
+        }
+    }
+}
+
+
+// Internal function.
+// Average each 2x2 block of a premultiplied image into one pixel of an image half the size.
+static void BoxDownsample(const unsigned char *source, int sourceSize, unsigned char *destination)
+{
+    int size = sourceSize / 2;
+    int sourcePitch = sourceSize * 4;
+
+    for (int y = 0; y < size; y++)
+    {
+        const unsigned char *top = &source[(size_t)(y * 2) * sourcePitch];
+        const unsigned char *bottom = top + sourcePitch;
+        unsigned char *out = &destination[(size_t)y * size * 4];
+        int x = 0;
+
+#ifdef MIP_CHAIN_SSE2
+        // Four source pixels of each row make two output pixels, with the same rounding as below.
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        for (; x + 2 <= size; x += 2)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)&top[x * 8]);
+            __m128i b = _mm_loadu_si128((const __m128i*)&bottom[x * 8]);
+            __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+            low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+            high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+            __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(low, high), two), 2);
+            _mm_storel_epi64((__m128i*)&out[x * 4], _mm_packus_epi16(sum, sum));
+        }
+#endif
+
+        for (; x < size; x++)
+        {
+            for (int channel = 0; channel < 4; channel++)
+            {
+                int sum = top[x * 8 + channel] + top[x * 8 + 4 + channel] + bottom[x * 8 + channel] + bottom[x * 8 + 4 + channel];
+                out[x * 4 + channel] = (unsigned char)((sum + 2) >> 2);
+            }
+        }
+    }
+}
+
+
+bool MipChain_Init(int masterSize)
+{
+    levelCount = 0;
+    if (masterSize <= 0)
+        return true;
+
+    // Powers of two halve evenly all the way down.
+    int size = MIP_CHAIN_MIN_SIZE;
+    while (size < masterSize)
+        size *= 2;
+
+    size_t total = 0;
+    for (int level = size; level >= MIP_CHAIN_MIN_SIZE && levelCount < MIP_CHAIN_MAX_LEVELS; level /= 2)
+    {
+        levels[levelCount].size = level;
+        levelCount++;
+        total += (size_t)level * level * 4 * SVG_ASSET_COUNT;
+    }
+
+    chainPixels = new unsigned char[total];
+    unsigned char *next = chainPixels;
+    for (int level = 0; level < levelCount; level++)
+    {
+        for (int svg = 0; svg < SVG_ASSET_COUNT; svg++)
+        {
+            levels[level].pixels[svg] = next;
+            next += (size_t)levels[level].size * levels[level].size * 4;
+        }
+    }
+
+    uint64_t start = SDL_GetPerformanceCounter();
+
+    RasterizeMaster(&levels[0]);
+    for (int level = 1; level < levelCount; level++)
+    {
+        for (int svg = 0; svg < SVG_ASSET_COUNT; svg++)
+            BoxDownsample(levels[level - 1].pixels[svg], levels[level - 1].size, levels[level].pixels[svg]);
+    }
+
+    double milliseconds = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    LOG_INFO(LOG_CATEGORY_RENDER, "Mip chain: %d levels from %dpx, %zu bytes, built in %.1f ms",
+        levelCount, size, total, milliseconds);
+
+    return true;
+}
+
+
+void MipChain_Quit(void)
+{
+    delete[] chainPixels;
+    chainPixels = NULL;
+    levelCount = 0;
+}
+
+
+int MipChain_MasterSize(void)
+{
+    return levelCount > 0 ? levels[0].size : 0;
+}
+
+
+bool MipChain_Covers(int size)
+{
+    return levelCount > 0 && size > 0 && size <= levels[0].size;
+}
+
+
+// Internal function.
+// Box filter weights for scaling sourceSize pixels down to size: each output pixel averages the source
+// area it covers, with partly covered source pixels weighted by how much of them it covers.
+static void ComputeTaps(int sourceSize, int size, MIP_TAPS *taps)
+{
+    float ratio = (float)sourceSize / size;
+
+    // A box ratio wide starting part way into a pixel can touch one more pixel than it covers whole.
+    int whole = (int)SDL_ceil(ratio);
+    taps->count = SDL_min(whole == ratio ? whole : whole + 1, sourceSize);
+    taps->first.resize(size);
+    taps->weights.resize((size_t)size * taps->count);
+
+    for (int i = 0; i < size; i++)
+    {
+        float start = i * ratio;
+        float end = start + ratio;
+        int first = SDL_min((int)start, sourceSize - taps->count);
+
+        taps->first[i] = first;
+        for (int k = 0; k < taps->count; k++)
+        {
+            int source = first + k;
+            float covered = SDL_min(end, source + 1.0f) - SDL_max(start, (float)source);
+            taps->weights[(size_t)i * taps->count + k] = covered > 0.0f ? covered / ratio : 0.0f;
+        }
+    }
+}
+
+
+// Internal function.
+// Turn premultiplied float pixels into non-premultiplied byte pixels, rounding to nearest.
+static void StorePixels(const float *premultiplied, int count, unsigned char *out)
+{
+    for (int x = 0; x < count; x++, premultiplied += 4, out += 4)
+    {
+#ifdef MIP_CHAIN_SSE2
+        // Branch free: nearly transparent pixels are divided by a safe alpha and then masked to 0.
+        __m128 sum = _mm_loadu_ps(premultiplied);
+        __m128 alphas = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 3, 3));
+        __m128 visible = _mm_cmpge_ps(alphas, _mm_set1_ps(0.5f));
+        __m128 color = _mm_div_ps(_mm_mul_ps(sum, _mm_set1_ps(255.0f)), _mm_max_ps(alphas, _mm_set1_ps(0.5f)));
+        // Alpha itself is not divided: lanes r, g, b from color, then alpha.
+        __m128 blue = _mm_shuffle_ps(color, alphas, _MM_SHUFFLE(0, 0, 2, 2));
+        __m128 pixel = _mm_shuffle_ps(color, blue, _MM_SHUFFLE(2, 0, 1, 0));
+        pixel = _mm_and_ps(_mm_min_ps(_mm_add_ps(pixel, _mm_set1_ps(0.5f)), _mm_set1_ps(255.0f)), visible);
+        __m128i bytes = _mm_cvttps_epi32(pixel);
+        bytes = _mm_packs_epi32(bytes, bytes);
+        int packed = _mm_cvtsi128_si32(_mm_packus_epi16(bytes, bytes));
+        memcpy(out, &packed, 4);
+#else
+        float alpha = premultiplied[3];
+        if (alpha < 0.5f)
+        {
+            out[0] = out[1] = out[2] = out[3] = 0;
+            continue;
+        }
+
+        float unpremultiply = 255.0f / alpha;
+        for (int channel = 0; channel < 3; channel++)
+            out[channel] = (unsigned char)SDL_min(premultiplied[channel] * unpremultiply + 0.5f, 255.0f);
+        out[3] = (unsigned char)SDL_min(alpha + 0.5f, 255.0f);
+#endif
+    }
+}
+
+
+// Internal function.
+// Scale a premultiplied square image down with box filter taps, one output row at a time: the source rows
+// under it are blended into one float row, which is then filtered across and converted straight into out.
+static void ResampleArea(const unsigned char *source, int sourceSize, int size, unsigned char *destination, int stride)
+{
+    MIP_TAPS taps;
+    ComputeTaps(sourceSize, size, &taps);
+
+    // The rows come from the thread's scratch arena, or the heap for masters too large for it.
+    int rowFloats = sourceSize * 4;
+    ARENA *scratch = Arena_Thread();
+    size_t mark = scratch != NULL ? Arena_Mark(scratch) : 0;
+    float *row = scratch != NULL ? ARENA_ARRAY(scratch, float, rowFloats) : NULL;
+    float *filtered = scratch != NULL ? ARENA_ARRAY(scratch, float, (size_t)size * 4) : NULL;
+
+    std::vector<float> heapRows;
+    if (row == NULL || filtered == NULL)
+    {
+        heapRows.resize((size_t)rowFloats + ((size_t)size * 4));
+        row = heapRows.data();
+        filtered = &heapRows[rowFloats];
+    }
+
+    for (int y = 0; y < size; y++)
+    {
+        const unsigned char *rows = &source[(size_t)taps.first[y] * rowFloats];
+        const float *rowWeight = &taps.weights[(size_t)y * taps.count];
+        int i = 0;
+
+#ifdef MIP_CHAIN_SSE2
+        // Sixteen channels, four pixels, at a time.
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= rowFloats; i += 16)
+        {
+            __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps(), sum2 = _mm_setzero_ps(), sum3 = _mm_setzero_ps();
+            for (int k = 0; k < taps.count; k++)
+            {
+                __m128i bytes = _mm_loadu_si128((const __m128i*)&rows[(size_t)k * rowFloats + i]);
+                __m128i low = _mm_unpacklo_epi8(bytes, zero);
+                __m128i high = _mm_unpackhi_epi8(bytes, zero);
+                __m128 weight = _mm_set1_ps(rowWeight[k]);
+                sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), weight));
+                sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), weight));
+                sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), weight));
+                sum3 = _mm_add_ps(sum3, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), weight));
+            }
+            _mm_storeu_ps(&row[i], sum0);
+            _mm_storeu_ps(&row[i + 4], sum1);
+            _mm_storeu_ps(&row[i + 8], sum2);
+            _mm_storeu_ps(&row[i + 12], sum3);
+        }
+#endif
+
+        for (; i < rowFloats; i++)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < taps.count; k++)
+                sum += rows[(size_t)k * rowFloats + i] * rowWeight[k];
+            row[i] = sum;
+        }
+
+        for (int x = 0; x < size; x++)
+        {
+            const float *weight = &taps.weights[(size_t)x * taps.count];
+            const float *pixel = &row[taps.first[x] * 4];
+            float *sum = &filtered[x * 4];
+#ifdef MIP_CHAIN_SSE2
+            __m128 total = _mm_setzero_ps();
+            for (int k = 0; k < taps.count; k++, pixel += 4)
+                total = _mm_add_ps(total, _mm_mul_ps(_mm_loadu_ps(pixel), _mm_set1_ps(weight[k])));
+            _mm_storeu_ps(sum, total);
+#else
+            sum[0] = sum[1] = sum[2] = sum[3] = 0.0f;
+            for (int k = 0; k < taps.count; k++, pixel += 4)
+            {
+                for (int channel = 0; channel < 4; channel++)
+                    sum[channel] += pixel[channel] * weight[k];
+            }
+#endif
+        }
+
+        StorePixels(filtered, size, &destination[(size_t)y * stride]);
+    }
+
+    if (scratch != NULL)
+        Arena_Release(scratch, mark);
+}
+
+
+// Internal function.
+// Give fully transparent pixels the average color of their visible neighbours, like nsvgRasterize does,
+// so linear filtering of the atlas does not bleed black into the edges.
+static void Defringe(unsigned char *pixels, int size, int stride)
+{
+    for (int y = 0; y < size; y++)
+    {
+        unsigned char *pixel = &pixels[(size_t)y * stride];
+        for (int x = 0; x < size; x++, pixel += 4)
+        {
+            if (pixel[3] != 0)
+                continue;
+
+            int r = 0, g = 0, b = 0, n = 0;
+            if (x > 0 && pixel[-1] != 0)
+            {
+                r += pixel[-4];
+                g += pixel[-3];
+                b += pixel[-2];
+                n++;
+            }
+            if (x + 1 < size && pixel[7] != 0)
+            {
+                r += pixel[4];
+                g += pixel[5];
+                b += pixel[6];
+                n++;
+            }
+            if (y > 0 && pixel[3 - stride] != 0)
+            {
+                r += pixel[-stride];
+                g += pixel[1 - stride];
+                b += pixel[2 - stride];
+                n++;
+            }
+            if (y + 1 < size && pixel[3 + stride] != 0)
+            {
+                r += pixel[stride];
+                g += pixel[1 + stride];
+                b += pixel[2 + stride];
+                n++;
+            }
+
+            if (n > 0)
+            {
+                pixel[0] = (unsigned char)(r / n);
+                pixel[1] = (unsigned char)(g / n);
+                pixel[2] = (unsigned char)(b / n);
+            }
+        }
+    }
+}
+
+
+void MipChain_Resample(SVGAssetIndex svg, int size, unsigned char *destination, int stride)
+{
+    // The smallest level still at least as large as the tile, so the filter only ever shrinks.
+    int level = 0;
+    while (level + 1 < levelCount && levels[level + 1].size >= size)
+        level++;
+
+    ResampleArea(levels[level].pixels[svg], levels[level].size, size, destination, stride);
+    Defringe(destination, size, stride);
+}
@@ -0,0 +1,48 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include "asset.h"
+
+
+// Master resolution the pieces are rasterized at when the game starts.
+#define MIP_CHAIN_DEFAULT_MASTER_SIZE (512)
+// The chain stops halving below this size.
+#define MIP_CHAIN_MIN_SIZE (8)
+#define MIP_CHAIN_MAX_LEVELS (16)
+
+
+// Every piece rasterized once at a master resolution and halved down to a chain of smaller levels.
+// Tile sizes up to the master size are resampled from the nearest larger level, so they never run nanosvg.
+// A master size of 0 disables the chain. Needs the raster subsystem for the master rasterization.
+bool MipChain_Init(int masterSize);
+void MipChain_Quit(void);
+
+// The master size in use, rounded up to a power of two, or 0 when disabled.
+int MipChain_MasterSize(void);
+
+// Whether pieces of this size can be resampled from the chain.
+bool MipChain_Covers(int size);
+
+// Draw one piece at the given size, non-premultiplied RGBA like nsvgRasterize, with transparent pixels
+// defringed. Only reads the chain, so any number of threads may call it at once. Size must be covered.
+void MipChain_Resample(SVGAssetIndex svg, int size, unsigned char *destination, int stride);
@@ -17,3 +17,232 @@
     You should have received a copy of the GNU General Public License
     along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
 */
+
+#include <math.h>
+#include <string.h>
+#include <unordered_map>
+#include "logger.h"
+#include "model.h"
+#include "SDL.h"
+
+
+MODEL models[OBJ_ASSET_SHAPE_COUNT];
+
+
+// Internal function.
+// A position and normal pair, as one key. tinyobj marks a missing normal with -1, which becomes 0.
+static uint64_t VertexKey(const tinyobj::index_t &index)
+{
+    return ((uint64_t)(uint32_t)index.vertex_index << 32) | (uint32_t)(index.normal_index + 1);
+}
+
+
+// Internal function.
+static void AddFaceNormal(float *vertices, uint32_t a, uint32_t b, uint32_t c)
+{
+    const float *p0 = &vertices[a * MODEL_VERTEX_FLOATS];
+    const float *p1 = &vertices[b * MODEL_VERTEX_FLOATS];
+    const float *p2 = &vertices[c * MODEL_VERTEX_FLOATS];
+
+    float u[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    float v[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    // Not normalized, so larger faces weigh more.
+    float normal[3] = { (u[1] * v[2]) - (u[2] * v[1]), (u[2] * v[0]) - (u[0] * v[2]), (u[0] * v[1]) - (u[1] * v[0]) };
+
+    uint32_t corners[3] = { a, b, c };
+    for (int corner = 0; corner < 3; corner++)
+    {
+        float *vertexNormal = &vertices[(corners[corner] * MODEL_VERTEX_FLOATS) + 3];
+        vertexNormal[0] += normal[0];
+        vertexNormal[1] += normal[1];
+        vertexNormal[2] += normal[2];
+    }
+}
+
+
+bool Model_Build(const tinyobj::attrib_t &attributes, const std::vector<tinyobj::shape_t> &shapes, MODEL *model)
+{
+    SDL_zerop(model);
+
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<bool> derivedNormals;
+    std::unordered_map<uint64_t, uint32_t> vertexIndices;
+    int positionCount = (int)(attributes.vertices.size() / 3);
+    int normalCount = (int)(attributes.normals.size() / 3);
+
+    for (size_t shape = 0; shape < shapes.size(); shape++)
+    {
+        const tinyobj::mesh_t &mesh = shapes[shape].mesh;
+        size_t firstIndex = indices.size();
+        size_t offset = 0;
+
+        for (size_t face = 0; face < mesh.num_face_vertices.size(); face++)
+        {
+            int cornerCount = mesh.num_face_vertices[face];
+            uint32_t corners[3];
+            for (int corner = 0; corner < cornerCount; corner++)
+            {
+                const tinyobj::index_t &index = mesh.indices[offset + corner];
+                if (index.vertex_index < 0 || index.vertex_index >= positionCount || index.normal_index >= normalCount)
+                {
+                    LOG_ERROR(LOG_CATEGORY_ASSET, "Model_Build: face %d refers to a vertex that does not exist", (int)face);
+                    return false;
+                }
+
+                uint64_t key = VertexKey(index);
+                std::unordered_map<uint64_t, uint32_t>::iterator found = vertexIndices.find(key);
+                uint32_t vertex;
+                if (found != vertexIndices.end())
+                    vertex = found->second;
+                else
+                {
+                    vertex = (uint32_t)(vertices.size() / MODEL_VERTEX_FLOATS);
+                    vertexIndices[key] = vertex;
+
+                    const float *position = &attributes.vertices[index.vertex_index * 3];
+                    vertices.insert(vertices.end(), position, position + 3);
+                    if (index.normal_index >= 0)
+                    {
+                        const float *normal = &attributes.normals[index.normal_index * 3];
+                        vertices.insert(vertices.end(), normal, normal + 3);
+                    }
+                    else
+                        vertices.insert(vertices.end(), 3, 0.0f);
+                    derivedNormals.push_back(index.normal_index < 0);
+                }
+
+                // Fan out from the first corner.
+                if (corner < 2)
+                    corners[corner] = vertex;
+                else
+                {
+                    corners[2] = vertex;
+                    indices.insert(indices.end(), corners, corners + 3);
+                    corners[1] = vertex;
+                }
+            }
+            offset += cornerCount;
+        }
+
+        int indexCount = (int)(indices.size() - firstIndex);
+        if (indexCount == 0)
+            continue;
+
+        if (model->partCount == MODEL_MAX_PARTS)
+        {
+            LOG_ERROR(LOG_CATEGORY_ASSET, "Model_Build: more than %d groups with faces", MODEL_MAX_PARTS);
+            return false;
+        }
+
+        MODEL_PART *part = &model->parts[model->partCount++];
+        SDL_strlcpy(part->name, shapes[shape].name.c_str(), sizeof(part->name));
+        part->firstIndex = (int)firstIndex;
+        part->indexCount = indexCount;
+    }
+
+    model->vertexCount = (int)(vertices.size() / MODEL_VERTEX_FLOATS);
+    model->indexCount = (int)indices.size();
+    if (model->indexCount == 0)
+    {
+        LOG_ERROR(LOG_CATEGORY_ASSET, "Model_Build: the model has no faces");
+        return false;
+    }
+
+    // Normals the file left out are made up from the faces around the vertex.
+    for (int i = 0; i < model->indexCount; i += 3)
+    {
+        if (derivedNormals[indices[i]] || derivedNormals[indices[i + 1]] || derivedNormals[indices[i + 2]])
+            AddFaceNormal(vertices.data(), indices[i], indices[i + 1], indices[i + 2]);
+    }
+
+    model->vertices = new float[vertices.size()];
+    for (int vertex = 0; vertex < model->vertexCount; vertex++)
+    {
+        float *source = &vertices[vertex * MODEL_VERTEX_FLOATS];
+        float *destination = &model->vertices[vertex * MODEL_VERTEX_FLOATS];
+        memcpy(destination, source, sizeof(float) * MODEL_VERTEX_FLOATS);
+
+        if (derivedNormals[vertex])
+        {
+            float length = sqrtf((source[3] * source[3]) + (source[4] * source[4]) + (source[5] * source[5]));
+            for (int axis = 3; axis < 6 && length > 0.0f; axis++)
+                destination[axis] = source[axis] / length;
+        }
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (vertex == 0 || source[axis] < model->minimum[axis])
+                model->minimum[axis] = source[axis];
+            if (vertex == 0 || source[axis] > model->maximum[axis])
+                model->maximum[axis] = source[axis];
+        }
+    }
+
+    // Half the index memory for every model that is small enough, which is all of them.
+    model->wideIndices = model->vertexCount > 0x10000;
+    if (model->wideIndices)
+    {
+        uint32_t *wide = new uint32_t[model->indexCount];
+        memcpy(wide, indices.data(), sizeof(uint32_t) * model->indexCount);
+        model->indices = wide;
+    }
+    else
+    {
+        uint16_t *narrow = new uint16_t[model->indexCount];
+        for (int i = 0; i < model->indexCount; i++)
+            narrow[i] = (uint16_t)indices[i];
+        model->indices = narrow;
+    }
+
+    return true;
+}
+
+
+void Model_Free(MODEL *model)
+{
+    delete[] model->vertices;
+    if (model->wideIndices)
+        delete[] (uint32_t*)model->indices;
+    else
+        delete[] (uint16_t*)model->indices;
+
+    SDL_zerop(model);
+}
+
+
+const MODEL_PART* Model_FindPart(const MODEL *model, const char *name)
+{
+    for (int i = 0; i < model->partCount; i++)
+    {
+        if (SDL_strcmp(model->parts[i].name, name) == 0)
+            return &model->parts[i];
+    }
+
+    return NULL;
+}
+
+
+bool Model_Init(void)
+{
+    for (int i = 0; i < OBJ_ASSET_SHAPE_COUNT; i++)
+    {
+        if (!Model_Build(objAttributes->at(i), objShapes->at(i), &models[i]))
+        {
+            LOG_ERROR(LOG_CATEGORY_ASSET, "Model_Init: could not build %s", objAssetPaths[i]);
+            return false;
+        }
+
+        LOG_DEBUG(LOG_CATEGORY_ASSET, "Model %s: %d vertices, %d indices, %d parts",
+            objAssetPaths[i], models[i].vertexCount, models[i].indexCount, models[i].partCount);
+    }
+
+    return true;
+}
+
+
+void Model_Quit(void)
+{
+    for (int i = 0; i < OBJ_ASSET_SHAPE_COUNT; i++)
+        Model_Free(&models[i]);
+}
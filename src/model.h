@@ -19,3 +19,57 @@
 */
 
 #pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vector>
+#include "asset.h"
+
+
+// Position x, y, z, then normal x, y, z.
+#define MODEL_VERTEX_FLOATS (6)
+#define MODEL_MAX_PARTS (4)
+#define MODEL_PART_NAME_LENGTH (32)
+
+
+// A run of triangles from one group of the OBJ file, e.g. the dark squares of the board.
+typedef struct
+{
+    char name[MODEL_PART_NAME_LENGTH];
+    int firstIndex;
+    int indexCount;
+} MODEL_PART;
+
+// An OBJ model as one indexed triangle list, with every distinct position and normal pair stored once.
+typedef struct
+{
+    float *vertices;
+    int vertexCount;
+    // uint16_t when every vertex can be reached with one, uint32_t otherwise.
+    void *indices;
+    int indexCount;
+    bool wideIndices;
+
+    MODEL_PART parts[MODEL_MAX_PARTS];
+    int partCount;
+
+    // Bounds of the positions.
+    float minimum[3];
+    float maximum[3];
+} MODEL;
+
+// The models of the OBJ assets, by OBJAssetShapeIndex.
+extern MODEL models[OBJ_ASSET_SHAPE_COUNT];
+
+
+// Build the models from the loaded OBJ assets. Needs the asset subsystem.
+bool Model_Init(void);
+void Model_Quit(void);
+
+// Convert tinyobj's index triplets into a model. Faces with more than three corners are split into fans.
+// Vertices without a normal get the average normal of the faces around them.
+bool Model_Build(const tinyobj::attrib_t &attributes, const std::vector<tinyobj::shape_t> &shapes, MODEL *model);
+void Model_Free(MODEL *model);
+
+// The part with the given name, or NULL.
+const MODEL_PART* Model_FindPart(const MODEL *model, const char *name);
@@ -0,0 +1,232 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "extlibs/zlib/zlib.h"
+#include "png.h"
+#include "util.h"
+#include "SDL.h"
+
+
+#define PNG_SIGNATURE_LENGTH (8)
+
+static const unsigned char signature[PNG_SIGNATURE_LENGTH] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+
+// Internal function.
+static void PutBigEndian32(unsigned char *destination, uint32_t value)
+{
+    destination[0] = (unsigned char)(value >> 24);
+    destination[1] = (unsigned char)(value >> 16);
+    destination[2] = (unsigned char)(value >> 8);
+    destination[3] = (unsigned char)value;
+}
+
+
+// Internal function.
+static void AppendChunk(std::vector<unsigned char> *png, const char *type, const unsigned char *data, uint32_t length)
+{
+    size_t start = png->size();
+    png->resize(start + 12 + length);
+    unsigned char *chunk = &(*png)[start];
+
+    PutBigEndian32(chunk, length);
+    memcpy(chunk + 4, type, 4);
+    if (length > 0)
+        memcpy(chunk + 8, data, length);
+
+    // The CRC covers the type and the data.
+    PutBigEndian32(chunk + 8 + length, (uint32_t)crc32(crc32(0, Z_NULL, 0), chunk + 4, length + 4));
+}
+
+
+bool PNG_Encode(const unsigned char *image, int width, int height, std::vector<unsigned char> *filtered, std::vector<unsigned char> *compressed, std::vector<unsigned char> *png)
+{
+    // Every row starts with its filter type; 0 leaves it unfiltered.
+    size_t rowBytes = (size_t)width * 4;
+    filtered->resize((rowBytes + 1) * height);
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char *row = &(*filtered)[(rowBytes + 1) * y];
+        row[0] = 0;
+        memcpy(row + 1, image + (rowBytes * y), rowBytes);
+    }
+
+    uLongf compressedLength = compressBound((uLong)filtered->size());
+    compressed->resize(compressedLength);
+    if (compress2(compressed->data(), &compressedLength, filtered->data(), (uLong)filtered->size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+        return false;
+
+    unsigned char header[13];
+    PutBigEndian32(header, width);
+    PutBigEndian32(header + 4, height);
+    header[8] = 8;      // Bits per channel
+    header[9] = 6;      // Truecolor with alpha
+    header[10] = 0;     // Deflate
+    header[11] = 0;     // Adaptive filtering
+    header[12] = 0;     // Not interlaced
+
+    png->assign(signature, signature + sizeof(signature));
+    AppendChunk(png, "IHDR", header, sizeof(header));
+    AppendChunk(png, "IDAT", compressed->data(), (uint32_t)compressedLength);
+    AppendChunk(png, "IEND", NULL, 0);
+
+    return true;
+}
+
+
+// Internal function.
+static uint32_t GetBigEndian32(const unsigned char *source)
+{
+    return ((uint32_t)source[0] << 24) | ((uint32_t)source[1] << 16) | ((uint32_t)source[2] << 8) | source[3];
+}
+
+
+// Internal function.
+static int PaethPredictor(int left, int up, int upLeft)
+{
+    int estimate = left + up - upLeft;
+    int distanceLeft = SDL_abs(estimate - left);
+    int distanceUp = SDL_abs(estimate - up);
+    int distanceUpLeft = SDL_abs(estimate - upLeft);
+
+    if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft)
+        return left;
+    if (distanceUp <= distanceUpLeft)
+        return up;
+    return upLeft;
+}
+
+
+// Internal function.
+// Undo the filter of every row in place, then pack the rows without their filter bytes.
+static bool Unfilter(unsigned char *filtered, int width, int height, std::vector<unsigned char> *image)
+{
+    size_t rowBytes = (size_t)width * 4;
+    image->resize(rowBytes * height);
+
+    const unsigned char *previous = NULL;
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char filter = filtered[(rowBytes + 1) * y];
+        unsigned char *row = &filtered[((rowBytes + 1) * y) + 1];
+
+        for (size_t i = 0; i < rowBytes; i++)
+        {
+            int left = i >= 4 ? row[i - 4] : 0;
+            int up = previous != NULL ? previous[i] : 0;
+            int upLeft = (previous != NULL && i >= 4) ? previous[i - 4] : 0;
+
+            switch (filter)
+            {
+            case 0:
+                break;
+            case 1:
+                row[i] = (unsigned char)(row[i] + left);
+                break;
+            case 2:
+                row[i] = (unsigned char)(row[i] + up);
+                break;
+            case 3:
+                row[i] = (unsigned char)(row[i] + ((left + up) / 2));
+                break;
+            case 4:
+                row[i] = (unsigned char)(row[i] + PaethPredictor(left, up, upLeft));
+                break;
+            default:
+                return false;
+            }
+        }
+
+        memcpy(&(*image)[rowBytes * y], row, rowBytes);
+        previous = row;
+    }
+
+    return true;
+}
+
+
+bool PNG_Decode(const unsigned char *png, size_t length, std::vector<unsigned char> *image, int *width, int *height)
+{
+    if (length < PNG_SIGNATURE_LENGTH || memcmp(png, signature, PNG_SIGNATURE_LENGTH) != 0)
+        return false;
+
+    std::vector<unsigned char> compressed;
+    bool headerSeen = false;
+    bool endSeen = false;
+    size_t offset = PNG_SIGNATURE_LENGTH;
+    while (!endSeen && offset + 12 <= length)
+    {
+        uint32_t chunkLength = GetBigEndian32(&png[offset]);
+        const unsigned char *type = &png[offset + 4];
+        const unsigned char *data = &png[offset + 8];
+        if (chunkLength > length - offset - 12)
+            return false;
+
+        if (memcmp(type, "IHDR", 4) == 0)
+        {
+            // Only what PNG_Encode writes: 8 bits per channel, truecolor with alpha, not interlaced.
+            if (chunkLength != 13 || data[8] != 8 || data[9] != 6 || data[10] != 0 || data[11] != 0 || data[12] != 0)
+                return false;
+            *width = (int)GetBigEndian32(data);
+            *height = (int)GetBigEndian32(data + 4);
+            headerSeen = true;
+        }
+        else if (memcmp(type, "IDAT", 4) == 0)
+            compressed.insert(compressed.end(), data, data + chunkLength);
+        else if (memcmp(type, "IEND", 4) == 0)
+            endSeen = true;
+
+        offset += 12 + chunkLength;
+    }
+
+    if (!headerSeen || !endSeen || *width <= 0 || *height <= 0 || *width > 0x4000 || *height > 0x4000)
+        return false;
+
+    std::vector<unsigned char> filtered(((size_t)*width * 4 + 1) * *height);
+    uLongf filteredLength = (uLongf)filtered.size();
+    if (uncompress(filtered.data(), &filteredLength, compressed.data(), (uLong)compressed.size()) != Z_OK || filteredLength != filtered.size())
+        return false;
+
+    return Unfilter(filtered.data(), *width, *height, image);
+}
+
+
+bool PNG_Save(const char *path, const unsigned char *image, int width, int height)
+{
+    std::vector<unsigned char> filtered;
+    std::vector<unsigned char> compressed;
+    std::vector<unsigned char> png;
+    if (!PNG_Encode(image, width, height, &filtered, &compressed, &png))
+        return false;
+
+    return Util_WriteFile(path, png.data(), png.size());
+}
+
+
+bool PNG_Load(const char *path, std::vector<unsigned char> *image, int *width, int *height)
+{
+    std::vector<char> png;
+    if (!Util_ReadFile(path, &png))
+        return false;
+
+    // Without the NUL Util_ReadFile appends.
+    return PNG_Decode((const unsigned char*)png.data(), png.size() - 1, image, width, height);
+}
@@ -0,0 +1,36 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <vector>
+
+
+// Encode an RGBA image as an 8-bit truecolor PNG with alpha. The buffers are reused between calls.
+bool PNG_Encode(const unsigned char *image, int width, int height, std::vector<unsigned char> *filtered, std::vector<unsigned char> *compressed, std::vector<unsigned char> *png);
+
+// Decode an 8-bit truecolor PNG with alpha, as PNG_Encode writes, into RGBA rows from the top.
+// Other kinds of PNG are rejected.
+bool PNG_Decode(const unsigned char *png, size_t length, std::vector<unsigned char> *image, int *width, int *height);
+
+bool PNG_Save(const char *path, const unsigned char *image, int width, int height);
+bool PNG_Load(const char *path, std::vector<unsigned char> *image, int *width, int *height);
@@ -0,0 +1,277 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "queue.h"
+#include "memtrack.h"
+#include "SDL.h"
+
+
+// Dmitry Vyukov's bounded MPMC queue, with the consumer side simplified for a single consumer.
+// http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+// Each cell's sequence number says whose turn it is: it equals the position for a producer
+// to fill it, and the position plus one for the consumer to empty it.
+
+// Spins before a blocked push starts yielding its time slice.
+#define PUSH_SPIN_COUNT (64)
+
+// Keeps the producer and consumer positions on separate cache lines.
+#define CACHE_LINE_SIZE (64)
+
+typedef struct Cell
+{
+    SDL_atomic_t sequence;
+    void *item;
+} Cell;
+
+typedef struct Queue
+{
+    Cell *cells;
+    uint32_t mask;
+
+    char producerPadding[CACHE_LINE_SIZE];
+    SDL_atomic_t enqueuePosition;
+    SDL_atomic_t fullRejections;
+    SDL_atomic_t contendedRetries;
+    SDL_atomic_t blockedPushes;
+
+    char consumerPadding[CACHE_LINE_SIZE];
+    // Only touched by the consumer.
+    uint32_t dequeuePosition;
+} Queue;
+
+
+void* Queue_Create(size_t capacity)
+{
+    if (capacity > QUEUE_MAX_CAPACITY)
+        return NULL;
+
+    uint32_t cellCount = 2;
+    while (cellCount < capacity)
+        cellCount *= 2;
+
+    Queue *newQueue = Memory_Allocate(sizeof(Queue));
+    if (newQueue == NULL)
+        return NULL;
+
+    newQueue->cells = Memory_Allocate(cellCount * sizeof(Cell));
+    if (newQueue->cells == NULL)
+    {
+        Memory_Free(newQueue);
+        return NULL;
+    }
+
+    newQueue->mask = cellCount - 1;
+    for (uint32_t i = 0; i < cellCount; i++)
+    {
+        SDL_AtomicSet(&newQueue->cells[i].sequence, (int)i);
+        newQueue->cells[i].item = NULL;
+    }
+
+    SDL_AtomicSet(&newQueue->enqueuePosition, 0);
+    SDL_AtomicSet(&newQueue->fullRejections, 0);
+    SDL_AtomicSet(&newQueue->contendedRetries, 0);
+    SDL_AtomicSet(&newQueue->blockedPushes, 0);
+    newQueue->dequeuePosition = 0;
+
+    return newQueue;
+}
+
+
+void Queue_Destroy(void *queue, void (*itemDestroyFunction)(void*))
+{
+    if (queue == NULL)
+        return;
+
+    Queue *mpscQueue = (Queue*)queue;
+
+    // Destroy the items nobody took.
+    void *item;
+    while (Queue_TryPop(queue, &item))
+    {
+        if (itemDestroyFunction != NULL)
+            itemDestroyFunction(item);
+    }
+
+    Memory_Free(mpscQueue->cells);
+    Memory_Free(mpscQueue);
+}
+
+
+// Internal function.
+// Claims the next cell and fills it. Returns false if the queue is full.
+static bool PushInternal(Queue *mpscQueue, void *newItem)
+{
+    Cell *cell;
+    uint32_t position = (uint32_t)SDL_AtomicGet(&mpscQueue->enqueuePosition);
+    for (;;)
+    {
+        cell = &mpscQueue->cells[position & mpscQueue->mask];
+        int32_t difference = (int32_t)((uint32_t)SDL_AtomicGet(&cell->sequence) - position);
+
+        // The cell is free at this position. Try to claim it.
+        if (difference == 0)
+        {
+            if (SDL_AtomicCAS(&mpscQueue->enqueuePosition, (int)position, (int)(position + 1)))
+                break;
+
+            SDL_AtomicIncRef(&mpscQueue->contendedRetries);
+        }
+        // The consumer has not emptied the cell from the previous lap yet.
+        else if (difference < 0)
+            return false;
+
+        // Another producer got here first.
+        position = (uint32_t)SDL_AtomicGet(&mpscQueue->enqueuePosition);
+    }
+
+    cell->item = newItem;
+
+    // Hand the cell to the consumer. SDL_AtomicSet is only an acquire barrier on some compilers,
+    // so a release barrier keeps the item from becoming visible after the sequence.
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&cell->sequence, (int)(position + 1));
+
+    return true;
+}
+
+
+bool Queue_TryPush(void *queue, void *newItem)
+{
+    if (queue == NULL)
+        return false;
+
+    Queue *mpscQueue = (Queue*)queue;
+
+    if (PushInternal(mpscQueue, newItem))
+        return true;
+
+    SDL_AtomicIncRef(&mpscQueue->fullRejections);
+    return false;
+}
+
+
+bool Queue_Push(void *queue, void *newItem)
+{
+    if (queue == NULL)
+        return false;
+
+    Queue *mpscQueue = (Queue*)queue;
+
+    if (PushInternal(mpscQueue, newItem))
+        return true;
+
+    SDL_AtomicIncRef(&mpscQueue->blockedPushes);
+
+    // Spin briefly, then give the consumer the processor until there is room.
+    int attempts = 0;
+    while (!PushInternal(mpscQueue, newItem))
+    {
+        if (++attempts > PUSH_SPIN_COUNT)
+            SDL_Delay(0);
+    }
+
+    return true;
+}
+
+
+bool Queue_TryPop(void *queue, void **removedItem)
+{
+    if (queue == NULL)
+        return false;
+    else if (removedItem == NULL)
+        return false;
+
+    Queue *mpscQueue = (Queue*)queue;
+
+    uint32_t position = mpscQueue->dequeuePosition;
+    Cell *cell = &mpscQueue->cells[position & mpscQueue->mask];
+
+    // The producer of this position has not finished yet.
+    int32_t difference = (int32_t)((uint32_t)SDL_AtomicGet(&cell->sequence) - (position + 1));
+    if (difference < 0)
+        return false;
+
+    // Pairs with the producer's release barrier, so the item is not read before the sequence.
+    SDL_MemoryBarrierAcquire();
+    *removedItem = cell->item;
+
+    // Hand the cell to the producer of the next lap, after the item has been read.
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&cell->sequence, (int)(position + mpscQueue->mask + 1));
+    mpscQueue->dequeuePosition = position + 1;
+
+    return true;
+}
+
+
+size_t Queue_Drain(void *queue, void **removedItems, size_t maxItems)
+{
+    size_t drained = 0;
+
+    while (drained < maxItems && Queue_TryPop(queue, &removedItems[drained]))
+        drained++;
+
+    return drained;
+}
+
+
+size_t Queue_Count(void *queue)
+{
+    if (queue == NULL)
+        return 0;
+
+    Queue *mpscQueue = (Queue*)queue;
+
+    uint32_t count = (uint32_t)SDL_AtomicGet(&mpscQueue->enqueuePosition) - mpscQueue->dequeuePosition;
+
+    // Claimed positions can briefly run ahead of filled cells.
+    if (count > mpscQueue->mask + 1)
+        count = mpscQueue->mask + 1;
+
+    return count;
+}
+
+
+size_t Queue_Capacity(void *queue)
+{
+    if (queue == NULL)
+        return 0;
+
+    return ((Queue*)queue)->mask + 1;
+}
+
+
+void Queue_GetStatistics(void *queue, QUEUE_STATISTICS *statistics)
+{
+    if (statistics == NULL)
+        return;
+
+    SDL_zerop(statistics);
+    if (queue == NULL)
+        return;
+
+    Queue *mpscQueue = (Queue*)queue;
+
+    statistics->pushed = (uint32_t)SDL_AtomicGet(&mpscQueue->enqueuePosition);
+    statistics->popped = mpscQueue->dequeuePosition;
+    statistics->fullRejections = (uint32_t)SDL_AtomicGet(&mpscQueue->fullRejections);
+    statistics->contendedRetries = (uint32_t)SDL_AtomicGet(&mpscQueue->contendedRetries);
+    statistics->blockedPushes = (uint32_t)SDL_AtomicGet(&mpscQueue->blockedPushes);
+}
@@ -0,0 +1,77 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+
+// Bounded lock-free queue for handing items from any number of threads to a single consumer thread.
+// Any thread may push. Only one thread, the consumer, may pop or drain.
+
+// Sequences are stored as int and compared as signed differences, so the cell count stays far below 2^31.
+#define QUEUE_MAX_CAPACITY ((size_t)1 << 30)
+
+typedef struct
+{
+    // Items pushed and popped since creation. Both wrap around at 2^32.
+    uint32_t pushed;
+    uint32_t popped;
+    // Non-blocking pushes refused because the queue was full.
+    uint32_t fullRejections;
+    // Pushes that had to retry because another producer claimed the same slot first.
+    uint32_t contendedRetries;
+    // Blocking pushes that had to wait for the consumer.
+    uint32_t blockedPushes;
+} QUEUE_STATISTICS;
+
+
+// The capacity is rounded up to a power of two. Returns NULL above QUEUE_MAX_CAPACITY.
+void* Queue_Create(size_t capacity);
+// Only call once no thread can push anymore.
+void Queue_Destroy(void *queue, void (*itemDestroyFunction)(void*));
+
+// Producers: returns false if the queue is full.
+bool Queue_TryPush(void *queue, void *newItem);
+// Producers: waits for room while the queue is full. The consumer must keep draining, or this never returns.
+bool Queue_Push(void *queue, void *newItem);
+
+// Consumer: returns false if the queue is empty.
+bool Queue_TryPop(void *queue, void **removedItem);
+// Consumer: pop up to maxItems in order. Returns how many were popped.
+size_t Queue_Drain(void *queue, void **removedItems, size_t maxItems);
+
+// Approximate while producers are pushing.
+size_t Queue_Count(void *queue);
+size_t Queue_Capacity(void *queue);
+
+void Queue_GetStatistics(void *queue, QUEUE_STATISTICS *statistics);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,207 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "raster.h"
+#include "logger.h"
+#include "SDL.h"
+
+#define NANOSVGRAST_IMPLEMENTATION
+#include "nanosvgrast.h"
+
+
+// The calling thread uses rasterizer 0; worker i uses rasterizer i + 1.
+static NSVGrasterizer *rasterizers[RASTER_MAX_THREADS];
+static SDL_Thread *workers[RASTER_MAX_THREADS - 1];
+static int workerCount = 0;
+
+// Kernels every rasterizer uses, picked once from the CPU features.
+static int simdLevel = NSVG_SIMD_NONE;
+
+// Posted once per worker to start a job, and once by each worker when it runs out of items.
+static SDL_sem *workAvailable = NULL;
+static SDL_sem *workDone = NULL;
+static SDL_atomic_t quitting;
+
+// The job being run. Items are claimed one at a time with nextItem.
+static const RASTER_ITEM *jobItems = NULL;
+static int jobItemCount = 0;
+static SDL_atomic_t nextItem;
+
+
+// Internal function.
+// Rasterize items until none are left to claim.
+static void RunItems(NSVGrasterizer *rasterizer)
+{
+    for (;;)
+    {
+        int index = SDL_AtomicAdd(&nextItem, 1);
+        if (index >= jobItemCount)
+            break;
+
+        const RASTER_ITEM *item = &jobItems[index];
+        nsvgRasterize(rasterizer, item->image, 0, 0, item->scale, item->destination, item->width, item->height, item->stride);
+    }
+}
+
+
+static int SDLCALL RasterWorker(void *data)
+{
+    NSVGrasterizer *rasterizer = (NSVGrasterizer*)data;
+
+    for (;;)
+    {
+        SDL_SemWait(workAvailable);
+        if (SDL_AtomicGet(&quitting))
+            break;
+
+        RunItems(rasterizer);
+        SDL_SemPost(workDone);
+    }
+
+    return 0;
+}
+
+
+// Internal function.
+static const char *SIMDName(int level)
+{
+    switch (level)
+    {
+    case NSVG_SIMD_AVX2:
+        return "AVX2";
+    case NSVG_SIMD_SSE2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
+
+
+bool Raster_Init(int threadCount, bool simd)
+{
+    if (threadCount <= 0)
+        threadCount = SDL_GetCPUCount();
+    if (threadCount > RASTER_MAX_THREADS)
+        threadCount = RASTER_MAX_THREADS;
+    if (threadCount < 1)
+        threadCount = 1;
+
+    SDL_AtomicSet(&quitting, 0);
+
+    // The level is clamped to the kernels compiled in, so ask the rasterizer what it will really use.
+    int level = NSVG_SIMD_NONE;
+    if (simd && SDL_HasAVX2())
+        level = NSVG_SIMD_AVX2;
+    else if (simd && SDL_HasSSE2())
+        level = NSVG_SIMD_SSE2;
+
+    rasterizers[0] = nsvgCreateRasterizer();
+    if (rasterizers[0] == NULL)
+        return false;
+    simdLevel = nsvgSetRasterizerSIMD(rasterizers[0], level);
+
+    workAvailable = SDL_CreateSemaphore(0);
+    workDone = SDL_CreateSemaphore(0);
+    if (workAvailable == NULL || workDone == NULL)
+        return false;
+
+    // Fewer workers than requested is not an error; the calling thread can do all the work itself.
+    for (int i = 0; i < threadCount - 1; i++)
+    {
+        NSVGrasterizer *rasterizer = nsvgCreateRasterizer();
+        if (rasterizer == NULL)
+            break;
+        nsvgSetRasterizerSIMD(rasterizer, simdLevel);
+
+        SDL_Thread *worker = SDL_CreateThread(RasterWorker, "raster", rasterizer);
+        if (worker == NULL)
+        {
+            nsvgDeleteRasterizer(rasterizer);
+            break;
+        }
+
+        rasterizers[workerCount + 1] = rasterizer;
+        workers[workerCount] = worker;
+        workerCount++;
+    }
+
+    LOG_INFO(LOG_CATEGORY_RENDER, "Rasterizing on %d threads with %s kernels", workerCount + 1, SIMDName(simdLevel));
+
+    return true;
+}
+
+
+void Raster_Quit(void)
+{
+    SDL_AtomicSet(&quitting, 1);
+    for (int i = 0; i < workerCount; i++)
+        SDL_SemPost(workAvailable);
+
+    for (int i = 0; i < workerCount; i++)
+    {
+        SDL_WaitThread(workers[i], NULL);
+        nsvgDeleteRasterizer(rasterizers[i + 1]);
+        rasterizers[i + 1] = NULL;
+    }
+    workerCount = 0;
+
+    nsvgDeleteRasterizer(rasterizers[0]);
+    rasterizers[0] = NULL;
+
+    if (workAvailable)
+        SDL_DestroySemaphore(workAvailable);
+    if (workDone)
+        SDL_DestroySemaphore(workDone);
+    workAvailable = NULL;
+    workDone = NULL;
+}
+
+
+void Raster_Run(const RASTER_ITEM *items, int itemCount)
+{
+    jobItems = items;
+    jobItemCount = itemCount;
+    SDL_AtomicSet(&nextItem, 0);
+
+    // Wake no more workers than there are items for.
+    int helpers = (itemCount - 1) < workerCount ? (itemCount - 1) : workerCount;
+    for (int i = 0; i < helpers; i++)
+        SDL_SemPost(workAvailable);
+
+    RunItems(rasterizers[0]);
+
+    for (int i = 0; i < helpers; i++)
+        SDL_SemWait(workDone);
+
+    jobItems = NULL;
+    jobItemCount = 0;
+}
+
+
+int Raster_ThreadCount(void)
+{
+    return workerCount + 1;
+}
+
+
+int Raster_SIMDLevel(void)
+{
+    return simdLevel;
+}
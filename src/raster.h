@@ -0,0 +1,57 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include "nanosvg.h"
+
+
+// At most this many threads rasterize at once, the calling thread included.
+#define RASTER_MAX_THREADS (16)
+
+
+// One image to rasterize into its own region of a pixel buffer.
+typedef struct
+{
+    NSVGimage *image;
+    float scale;
+    unsigned char *destination;
+    int width;
+    int height;
+    // Bytes between the starts of two rows of the destination.
+    int stride;
+} RASTER_ITEM;
+
+
+// Start the worker threads. A thread count of 0 uses one thread per core; 1 rasterizes on the calling thread only.
+// With simd set, every rasterizer uses the widest SIMD kernels the CPU supports; otherwise the scalar code.
+bool Raster_Init(int threadCount, bool simd);
+void Raster_Quit(void);
+
+// Rasterize the items in parallel, each thread with its own rasterizer. Returns once all of them are done.
+// The destination regions must not overlap. Only one thread may call this at a time.
+void Raster_Run(const RASTER_ITEM *items, int itemCount);
+
+// Threads that take part in Raster_Run, the calling thread included.
+int Raster_ThreadCount(void);
+
+// The NSVG_SIMD_* level the rasterizers were given, for rasterizers created outside this module.
+int Raster_SIMDLevel(void);
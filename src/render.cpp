@@ -21,178 +21,621 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
+#include "animation.h"
+#include "arena.h"
 #include "asset.h"
 #include "game.h"
+#include "latency.h"
 #include "list.h"
+#include "logger.h"
 #include "main.h"
+#include "mipchain.h"
+#include "model.h"
+#include "raster.h"
 #include "render.h"
+#include "renderbackend.h"
+#include "snapshot.h"
+#include "spritecache.h"
 #include "SDL.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
-#define NANOSVGRAST_IMPLEMENTATION
-#include "nanosvgrast.h"
 
+// All pieces are rasterized into one atlas texture: light pieces on the top row, dark pieces below.
+#define ATLAS_COLUMNS (6)
+#define ATLAS_ROWS (2)
+// Transparent gutter around each cell, so filtering never picks up a neighbouring piece.
+#define ATLAS_PADDING (1)
+// Part of the sprite cache key. Bump it whenever the atlas layout changes, so old cached sets are not used.
+#define ATLAS_LAYOUT_VERSION (1)
 
-static NSVGrasterizer *svgRasterizerContext;
+typedef struct
+{
+    int column;
+    int row;
+    SVGAssetIndex svg;
+} ATLAS_CELL;
+
+// Atlas cell of every piece, indexed by GAME_PIECE.
+static constexpr ATLAS_CELL pieceAtlasCells[] =
+{
+    { -1, -1, SVG_ASSET_COUNT },        // PIECE_EMPTY
+    { 0, 0, SVG_PAWN_LIGHT },           // PIECE_PAWN
+    { 1, 0, SVG_KNIGHT_LIGHT },         // PIECE_KNIGHT
+    { 2, 0, SVG_BISHOP_LIGHT },         // PIECE_BISHOP
+    { 3, 0, SVG_ROOK_LIGHT },           // PIECE_ROOK
+    { 4, 0, SVG_QUEEN_LIGHT },          // PIECE_QUEEN
+    { 5, 0, SVG_KING_LIGHT },           // PIECE_KING
+    { 0, 1, SVG_PAWN_DARK },            // PIECE_BPAWN
+    { 1, 1, SVG_KNIGHT_DARK },          // PIECE_BKNIGHT
+    { 2, 1, SVG_BISHOP_DARK },          // PIECE_BBISHOP
+    { 3, 1, SVG_ROOK_DARK },            // PIECE_BROOK
+    { 4, 1, SVG_QUEEN_DARK },           // PIECE_BQUEEN
+    { 5, 1, SVG_KING_DARK }             // PIECE_BKING
+};
+#define PIECE_COUNT ((int)SDL_arraysize(pieceAtlasCells))
+static_assert(PIECE_COUNT == PIECE_BKING + 1, "Every GAME_PIECE needs an atlas cell.");
+
+// Model of every piece, indexed by GAME_PIECE. Dark pieces share the light ones' models.
+static const OBJAssetShapeIndex pieceModels[PIECE_COUNT] =
+{
+    OBJ_ASSET_SHAPE_COUNT,              // PIECE_EMPTY
+    OBJ_PAWN_SHAPE,                     // PIECE_PAWN
+    OBJ_KNIGHT_SHAPE,                   // PIECE_KNIGHT
+    OBJ_BISHOP_SHAPE,                   // PIECE_BISHOP
+    OBJ_ROOK_SHAPE,                     // PIECE_ROOK
+    OBJ_QUEEN_SHAPE,                    // PIECE_QUEEN
+    OBJ_KING_SHAPE,                     // PIECE_KING
+    OBJ_PAWN_SHAPE,                     // PIECE_BPAWN
+    OBJ_KNIGHT_SHAPE,                   // PIECE_BKNIGHT
+    OBJ_BISHOP_SHAPE,                   // PIECE_BBISHOP
+    OBJ_ROOK_SHAPE,                     // PIECE_BROOK
+    OBJ_QUEEN_SHAPE,                    // PIECE_BQUEEN
+    OBJ_KING_SHAPE                      // PIECE_BKING
+};
+
+// The piece models are a little wider than a square of the board model.
+#define PIECE_MODEL_SCALE (0.8f)
+// At most every square plus every animation, for one piece type.
+#define MAX_PIECE_INSTANCES ((NUM_RANKS * NUM_FILES) + ANIMATION_POOL_SIZE)
+
+// Wait this long after the last size change before rasterizing the pieces for the new size.
+#define RESIZE_SETTLE_MS (150)
+
+// Size and placement of the atlas for one tile size.
+typedef struct
+{
+    int size;
+    int width;
+    int height;
+    int pitch;
+    size_t bytes;
+    // Where each piece is in the atlas, indexed by GAME_PIECE.
+    SDL_Rect sourceRects[PIECE_COUNT];
+} ATLAS_LAYOUT;
+
+static RENDER_TEXTURE *pieceAtlas = NULL;
+static ATLAS_LAYOUT atlasLayout;
+
+// A rasterization running on its own thread, so resizing never waits for nanosvg.
+static struct
+{
+    ATLAS_LAYOUT layout;
+    unsigned char *pixels;
+    SDL_Thread *thread;
+    SDL_atomic_t finished;
+} atlasJob;
 
-typedef enum PieceTextureIndex
+// The checkerboard, drawn once per viewport size and copied into every frame.
+static RENDER_TEXTURE *boardLayer = NULL;
+// Size of the checkerboard drawn into the layer, which may be larger.
+static int boardLayerWidth = 0;
+static int boardLayerHeight = 0;
+// Set when the renderer lost the contents of its target textures.
+static SDL_atomic_t boardLayerLost;
+bool boardLayerEnabled = true;
+// Bumped whenever the atlas or the board layer is replaced, so frames drawn from the old ones are redrawn.
+static uint32_t atlasGeneration = 0;
+static uint32_t boardLayerGeneration = 0;
+
+// The board as last presented. Only the squares that changed since are drawn into it again.
+static RENDER_TEXTURE *frameLayer = NULL;
+// Set when the whole frame layer has to be drawn again.
+static SDL_atomic_t frameLayerLost;
+// Set when the window needs a present even though nothing changed, e.g. after being uncovered.
+static SDL_atomic_t presentRequested;
+
+// A frame to read back before it is presented. Set from the drawing thread only.
+static struct
+{
+    void *pixels;
+    int width;
+    int height;
+    int pitch;
+    bool finished;
+} capture;
+
+// What the frame layer holds, to tell which squares changed.
+typedef struct
 {
-    DARK_PAWN_TEXTURE,
-    DARK_ROOK_TEXTURE,
-    DARK_KNIGHT_TEXTURE,
-    DARK_BISHOP_TEXTURE,
-    DARK_QUEEN_TEXTURE,
-    DARK_KING_TEXTURE,
-    LIGHT_PAWN_TEXTURE,
-    LIGHT_ROOK_TEXTURE,
-    LIGHT_KNIGHT_TEXTURE,
-    LIGHT_BISHOP_TEXTURE,
-    LIGHT_QUEEN_TEXTURE,
-    LIGHT_KING_TEXTURE,
-    PIECE_TEXTURE_COUNT
-} PieceTextureIndex;
-static SDL_Texture *pieceTextures[12];
-static int svgDimension = 0;
+    bool valid;
+    int width;
+    int height;
+    uint32_t atlasGeneration;
+    uint32_t boardLayerGeneration;
+    GAME_PIECE pieces[NUM_RANKS][NUM_FILES];
+    int selectedRank;
+    int selectedFile;
+    // Squares under an animation, one bit per square.
+    uint64_t animatedSquares;
+} DRAWN_FRAME;
+
+static DRAWN_FRAME drawnFrame;
+
+// Draw calls issued so far this frame, and in the last complete frame.
+static uint32_t frameDrawCalls = 0;
+static uint32_t lastFrameDrawCalls = 0;
 
-static int viewportOriginX;
-static int viewportOriginY;
-static int viewportDimension;
+// The tile size the viewport asks for, and since when.
+static int wantedAtlasSize = 0;
+static uint32_t wantedSinceTicks = 0;
+
+// Board area as last computed by the game logic. Used for picking.
+static SDL_Rect logicViewport;
+
+// Board area currently applied to the renderer. Only touched while drawing.
+static SDL_Rect drawViewport;
+
+const SDL_Color boardLightColor = { 255, 206, 158, 255 };
+const SDL_Color boardDarkColor = { 209, 139, 71, 255 };
+static const SDL_Color backgroundColor = { 64, 64, 64, 64 };
+// Blended over the square the next move starts from.
+static const SDL_Color selectionColor = { 20, 85, 30, 128 };
 
 bool userClickedTileLastFrame;
 int lastFrameClickedRank;
 int lastFrameClickedFile;
+uint64_t lastFrameClickTime;
+uint64_t lastResizeTime = 0;
+
+// The input whose response was last presented, so each input is measured once.
+static uint64_t lastPresentedInputTime = 0;
+static uint64_t lastPresentedResizeTime = 0;
+// The latest resize whose pieces are still drawn scaled.
+static uint64_t unsharpResizeTime = 0;
+
+// Set by a resize event; the viewport is recomputed once per batch of events.
+static bool resizePending = false;
+// Output size carried by the last resize event.
+static int resizeWidth = 0;
+static int resizeHeight = 0;
+
+// The OBJ models as uploaded to the backend. All NULL if it cannot draw them, which leaves only the 2D view.
+static RENDER_MODEL *renderModels[OBJ_ASSET_SHAPE_COUNT];
+static bool modelsReady = false;
+// Set while the output shows the 3D view, which the 2D view has to replace in full.
+static bool lastFrame3D = false;
+
+static const SDL_Color lightPieceColor = { 230, 220, 200, 255 };
+static const SDL_Color darkPieceColor = { 70, 60, 55, 255 };
+// The selected piece instead of its usual color.
+static const SDL_Color selectedPieceColor = { 60, 170, 80, 255 };
 
 void GetTileAt(int x, int y, int *rank, int *file)
 {
-    int dimension = viewportDimension / 8.0f;
+    int dimension = logicViewport.w / 8.0f;
 
     if (rank != NULL)
-        *rank = (NUM_RANKS - 1) - ((y - viewportOriginY) / dimension);
+        *rank = (NUM_RANKS - 1) - ((y - logicViewport.y) / dimension);
 
     if (file != NULL)
-        *file = ((x - viewportOriginX) / dimension);
+        *file = ((x - logicViewport.x) / dimension);
 }
 
 
 void DestroySVGTextures(void)
 {
-    for (int i = 0; i < PIECE_TEXTURE_COUNT; i++)
-        SDL_DestroyTexture(pieceTextures[i]);
+    renderBackend->DestroyTexture(pieceAtlas);
+    pieceAtlas = NULL;
+    atlasLayout.size = 0;
 }
 
 
-void RasterizeSVGTextures(int size)
+// Sprite cache key of the current drawings and atlas layout for a tile size.
+// Sets resampled from the mip chain look slightly different from rasterized ones, so they are keyed apart.
+static uint64_t AtlasTheme(int size)
+{
+    uint64_t theme = svgAssetHash ^ ((uint64_t)ATLAS_LAYOUT_VERSION << 56);
+    if (MipChain_Covers(size))
+        theme ^= (uint64_t)MipChain_MasterSize() << 32;
+    return theme;
+}
+
+
+static void ComputeAtlasLayout(int size, ATLAS_LAYOUT *layout)
 {
-    // Allocate memory for rasterization.
-    unsigned char *pixels = new unsigned char[size * size * 4];
+    int cellStride = size + (2 * ATLAS_PADDING);
 
-    // Rasterize new textures.
-    for (int i = 0; i < PIECE_TEXTURE_COUNT; i++)
+    layout->size = size;
+    layout->width = ATLAS_COLUMNS * cellStride;
+    layout->height = ATLAS_ROWS * cellStride;
+    layout->pitch = layout->width * 4;
+    layout->bytes = (size_t)layout->height * layout->pitch;
+
+    SDL_zero(layout->sourceRects[PIECE_EMPTY]);
+    for (int piece = PIECE_EMPTY + 1; piece < PIECE_COUNT; piece++)
     {
-        // Last parameter is mislabeled by nanosvg.
-        // Parameter is the width of a single row of data, not the stride.
-        nsvgRasterize(svgRasterizerContext, svgAssets[i], 0, 0, 1, (unsigned char*)pixels, size, size, size * 4);
+        const ATLAS_CELL *cell = &pieceAtlasCells[piece];
+        SDL_Rect *source = &layout->sourceRects[piece];
+        source->x = (cell->column * cellStride) + ATLAS_PADDING;
+        source->y = (cell->row * cellStride) + ATLAS_PADDING;
+        source->w = size;
+        source->h = size;
+    }
+}
 
-        // Allocate a new texture.
-        if (pieceTextures[i] == NULL)
+
+// Rasterize every piece into zeroed pixels laid out as given. The gutters stay transparent.
+// Sizes the mip chain covers are resampled from it instead of running nanosvg again.
+// Safe to call off the render thread.
+static void RasterizeAtlas(const ATLAS_LAYOUT *layout, unsigned char *pixels)
+{
+    if (MipChain_Covers(layout->size))
+    {
+        for (int piece = PIECE_EMPTY + 1; piece < PIECE_COUNT; piece++)
         {
-            pieceTextures[i] = SDL_CreateTexture(sdlRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, size, size);
-            SDL_SetTextureBlendMode(pieceTextures[i], SDL_BLENDMODE_BLEND);
-            SDL_UpdateTexture(pieceTextures[i], NULL, pixels, size * 4);
+            const SDL_Rect *source = &layout->sourceRects[piece];
+            MipChain_Resample(pieceAtlasCells[piece].svg, layout->size, &pixels[(source->y * layout->pitch) + (source->x * 4)], layout->pitch);
         }
-        // Update the existing texture.
-        else
+        return;
+    }
+
+    RASTER_ITEM items[PIECE_COUNT - 1];
+    for (int piece = PIECE_EMPTY + 1; piece < PIECE_COUNT; piece++)
+    {
+        const SDL_Rect *source = &layout->sourceRects[piece];
+
+        // Scale the drawing to fill the cell. The stride is that of the whole atlas.
+        RASTER_ITEM *item = &items[piece - 1];
+        item->image = svgAssets[pieceAtlasCells[piece].svg];
+        item->scale = layout->size / item->image->width;
+        item->destination = &pixels[(source->y * layout->pitch) + (source->x * 4)];
+        item->width = layout->size;
+        item->height = layout->size;
+        item->stride = layout->pitch;
+    }
+
+    // The cells are disjoint, so the pieces rasterize in parallel.
+    Raster_Run(items, PIECE_COUNT - 1);
+}
+
+
+// Textures only ever grow: one that is already big enough is reused, and only its top left part is used.
+// Sets created if the texture was replaced, which loses its contents.
+static bool EnsureTextureSize(RENDER_TEXTURE **texture, RENDER_TEXTURE_ACCESS access, int width, int height, bool *created)
+{
+    int currentWidth = 0;
+    int currentHeight = 0;
+    if (*texture != NULL)
+        renderBackend->GetTextureSize(*texture, &currentWidth, &currentHeight);
+
+    *created = false;
+    if (*texture != NULL && currentWidth >= width && currentHeight >= height)
+        return true;
+
+    // Grow in both directions at once, so a drag resize does not create a texture per step.
+    renderBackend->DestroyTexture(*texture);
+    *texture = renderBackend->CreateTexture(access, SDL_max(width, currentWidth), SDL_max(height, currentHeight));
+    *created = *texture != NULL;
+
+    return *texture != NULL;
+}
+
+
+// Write a new atlas straight into the texture memory. Until this returns, the previous atlas is drawn.
+// If the upload fails, the atlas state still matches the texture: the previous atlas when the texture was kept,
+// and no atlas at all when it was replaced.
+static void UploadAtlas(const ATLAS_LAYOUT *layout, const unsigned char *pixels)
+{
+    // nanosvg writes R, G, B, A bytes, which is what streaming textures take.
+    bool created;
+    if (!EnsureTextureSize(&pieceAtlas, RENDER_TEXTURE_STREAMING, layout->width, layout->height, &created))
+    {
+        LOG_WARN(LOG_CATEGORY_RENDER, "Could not create the piece atlas texture");
+        DestroySVGTextures();
+        atlasGeneration++;
+        return;
+    }
+
+    if (created)
+        renderBackend->SetTextureBlend(pieceAtlas, RENDER_BLEND_ALPHA);
+
+    SDL_Rect region = { 0, 0, layout->width, layout->height };
+    void *destination;
+    int destinationPitch;
+    if (!renderBackend->LockTexture(pieceAtlas, &region, &destination, &destinationPitch))
+    {
+        LOG_WARN(LOG_CATEGORY_RENDER, "Could not lock the piece atlas texture");
+        if (created)
         {
-            SDL_DestroyTexture(pieceTextures[i]);
-            pieceTextures[i] = SDL_CreateTexture(sdlRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, size, size);
-            SDL_SetTextureBlendMode(pieceTextures[i], SDL_BLENDMODE_BLEND);
-            SDL_UpdateTexture(pieceTextures[i], NULL, pixels, size * 4);
+            // The new texture is blank and too big for the old layout.
+            DestroySVGTextures();
+            atlasGeneration++;
         }
+        return;
     }
 
-    delete pixels;
+    for (int row = 0; row < layout->height; row++)
+        memcpy((unsigned char*)destination + ((size_t)row * destinationPitch), pixels + ((size_t)row * layout->pitch), layout->pitch);
+
+    renderBackend->UnlockTexture(pieceAtlas);
+
+    atlasGeneration++;
+    atlasLayout = *layout;
 }
 
 
-bool Render_Init()
+// Build the atlas with cells of the given size before returning, from the sprite cache when it has them.
+void RasterizeSVGTextures(int size)
 {
-    SDL_Rect viewport;
-    SDL_RenderGetViewport(sdlRenderer, &viewport);
+    ATLAS_LAYOUT layout;
+    ComputeAtlasLayout(size, &layout);
 
-    if (viewport.w < viewport.h)
-        viewportDimension = viewport.w;
-    else
-        viewportDimension = viewport.h;
+    const unsigned char *pixels = SpriteCache_Find(size, AtlasTheme(size), layout.bytes);
+    if (pixels != NULL)
+    {
+        UploadAtlas(&layout, pixels);
+        return;
+    }
 
-    svgRasterizerContext = nsvgCreateRasterizer();
-    if (!svgRasterizerContext)
-        return false;
+    unsigned char *rasterized = new unsigned char[layout.bytes]();
+    RasterizeAtlas(&layout, rasterized);
+    UploadAtlas(&layout, rasterized);
+
+    // The cache owns the new set from here on.
+    SpriteCache_Insert(size, AtlasTheme(size), rasterized, layout.bytes);
+}
 
-    RasterizeSVGTextures(viewportDimension / 8.0f);
 
-    return true;
+static int SDLCALL AtlasJobThread(void *data)
+{
+    RasterizeAtlas(&atlasJob.layout, atlasJob.pixels);
+    SDL_AtomicSet(&atlasJob.finished, 1);
+    return 0;
 }
 
-static void ResizeViewport(int32_t width, int32_t height)
+
+static void StartAtlasJob(int size)
 {
-    int minimum = 0;
-    bool heightIsMinimum = false;
-    if (width > height)
+    ComputeAtlasLayout(size, &atlasJob.layout);
+    atlasJob.pixels = new unsigned char[atlasJob.layout.bytes]();
+    SDL_AtomicSet(&atlasJob.finished, 0);
+
+    atlasJob.thread = SDL_CreateThread(AtlasJobThread, "AtlasJob", NULL);
+    if (atlasJob.thread == NULL)
     {
-        minimum = height;
-        heightIsMinimum = true;
+        // Without a thread the resize has to wait after all.
+        RasterizeAtlas(&atlasJob.layout, atlasJob.pixels);
+        UploadAtlas(&atlasJob.layout, atlasJob.pixels);
+        SpriteCache_Insert(size, AtlasTheme(size), atlasJob.pixels, atlasJob.layout.bytes);
+        atlasJob.pixels = NULL;
     }
-    else
+}
+
+
+// Wait for a running rasterization and drop its result.
+static void CancelAtlasJob(void)
+{
+    if (atlasJob.thread == NULL)
+        return;
+
+    SDL_WaitThread(atlasJob.thread, NULL);
+    atlasJob.thread = NULL;
+
+    delete[] atlasJob.pixels;
+    atlasJob.pixels = NULL;
+}
+
+
+// Bring the atlas towards the tile size of the drawn viewport without ever blocking on nanosvg.
+// Sizes in the sprite cache are swapped in at once. Others are rasterized on their own thread once the
+// size has settled; meanwhile the current atlas is drawn scaled. Must be called on the render thread.
+static void UpdateAtlas(void)
+{
+    int size = drawViewport.w / 8;
+    if (size <= 0)
+        return;
+
+    if (atlasJob.thread != NULL && SDL_AtomicGet(&atlasJob.finished))
     {
-        minimum = width;
-        heightIsMinimum = false;
+        SDL_WaitThread(atlasJob.thread, NULL);
+        atlasJob.thread = NULL;
+
+        // A set for a size the window has since left still goes into the cache.
+        if (atlasJob.layout.size == size)
+            UploadAtlas(&atlasJob.layout, atlasJob.pixels);
+        SpriteCache_Insert(atlasJob.layout.size, AtlasTheme(atlasJob.layout.size), atlasJob.pixels, atlasJob.layout.bytes);
+        atlasJob.pixels = NULL;
     }
 
-    viewportDimension = minimum;
+    if (atlasLayout.size == size)
+    {
+        wantedAtlasSize = size;
+        return;
+    }
 
-    int letterBoxWidth = 0;
-    if (heightIsMinimum)
+    if (size != wantedAtlasSize)
     {
-        letterBoxWidth = (width - height) / 2;
+        wantedAtlasSize = size;
+        wantedSinceTicks = SDL_GetTicks();
 
-        SDL_Rect newViewport = { letterBoxWidth, 0, minimum, minimum };
-        SDL_RenderSetViewport(sdlRenderer, &newViewport);
+        // Sizes seen before need neither settling nor rasterizing.
+        ATLAS_LAYOUT layout;
+        ComputeAtlasLayout(size, &layout);
+        const unsigned char *pixels = SpriteCache_Find(size, AtlasTheme(size), layout.bytes);
+        if (pixels != NULL)
+        {
+            UploadAtlas(&layout, pixels);
+            return;
+        }
+    }
+
+    if (atlasJob.thread == NULL && SDL_TICKS_PASSED(SDL_GetTicks(), wantedSinceTicks + RESIZE_SETTLE_MS))
+        StartAtlasJob(size);
+}
 
-        viewportOriginX = letterBoxWidth;
+
+// Letterbox a square board into a drawable area of the given size.
+static void ComputeViewport(int32_t width, int32_t height)
+{
+    if (width > height)
+    {
+        logicViewport.x = (width - height) / 2;
+        logicViewport.y = 0;
+        logicViewport.w = height;
+        logicViewport.h = height;
     }
     else
     {
-        letterBoxWidth = (height - width) / 2;
-        SDL_Rect newViewport = { 0, letterBoxWidth, minimum, minimum };
-        SDL_RenderSetViewport(sdlRenderer, &newViewport);
+        logicViewport.x = 0;
+        logicViewport.y = (height - width) / 2;
+        logicViewport.w = width;
+        logicViewport.h = width;
+    }
+}
+
+
+// Bring the renderer in line with the board area of a snapshot.
+// Must be called on the thread that draws.
+static void ApplyViewport(const SDL_Rect *viewport)
+{
+    if (viewport->w <= 0)
+        return;
+
+    if (SDL_RectEquals(viewport, &drawViewport))
+        return;
+
+    renderBackend->SetViewport(viewport);
+
+    drawViewport = *viewport;
+}
+
 
-        viewportOriginY = letterBoxWidth;
+static void DestroyModels(void)
+{
+    for (int i = 0; i < OBJ_ASSET_SHAPE_COUNT; i++)
+    {
+        if (renderModels[i] != NULL)
+            renderBackend->DestroyModel(renderModels[i]);
+        renderModels[i] = NULL;
     }
+
+    modelsReady = false;
 }
 
 
-static void ProcessEvent(SDL_Event *sdlEvent)
+bool Render_Init()
 {
-    int drawableWidth = 0;
-    int drawableHeight = 0;
+    int outputWidth = 0;
+    int outputHeight = 0;
+    renderBackend->GetOutputSize(&outputWidth, &outputHeight);
+
+    ComputeViewport(outputWidth, outputHeight);
+
+    ApplyViewport(&logicViewport);
+
+    // There is nothing to scale yet, so the first atlas is built before returning.
+    if (logicViewport.w > 0)
+        RasterizeSVGTextures(logicViewport.w / 8);
+    wantedAtlasSize = atlasLayout.size;
+
+    modelsReady = true;
+    for (int i = 0; i < OBJ_ASSET_SHAPE_COUNT; i++)
+    {
+        renderModels[i] = renderBackend->CreateModel(&models[i]);
+        if (renderModels[i] == NULL)
+            modelsReady = false;
+    }
+
+    if (!modelsReady)
+    {
+        LOG_INFO(LOG_CATEGORY_RENDER, "The %s backend cannot draw models; the board stays in 2D", renderBackend->name);
+        DestroyModels();
+    }
+
+    return true;
+}
+
+
+void Render_GetViewport(SDL_Rect *viewport)
+{
+    *viewport = logicViewport;
+}
+
+
+uint32_t Render_LastFrameDrawCalls(void)
+{
+    return lastFrameDrawCalls;
+}
+
+
+void Render_RequestCapture(void *pixels, int width, int height, int pitch)
+{
+    capture.pixels = pixels;
+    capture.width = width;
+    capture.height = height;
+    capture.pitch = pitch;
+    capture.finished = false;
+}
+
+
+bool Render_CaptureFinished(void)
+{
+    bool finished = capture.finished;
+    capture.finished = false;
+    return finished;
+}
+
+
+static void ProcessEvent(BUFFERED_EVENT *bufferedEvent)
+{
+    SDL_Event *sdlEvent = &bufferedEvent->event;
     switch (sdlEvent->type)
     {
         case SDL_WINDOWEVENT:
         {
             switch (sdlEvent->window.event)
             {
+            case SDL_WINDOWEVENT_EXPOSED:
+                SDL_AtomicSet(&presentRequested, 1);
+                break;
             case SDL_WINDOWEVENT_RESIZED:
-                SDL_GL_GetDrawableSize(sdlWindow, &drawableWidth, &drawableHeight);
-                ResizeViewport(drawableWidth, drawableHeight);
-                RasterizeSVGTextures(viewportDimension / 8.0f);
+                // Only the last of a drag's worth of resizes matters. The new textures are
+                // rasterized by the renderer once it sees the new viewport.
+                resizePending = true;
+                resizeWidth = bufferedEvent->outputWidth;
+                resizeHeight = bufferedEvent->outputHeight;
+                lastResizeTime = bufferedEvent->arrivalTime;
                 break;
             }
             break;
         }
+        case SDL_RENDER_TARGETS_RESET:
+        case SDL_RENDER_DEVICE_RESET:
+        {
+            // Redrawn by the render thread before its next use.
+            SDL_AtomicSet(&boardLayerLost, 1);
+            SDL_AtomicSet(&frameLayerLost, 1);
+            break;
+        }
         case SDL_MOUSEBUTTONDOWN:
         {
             if (sdlEvent->button.button == SDL_BUTTON_LEFT && sdlEvent->button.clicks == 1)
             {
                 userClickedTileLastFrame = true;
+                lastFrameClickTime = bufferedEvent->arrivalTime;
                 GetTileAt(sdlEvent->button.x, sdlEvent->button.y, &lastFrameClickedRank, &lastFrameClickedFile);
             }
             break;
@@ -203,86 +646,64 @@ static void ProcessEvent(SDL_Event *sdlEvent)
 
 void Render_Logic(uint32_t currentTick)
 {
-    void *listIterator = List_IteratorCreate(sdlEventBuffer);
+    LIST_ITERATOR iteratorStorage;
+    void *listIterator = List_IteratorInit(&iteratorStorage, sdlEventBuffer);
 
     userClickedTileLastFrame = false;
 
-    SDL_Event *currentEvent;
+    BUFFERED_EVENT *currentEvent;
     while (List_IteratorNext(listIterator, (void**)&currentEvent))
         ProcessEvent(currentEvent);
+
+    // The size was taken on the main thread, since this may run on the logic thread.
+    if (resizePending)
+    {
+        ComputeViewport(resizeWidth, resizeHeight);
+        resizePending = false;
+    }
 }
 
 
 void Render_Quit(void)
 {
+    CancelAtlasJob();
     DestroySVGTextures();
-    nsvgDeleteRasterizer(svgRasterizerContext);
+
+    renderBackend->DestroyTexture(boardLayer);
+    boardLayer = NULL;
+
+    renderBackend->DestroyTexture(frameLayer);
+    frameLayer = NULL;
+    drawnFrame.valid = false;
+
+    DestroyModels();
 }
 
 
-void Render_Draw(uint32_t currentTick, double interpolation)
+static void DrawPiece(GAME_PIECE piece, const SDL_Rect *destination, uint8_t alpha)
 {
-    SDL_SetRenderDrawColor(sdlRenderer, 64, 64, 64, 64);
-    SDL_RenderClear(sdlRenderer);
+    if (piece == PIECE_EMPTY || pieceAtlas == NULL)
+        return;
 
+    renderBackend->Blit(pieceAtlas, &atlasLayout.sourceRects[piece], destination, alpha);
+    frameDrawCalls++;
+}
+
+
+// The checkerboard as 64 fills, into the current render target.
+static void DrawBoardSquares(int xInc, int yInc)
+{
     bool lightChecker = true;
     int y = 0;
-    int xInc = viewportDimension / 8.0f;
-    int yInc = viewportDimension / 8.0f;
     for (int rank = 0; rank < NUM_RANKS; rank++)
     {
         float x = 0;
         for (int file = 0; file < NUM_FILES; file++)
         {
-            if (lightChecker)
-                SDL_SetRenderDrawColor(sdlRenderer, 255, 206, 158, 255);
-            else
-                SDL_SetRenderDrawColor(sdlRenderer, 209, 139, 71, 255);
             SDL_Rect checker = { x, y, xInc, yInc };
-            SDL_RenderFillRect(sdlRenderer, &checker);
-            //SDL_Rect piece = { x + (xInc / 8), y + (yInc / 8), xInc, yInc };
-            SDL_Rect piece = checker;
-
-            switch (boardState.pieces[(NUM_RANKS - 1) - rank][file])
-            {
-            case PIECE_PAWN:
-                SDL_RenderCopy(sdlRenderer, pieceTextures[LIGHT_PAWN_TEXTURE], NULL, &piece);
-                break;
-            case PIECE_ROOK:
-                SDL_RenderCopy(sdlRenderer, pieceTextures[LIGHT_ROOK_TEXTURE], NULL, &piece);
-                break;
-            case PIECE_KNIGHT:
-                SDL_RenderCopy(sdlRenderer, pieceTextures[LIGHT_KNIGHT_TEXTURE], NULL, &piece);
-                break;
-            case PIECE_BISHOP:
-                SDL_RenderCopy(sdlRenderer, pieceTextures[LIGHT_BISHOP_TEXTURE], NULL, &piece);
-                break;
-            case PIECE_QUEEN:
-                SDL_RenderCopy(sdlRenderer, pieceTextures[LIGHT_QUEEN_TEXTURE], NULL, &piece);
-                break;
-            case PIECE_KING:
-                SDL_RenderCopy(sdlRenderer, pieceTextures[LIGHT_KING_TEXTURE], NULL, &piece);
-                break;
+            renderBackend->FillRect(&checker, lightChecker ? boardLightColor : boardDarkColor);
+            frameDrawCalls++;
 
-            case PIECE_BPAWN:
-                SDL_RenderCopy(sdlRenderer, pieceTextures[DARK_PAWN_TEXTURE], NULL, &piece);
-                break;
-            case PIECE_BROOK:
-                SDL_RenderCopy(sdlRenderer, pieceTextures[DARK_ROOK_TEXTURE], NULL, &piece);
-                break;
-            case PIECE_BKNIGHT:
-                SDL_RenderCopy(sdlRenderer, pieceTextures[DARK_KNIGHT_TEXTURE], NULL, &piece);
-                break;
-            case PIECE_BBISHOP:
-                SDL_RenderCopy(sdlRenderer, pieceTextures[DARK_BISHOP_TEXTURE], NULL, &piece);
-                break;
-            case PIECE_BQUEEN:
-                SDL_RenderCopy(sdlRenderer, pieceTextures[DARK_QUEEN_TEXTURE], NULL, &piece);
-                break;
-            case PIECE_BKING:
-                SDL_RenderCopy(sdlRenderer, pieceTextures[DARK_KING_TEXTURE], NULL, &piece);
-                break;
-            }
             x += xInc;
 
             if (lightChecker)
@@ -298,6 +719,463 @@ void Render_Draw(uint32_t currentTick, double interpolation)
 
         y += yInc;
     }
+}
+
+
+// Make sure the board layer holds the checkerboard for the drawn viewport.
+// Returns false if the renderer cannot draw into textures, or the layer is turned off.
+static bool UpdateBoardLayer(void)
+{
+    if (!boardLayerEnabled || !renderBackend->TargetsSupported())
+        return false;
+
+    bool created;
+    if (!EnsureTextureSize(&boardLayer, RENDER_TEXTURE_TARGET, drawViewport.w, drawViewport.h, &created))
+        return false;
+
+    // The layer is opaque where it matters; copy it without blending.
+    if (created)
+        renderBackend->SetTextureBlend(boardLayer, RENDER_BLEND_NONE);
+
+    bool lost = SDL_AtomicSet(&boardLayerLost, 0) != 0;
+    if (!created && !lost && boardLayerWidth == drawViewport.w && boardLayerHeight == drawViewport.h)
+        return true;
+
+    // The viewport is restored when the output is drawn to again.
+    if (!renderBackend->SetTarget(boardLayer))
+        return false;
+
+    // Whatever the squares do not cover looks like the background.
+    renderBackend->Clear(backgroundColor);
+    frameDrawCalls++;
+    DrawBoardSquares(drawViewport.w / 8.0f, drawViewport.h / 8.0f);
+
+    renderBackend->SetTarget(NULL);
+    boardLayerWidth = drawViewport.w;
+    boardLayerHeight = drawViewport.h;
+    boardLayerGeneration++;
 
-    SDL_RenderPresent(sdlRenderer);
+    return true;
+}
+
+
+// Make sure the frame layer can hold the drawn viewport. A new layer is marked for a full redraw.
+static bool UpdateFrameLayer(void)
+{
+    if (!renderBackend->TargetsSupported())
+        return false;
+
+    bool created;
+    if (!EnsureTextureSize(&frameLayer, RENDER_TEXTURE_TARGET, drawViewport.w, drawViewport.h, &created))
+    {
+        drawnFrame.valid = false;
+        return false;
+    }
+
+    if (created)
+    {
+        renderBackend->SetTextureBlend(frameLayer, RENDER_BLEND_NONE);
+        drawnFrame.valid = false;
+    }
+
+    return true;
+}
+
+
+static uint64_t SquareBit(int rank, int file)
+{
+    return (uint64_t)1 << ((rank * NUM_FILES) + file);
+}
+
+
+// Every square between the start and the end of each animation, since the piece passes over them.
+static uint64_t GetAnimatedSquares(const GAME_SNAPSHOT *snapshot)
+{
+    uint64_t squares = 0;
+    for (int i = 0; i < ANIMATION_POOL_SIZE; i++)
+    {
+        const ANIMATION *animation = &snapshot->animations[i];
+        if (!animation->active)
+            continue;
+
+        for (int rank = SDL_min(animation->fromRank, animation->toRank); rank <= SDL_max(animation->fromRank, animation->toRank); rank++)
+        {
+            for (int file = SDL_min(animation->fromFile, animation->toFile); file <= SDL_max(animation->fromFile, animation->toFile); file++)
+                squares |= SquareBit(rank, file);
+        }
+    }
+
+    return squares;
+}
+
+
+// The squares of the frame layer that no longer match the snapshot.
+static uint64_t GetDirtySquares(const GAME_SNAPSHOT *snapshot, uint64_t animatedSquares)
+{
+    if (SDL_AtomicSet(&frameLayerLost, 0) != 0)
+        drawnFrame.valid = false;
+
+    if (!drawnFrame.valid || drawnFrame.width != drawViewport.w || drawnFrame.height != drawViewport.h
+        || drawnFrame.atlasGeneration != atlasGeneration || drawnFrame.boardLayerGeneration != boardLayerGeneration)
+    {
+        return ~(uint64_t)0;
+    }
+
+    // Squares animated last frame still show the piece where it was.
+    uint64_t dirty = animatedSquares | drawnFrame.animatedSquares;
+
+    for (int rank = 0; rank < NUM_RANKS; rank++)
+    {
+        for (int file = 0; file < NUM_FILES; file++)
+        {
+            if (snapshot->board.pieces[rank][file] != drawnFrame.pieces[rank][file])
+                dirty |= SquareBit(rank, file);
+        }
+    }
+
+    if (snapshot->selectedRank != drawnFrame.selectedRank || snapshot->selectedFile != drawnFrame.selectedFile)
+    {
+        if (drawnFrame.selectedRank >= 0 && drawnFrame.selectedRank < NUM_RANKS && drawnFrame.selectedFile >= 0 && drawnFrame.selectedFile < NUM_FILES)
+            dirty |= SquareBit(drawnFrame.selectedRank, drawnFrame.selectedFile);
+        if (snapshot->selectedRank >= 0 && snapshot->selectedRank < NUM_RANKS && snapshot->selectedFile >= 0 && snapshot->selectedFile < NUM_FILES)
+            dirty |= SquareBit(snapshot->selectedRank, snapshot->selectedFile);
+    }
+
+    return dirty;
+}
+
+
+static void RememberDrawnFrame(const GAME_SNAPSHOT *snapshot, uint64_t animatedSquares)
+{
+    drawnFrame.valid = true;
+    drawnFrame.width = drawViewport.w;
+    drawnFrame.height = drawViewport.h;
+    drawnFrame.atlasGeneration = atlasGeneration;
+    drawnFrame.boardLayerGeneration = boardLayerGeneration;
+    memcpy(drawnFrame.pieces, snapshot->board.pieces, sizeof(drawnFrame.pieces));
+    drawnFrame.selectedRank = snapshot->selectedRank;
+    drawnFrame.selectedFile = snapshot->selectedFile;
+    drawnFrame.animatedSquares = animatedSquares;
+}
+
+
+// Whether a square's piece is currently being drawn by a move animation instead.
+static bool IsAnimationTarget(const GAME_SNAPSHOT *snapshot, int rank, int file)
+{
+    for (int i = 0; i < ANIMATION_POOL_SIZE; i++)
+    {
+        const ANIMATION *animation = &snapshot->animations[i];
+        if (animation->active && animation->kind == ANIMATION_MOVE && animation->toRank == rank && animation->toFile == file)
+            return true;
+    }
+
+    return false;
+}
+
+
+// Captured pieces fade out underneath; moving pieces slide on top.
+static void DrawAnimations(const GAME_SNAPSHOT *snapshot, double interpolation, int xInc, int yInc)
+{
+    for (int pass = 0; pass < 2; pass++)
+    {
+        ANIMATION_KIND passKind = (pass == 0) ? ANIMATION_CAPTURE : ANIMATION_MOVE;
+
+        for (int i = 0; i < ANIMATION_POOL_SIZE; i++)
+        {
+            const ANIMATION *animation = &snapshot->animations[i];
+            if (!animation->active || animation->kind != passKind)
+                continue;
+
+            float progress = Animation_Progress(animation, snapshot->tick, interpolation);
+
+            float fromX = animation->fromFile * xInc;
+            float fromY = ((NUM_RANKS - 1) - animation->fromRank) * yInc;
+            float toX = animation->toFile * xInc;
+            float toY = ((NUM_RANKS - 1) - animation->toRank) * yInc;
+
+            SDL_Rect piece = { (int)(fromX + ((toX - fromX) * progress)), (int)(fromY + ((toY - fromY) * progress)), xInc, yInc };
+
+            if (animation->kind == ANIMATION_CAPTURE)
+                DrawPiece(animation->piece, &piece, (uint8_t)(255 * (1.0f - progress)));
+            else
+                DrawPiece(animation->piece, &piece, 255);
+        }
+    }
+}
+
+
+// Draw the squares in the mask: checker and selection first, then the pieces at rest on them.
+static void DrawSquares(const GAME_SNAPSHOT *snapshot, uint64_t squares, int xInc, int yInc, bool useBoardLayer)
+{
+    for (int rank = 0; rank < NUM_RANKS; rank++)
+    {
+        for (int file = 0; file < NUM_FILES; file++)
+        {
+            if ((squares & SquareBit(rank, file)) == 0)
+                continue;
+
+            int row = (NUM_RANKS - 1) - rank;
+            SDL_Rect square = { file * xInc, row * yInc, xInc, yInc };
+
+            if (useBoardLayer)
+                renderBackend->Blit(boardLayer, &square, &square, 255);
+            else
+                renderBackend->FillRect(&square, ((row + file) % 2) == 0 ? boardLightColor : boardDarkColor);
+            frameDrawCalls++;
+
+            // Highlight the square the next move starts from.
+            if (rank == snapshot->selectedRank && file == snapshot->selectedFile)
+            {
+                renderBackend->FillRect(&square, selectionColor);
+                frameDrawCalls++;
+            }
+        }
+    }
+
+    // Pieces after the board, so the copies are not interleaved with fills.
+    // Pieces that are moving are drawn by the animations instead.
+    for (int rank = 0; rank < NUM_RANKS; rank++)
+    {
+        for (int file = 0; file < NUM_FILES; file++)
+        {
+            if ((squares & SquareBit(rank, file)) == 0 || IsAnimationTarget(snapshot, rank, file))
+                continue;
+
+            SDL_Rect square = { file * xInc, ((NUM_RANKS - 1) - rank) * yInc, xInc, yInc };
+            DrawPiece(snapshot->board.pieces[rank][file], &square, 255);
+        }
+    }
+}
+
+
+void Render_Invalidate(void)
+{
+    SDL_AtomicSet(&frameLayerLost, 1);
+}
+
+
+// The board seen from above, drawn from the atlas. Only the squares that changed are drawn again when there
+// is a frame layer. Returns false if nothing had to be drawn.
+static bool Draw2D(const GAME_SNAPSHOT *snapshot, double interpolation, bool presentNeeded)
+{
+    int xInc = drawViewport.w / 8.0f;
+    int yInc = drawViewport.h / 8.0f;
+
+    bool useBoardLayer = UpdateBoardLayer();
+    bool useFrameLayer = UpdateFrameLayer();
+
+    uint64_t animatedSquares = GetAnimatedSquares(snapshot);
+    uint64_t dirtySquares = GetDirtySquares(snapshot, animatedSquares);
+
+    if (dirtySquares == 0 && !presentNeeded)
+        return false;
+
+    if (useFrameLayer && dirtySquares != 0 && !renderBackend->SetTarget(frameLayer))
+        useFrameLayer = false;
+
+    if (useFrameLayer)
+    {
+        // Bring the frame layer up to date, then show it.
+        if (dirtySquares != 0)
+        {
+            DrawSquares(snapshot, dirtySquares, xInc, yInc, useBoardLayer);
+            DrawAnimations(snapshot, interpolation, xInc, yInc);
+            renderBackend->SetTarget(NULL);
+        }
+
+        renderBackend->Clear(backgroundColor);
+        SDL_Rect board = { 0, 0, drawViewport.w, drawViewport.h };
+        renderBackend->Blit(frameLayer, &board, &board, 255);
+        frameDrawCalls += 2;
+    }
+    else
+    {
+        // Without a frame layer, every frame that is drawn at all is drawn in full.
+        renderBackend->Clear(backgroundColor);
+        frameDrawCalls++;
+
+        DrawSquares(snapshot, ~(uint64_t)0, xInc, yInc, useBoardLayer);
+        DrawAnimations(snapshot, interpolation, xInc, yInc);
+    }
+
+    RememberDrawnFrame(snapshot, animatedSquares);
+
+    // A frame layer that could not be drawn into is out of date.
+    if (!useFrameLayer && frameLayer != NULL)
+        SDL_AtomicSet(&frameLayerLost, 1);
+
+    return true;
+}
+
+
+// Where a piece model stands on a square of the board model, scaled by scale on top of the usual size.
+// Dark pieces face the light ones.
+static void GetPieceInstance(GAME_PIECE piece, float rank, float file, float scale, bool selected, RENDER_INSTANCE *instance)
+{
+    const MODEL *board = &models[OBJ_BOARD_SHAPE];
+    const MODEL *model = &models[pieceModels[piece]];
+    bool dark = piece >= PIECE_BPAWN;
+
+    // Rank 1 is nearest the camera's starting position, file a to its left.
+    float squareWidth = (board->maximum[0] - board->minimum[0]) / NUM_FILES;
+    float squareDepth = (board->maximum[2] - board->minimum[2]) / NUM_RANKS;
+    float modelScale = PIECE_MODEL_SCALE * scale;
+    glm::vec3 position(board->minimum[0] + ((file + 0.5f) * squareWidth),
+        board->maximum[1] - (model->minimum[1] * modelScale),
+        board->maximum[2] - ((rank + 0.5f) * squareDepth));
+
+    glm::mat4 transform = glm::translate(glm::mat4(), position);
+    if (dark)
+        transform = glm::rotate(transform, glm::pi<float>(), glm::vec3(0.0f, 1.0f, 0.0f));
+    transform = glm::scale(transform, glm::vec3(modelScale));
+
+    memcpy(instance->transform, glm::value_ptr(transform), sizeof(instance->transform));
+    if (selected)
+        instance->color = selectedPieceColor;
+    else
+        instance->color = dark ? darkPieceColor : lightPieceColor;
+}
+
+
+// The board and pieces as models, seen through the camera. Drawn in full every frame, with one draw
+// for the board's squares of each color and one for each kind of piece.
+static void Draw3D(const GAME_SNAPSHOT *snapshot, double interpolation)
+{
+    typedef RENDER_INSTANCE SHAPE_INSTANCES[MAX_PIECE_INSTANCES];
+    SHAPE_INSTANCES *instances = ARENA_ARRAY(&renderArena, SHAPE_INSTANCES, OBJ_ASSET_SHAPE_COUNT);
+    int instanceCounts[OBJ_ASSET_SHAPE_COUNT] = { 0 };
+
+    float view[16];
+    float projection[16];
+    Snapshot_InterpolateCamera(interpolation, view, projection);
+    glm::mat4 viewProjection = glm::make_mat4(projection) * glm::make_mat4(view);
+
+    renderBackend->Clear(backgroundColor);
+    frameDrawCalls++;
+
+    // The board model is not moved; its two colors are separate parts.
+    const MODEL *board = &models[OBJ_BOARD_SHAPE];
+    RENDER_INSTANCE boardInstance;
+    memcpy(boardInstance.transform, glm::value_ptr(glm::mat4()), sizeof(boardInstance.transform));
+    const char *partNames[2] = { "board_dark", "board_light" };
+    const SDL_Color partColors[2] = { boardDarkColor, boardLightColor };
+    for (int i = 0; i < 2; i++)
+    {
+        const MODEL_PART *part = Model_FindPart(board, partNames[i]);
+        if (part == NULL)
+            continue;
+
+        boardInstance.color = partColors[i];
+        renderBackend->DrawModel(renderModels[OBJ_BOARD_SHAPE], part->firstIndex, part->indexCount,
+            glm::value_ptr(viewProjection), &boardInstance, 1);
+        frameDrawCalls++;
+    }
+
+    // Counted in the arena's failed allocations; the board is still drawn.
+    if (instances == NULL)
+        return;
+
+    // Pieces at rest. Pieces that are moving are drawn by the animations instead.
+    for (int rank = 0; rank < NUM_RANKS; rank++)
+    {
+        for (int file = 0; file < NUM_FILES; file++)
+        {
+            GAME_PIECE piece = snapshot->board.pieces[rank][file];
+            if (piece == PIECE_EMPTY || IsAnimationTarget(snapshot, rank, file))
+                continue;
+
+            int shape = pieceModels[piece];
+            bool selected = rank == snapshot->selectedRank && file == snapshot->selectedFile;
+            GetPieceInstance(piece, (float)rank, (float)file, 1.0f, selected, &instances[shape][instanceCounts[shape]++]);
+        }
+    }
+
+    // Moving pieces slide between the squares; captured pieces shrink away.
+    for (int i = 0; i < ANIMATION_POOL_SIZE; i++)
+    {
+        const ANIMATION *animation = &snapshot->animations[i];
+        if (!animation->active || animation->piece == PIECE_EMPTY)
+            continue;
+
+        float progress = Animation_Progress(animation, snapshot->tick, interpolation);
+        float rank = animation->fromRank + ((animation->toRank - animation->fromRank) * progress);
+        float file = animation->fromFile + ((animation->toFile - animation->fromFile) * progress);
+        float scale = animation->kind == ANIMATION_CAPTURE ? 1.0f - progress : 1.0f;
+
+        int shape = pieceModels[animation->piece];
+        GetPieceInstance(animation->piece, rank, file, scale, false, &instances[shape][instanceCounts[shape]++]);
+    }
+
+    for (int shape = 0; shape < OBJ_BOARD_SHAPE; shape++)
+    {
+        if (instanceCounts[shape] == 0)
+            continue;
+
+        renderBackend->DrawModel(renderModels[shape], 0, models[shape].indexCount,
+            glm::value_ptr(viewProjection), instances[shape], instanceCounts[shape]);
+        frameDrawCalls++;
+    }
+}
+
+
+bool Render_Draw(uint32_t currentTick, double interpolation)
+{
+    const GAME_SNAPSHOT *snapshot = Snapshot_Current();
+
+    ApplyViewport(&snapshot->viewport);
+    UpdateAtlas();
+
+    frameDrawCalls = 0;
+
+    // Latency is measured at present, so a frame that answers an input is presented even if nothing changed.
+    bool presentNeeded = SDL_AtomicSet(&presentRequested, 0) != 0
+        || (snapshot->inputTime != 0 && snapshot->inputTime != lastPresentedInputTime)
+        || (snapshot->resizeTime != 0 && snapshot->resizeTime != lastPresentedResizeTime)
+        || (unsharpResizeTime != 0 && atlasLayout.size == wantedAtlasSize)
+        || capture.pixels != NULL
+        || lastFrame3D;
+
+    lastFrame3D = !snapshot->viewMode2D && modelsReady;
+    if (lastFrame3D)
+        Draw3D(snapshot, interpolation);
+    else if (!Draw2D(snapshot, interpolation, presentNeeded))
+    {
+        lastFrameDrawCalls = 0;
+        return false;
+    }
+
+    if (capture.pixels != NULL)
+    {
+        SDL_Rect board = { 0, 0, drawViewport.w, drawViewport.h };
+        capture.finished = capture.width == drawViewport.w && capture.height == drawViewport.h
+            && renderBackend->ReadPixels(&board, capture.pixels, capture.pitch);
+        capture.pixels = NULL;
+    }
+
+    renderBackend->Present();
+    lastFrameDrawCalls = frameDrawCalls;
+
+    // The response to the latest input is on screen now.
+    if (snapshot->inputTime != 0 && snapshot->inputTime != lastPresentedInputTime)
+    {
+        Latency_Record(snapshot->inputKind, snapshot->inputTime);
+        lastPresentedInputTime = snapshot->inputTime;
+    }
+
+    // The board is drawn at the size of the latest resize, with the pieces possibly still scaled.
+    if (snapshot->resizeTime != 0 && snapshot->resizeTime != lastPresentedResizeTime)
+    {
+        Latency_Record(LATENCY_RESIZE, snapshot->resizeTime);
+        lastPresentedResizeTime = snapshot->resizeTime;
+        unsharpResizeTime = snapshot->resizeTime;
+    }
+
+    // The pieces are rasterized for that size, too.
+    if (unsharpResizeTime != 0 && atlasLayout.size == wantedAtlasSize)
+    {
+        Latency_Record(LATENCY_RESIZE_SHARP, unsharpResizeTime);
+        unsharpResizeTime = 0;
+    }
+
+    return true;
 }
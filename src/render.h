@@ -22,15 +22,45 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "SDL_pixels.h"
+#include "SDL_rect.h"
 
 
+// Colors of the checkerboard squares, a8 being light.
+extern const SDL_Color boardLightColor;
+extern const SDL_Color boardDarkColor;
+
 extern bool userClickedTileLastFrame;
 extern int lastFrameClickedRank;
 extern int lastFrameClickedFile;
+// Arrival time of the click, as an SDL performance counter value.
+extern uint64_t lastFrameClickTime;
+// Arrival time of the latest window resize, as an SDL performance counter value.
+extern uint64_t lastResizeTime;
+// Draw the checkerboard once per viewport size into a texture, instead of square by square every frame.
+extern bool boardLayerEnabled;
 
 
 bool Render_Init(void);
 void Render_Logic(uint32_t currentTick);
 void Render_Quit(void);
 
-void Render_Draw(uint32_t currentTick, double interpolation);
+// The square area of the window the board occupies, as seen by the game logic.
+void Render_GetViewport(SDL_Rect *viewport);
+
+// Draw and present the latest snapshot, redrawing only the squares that changed.
+// Returns false if nothing changed and the frame was skipped.
+bool Render_Draw(uint32_t currentTick, double interpolation);
+
+// Draw the whole frame again on the next Render_Draw.
+void Render_Invalidate(void);
+
+// Renderer draw calls issued by the last Render_Draw.
+uint32_t Render_LastFrameDrawCalls(void);
+
+// Copy the board area of the next frame Render_Draw presents into width by height R, G, B, A pixels,
+// just before it is presented. That frame is presented even if nothing changed.
+void Render_RequestCapture(void *pixels, int width, int height, int pitch);
+// True once after the requested frame was captured; false if it is still pending or could not be read,
+// e.g. because the board was drawn at another size.
+bool Render_CaptureFinished(void);
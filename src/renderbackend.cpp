@@ -0,0 +1,62 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "renderbackend.h"
+#include "logger.h"
+
+
+const RENDER_BACKEND *renderBackend = NULL;
+// Above and to the side of the white player, so the pieces are not lit flat from the camera.
+const float renderLightDirection[3] = { 0.267f, 0.891f, 0.367f };
+static RENDER_BACKEND_KIND activeKind;
+
+
+bool RenderBackend_Init(RENDER_BACKEND_KIND kind, int width, int height)
+{
+    activeKind = kind;
+
+    switch (kind)
+    {
+    case RENDER_BACKEND_CPU:
+        if (!CPUBackend_Init(width, height))
+            return false;
+        renderBackend = &cpuRenderBackend;
+        break;
+    default:
+        SDLBackend_Init();
+        renderBackend = &sdlRenderBackend;
+        break;
+    }
+
+    LOG_INFO(LOG_CATEGORY_RENDER, "Drawing with the %s backend", renderBackend->name);
+
+    return true;
+}
+
+
+void RenderBackend_Quit(void)
+{
+    if (renderBackend != NULL && activeKind == RENDER_BACKEND_CPU)
+        CPUBackend_Quit();
+    else if (renderBackend != NULL)
+        SDLBackend_Quit();
+
+    renderBackend = NULL;
+}
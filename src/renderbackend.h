@@ -0,0 +1,131 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "model.h"
+#include "SDL_pixels.h"
+#include "SDL_rect.h"
+
+
+// Models are lit by one directional light, from renderLightDirection, and this much ambient light.
+#define RENDER_LIGHT_AMBIENT (0.35f)
+
+
+// A texture of the active backend. Only the backend knows what it is.
+typedef struct RENDER_TEXTURE RENDER_TEXTURE;
+// A model uploaded to the active backend.
+typedef struct RENDER_MODEL RENDER_MODEL;
+
+typedef enum
+{
+    // Written from the CPU with LockTexture, as R, G, B, A bytes.
+    RENDER_TEXTURE_STREAMING,
+    // Drawn into after SetTarget.
+    RENDER_TEXTURE_TARGET
+} RENDER_TEXTURE_ACCESS;
+
+typedef enum
+{
+    // Copy the source over the destination.
+    RENDER_BLEND_NONE,
+    // Blend the source over the destination by its alpha.
+    RENDER_BLEND_ALPHA
+} RENDER_BLEND;
+
+// One copy of a model: a column-major 4x4 matrix from model to world space, without scaling
+// that distorts normals, and a color. The color's alpha is ignored.
+typedef struct
+{
+    float transform[16];
+    SDL_Color color;
+} RENDER_INSTANCE;
+
+// The drawing commands Render_Draw is built from. Rectangles are in pixels, relative to the viewport
+// when drawing to the output and to the texture when drawing into a target.
+// All of them must be called on the thread that draws.
+typedef struct
+{
+    const char *name;
+
+    // Size of the output in pixels. Safe to call from any thread.
+    void (*GetOutputSize)(int *width, int *height);
+    bool (*TargetsSupported)(void);
+
+    RENDER_TEXTURE* (*CreateTexture)(RENDER_TEXTURE_ACCESS access, int width, int height);
+    void (*DestroyTexture)(RENDER_TEXTURE *texture);
+    void (*GetTextureSize)(RENDER_TEXTURE *texture, int *width, int *height);
+    void (*SetTextureBlend)(RENDER_TEXTURE *texture, RENDER_BLEND blend);
+    bool (*LockTexture)(RENDER_TEXTURE *texture, const SDL_Rect *region, void **pixels, int *pitch);
+    void (*UnlockTexture)(RENDER_TEXTURE *texture);
+
+    // Draw into a target texture, or into the output with NULL, which restores the viewport.
+    bool (*SetTarget)(RENDER_TEXTURE *target);
+    // Area of the output that drawing to it is offset to and clipped by.
+    void (*SetViewport)(const SDL_Rect *viewport);
+
+    // Fill the whole target with a color, without blending, and clear its depth.
+    void (*Clear)(SDL_Color color);
+    // Fill a rectangle, blended by the color's alpha.
+    void (*FillRect)(const SDL_Rect *rect, SDL_Color color);
+    // Copy part of a texture into a rectangle, scaled to fit, with the texture's blend mode and its
+    // alpha multiplied by alpha.
+    void (*Blit)(RENDER_TEXTURE *texture, const SDL_Rect *source, const SDL_Rect *destination, uint8_t alpha);
+    // Keep a model where the backend can draw it from, until it is destroyed. The model must outlive it.
+    // Returns NULL if the backend cannot draw models.
+    RENDER_MODEL* (*CreateModel)(const MODEL *model);
+    void (*DestroyModel)(RENDER_MODEL *model);
+    // Draw indexCount indices of a model from firstIndex once per instance, lit and depth tested.
+    // viewProjection is a column-major 4x4 matrix from world to clip space.
+    bool (*DrawModel)(RENDER_MODEL *model, int firstIndex, int indexCount, const float *viewProjection, const RENDER_INSTANCE *instances, int instanceCount);
+
+    // Read back an area of the output, relative to the viewport, as R, G, B, A bytes. Call before Present.
+    bool (*ReadPixels)(const SDL_Rect *area, void *pixels, int pitch);
+    void (*Present)(void);
+} RENDER_BACKEND;
+
+typedef enum
+{
+    // Draws with sdlRenderer.
+    RENDER_BACKEND_SDL,
+    // Draws on the CPU into a framebuffer in memory, shown in sdlWindow if there is one.
+    RENDER_BACKEND_CPU
+} RENDER_BACKEND_KIND;
+
+
+// The backend every drawing command goes through.
+extern const RENDER_BACKEND *renderBackend;
+// Unit vector towards the light, in world space.
+extern const float renderLightDirection[3];
+
+// Select the backend. Without a window, the CPU backend's output is width by height pixels.
+bool RenderBackend_Init(RENDER_BACKEND_KIND kind, int width, int height);
+void RenderBackend_Quit(void);
+
+
+// The implementations.
+extern const RENDER_BACKEND sdlRenderBackend;
+extern const RENDER_BACKEND cpuRenderBackend;
+void SDLBackend_Init(void);
+void SDLBackend_Quit(void);
+bool CPUBackend_Init(int width, int height);
+void CPUBackend_Quit(void);
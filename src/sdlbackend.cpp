@@ -0,0 +1,332 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "renderbackend.h"
+#include "glmodel.h"
+#include "logger.h"
+#include "main.h"
+#include "meshraster.h"
+#include "SDL.h"
+
+
+// Set when the renderer draws with OpenGL and the context can draw models.
+static bool modelsSupported = false;
+
+// Otherwise models are rasterized on the CPU into this layer, which covers the viewport, and copied
+// through a streaming texture over whatever was drawn before them.
+static struct
+{
+    SDL_Texture *texture;
+    unsigned char *pixels;
+    float *depth;
+    int width;
+    int height;
+    // Set by Clear; the layer is cleared to transparent before the next model is drawn into it.
+    bool clearPending;
+    // Set while it holds models that are not on the renderer yet.
+    bool drawn;
+} meshLayer;
+
+static bool drawingToTarget = false;
+static SDL_Rect currentViewport;
+
+
+// A RENDER_TEXTURE of this backend is an SDL_Texture.
+static SDL_Texture* ToSDL(RENDER_TEXTURE *texture)
+{
+    return (SDL_Texture*)texture;
+}
+
+
+// Internal function.
+// Rasterize the models drawn into the mesh layer and copy it over the viewport.
+static void FlushMeshLayer(void)
+{
+    if (!meshLayer.drawn)
+        return;
+
+    MeshRaster_Flush();
+    SDL_UpdateTexture(meshLayer.texture, NULL, meshLayer.pixels, meshLayer.width * 4);
+    SDL_RenderCopy(sdlRenderer, meshLayer.texture, NULL, NULL);
+    meshLayer.drawn = false;
+}
+
+
+// Internal function.
+// Make the mesh layer the size of the viewport and clear it if a Clear asked for it.
+static bool PrepareMeshLayer(void)
+{
+    if (meshLayer.texture == NULL || meshLayer.width != currentViewport.w || meshLayer.height != currentViewport.h)
+    {
+        if (meshLayer.texture != NULL)
+            SDL_DestroyTexture(meshLayer.texture);
+        delete[] meshLayer.pixels;
+        delete[] meshLayer.depth;
+
+        meshLayer.texture = SDL_CreateTexture(sdlRenderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, currentViewport.w, currentViewport.h);
+        meshLayer.pixels = new unsigned char[(size_t)currentViewport.w * currentViewport.h * 4];
+        meshLayer.depth = new float[(size_t)currentViewport.w * currentViewport.h];
+        meshLayer.width = currentViewport.w;
+        meshLayer.height = currentViewport.h;
+        meshLayer.clearPending = true;
+
+        if (meshLayer.texture == NULL)
+            return false;
+        SDL_SetTextureBlendMode(meshLayer.texture, SDL_BLENDMODE_BLEND);
+    }
+
+    if (meshLayer.clearPending)
+    {
+        size_t pixelCount = (size_t)meshLayer.width * meshLayer.height;
+        memset(meshLayer.pixels, 0, pixelCount * 4);
+        for (size_t i = 0; i < pixelCount; i++)
+            meshLayer.depth[i] = 1.0f;
+        meshLayer.clearPending = false;
+    }
+
+    return true;
+}
+
+
+static void GetOutputSize(int *width, int *height)
+{
+    if (sdlWindow != NULL)
+        SDL_GL_GetDrawableSize(sdlWindow, width, height);
+    else
+        SDL_GetRendererOutputSize(sdlRenderer, width, height);
+}
+
+
+static bool TargetsSupported(void)
+{
+    return SDL_RenderTargetSupported(sdlRenderer) == SDL_TRUE;
+}
+
+
+static RENDER_TEXTURE* CreateTexture(RENDER_TEXTURE_ACCESS access, int width, int height)
+{
+    // Streaming textures take nanosvg's R, G, B, A bytes as they are. Targets use the renderer's usual format.
+    if (access == RENDER_TEXTURE_STREAMING)
+        return (RENDER_TEXTURE*)SDL_CreateTexture(sdlRenderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, width, height);
+    return (RENDER_TEXTURE*)SDL_CreateTexture(sdlRenderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+}
+
+
+static void DestroyTexture(RENDER_TEXTURE *texture)
+{
+    if (texture != NULL)
+        SDL_DestroyTexture(ToSDL(texture));
+}
+
+
+static void GetTextureSize(RENDER_TEXTURE *texture, int *width, int *height)
+{
+    SDL_QueryTexture(ToSDL(texture), NULL, NULL, width, height);
+}
+
+
+static void SetTextureBlend(RENDER_TEXTURE *texture, RENDER_BLEND blend)
+{
+    SDL_SetTextureBlendMode(ToSDL(texture), blend == RENDER_BLEND_ALPHA ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+}
+
+
+static bool LockTexture(RENDER_TEXTURE *texture, const SDL_Rect *region, void **pixels, int *pitch)
+{
+    return SDL_LockTexture(ToSDL(texture), region, pixels, pitch) == 0;
+}
+
+
+static void UnlockTexture(RENDER_TEXTURE *texture)
+{
+    SDL_UnlockTexture(ToSDL(texture));
+}
+
+
+static bool SetTarget(RENDER_TEXTURE *target)
+{
+    FlushMeshLayer();
+    drawingToTarget = target != NULL;
+    return SDL_SetRenderTarget(sdlRenderer, ToSDL(target)) == 0;
+}
+
+
+static void SetViewport(const SDL_Rect *viewport)
+{
+    FlushMeshLayer();
+    currentViewport = *viewport;
+    SDL_RenderSetViewport(sdlRenderer, viewport);
+}
+
+
+static void Clear(SDL_Color color)
+{
+    FlushMeshLayer();
+    meshLayer.clearPending = true;
+
+    SDL_SetRenderDrawColor(sdlRenderer, color.r, color.g, color.b, color.a);
+    SDL_RenderClear(sdlRenderer);
+
+    if (modelsSupported)
+        GLModel_ClearDepth();
+}
+
+
+static void FillRect(const SDL_Rect *rect, SDL_Color color)
+{
+    FlushMeshLayer();
+    SDL_SetRenderDrawBlendMode(sdlRenderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(sdlRenderer, color.r, color.g, color.b, color.a);
+    SDL_RenderFillRect(sdlRenderer, rect);
+}
+
+
+static void Blit(RENDER_TEXTURE *texture, const SDL_Rect *source, const SDL_Rect *destination, uint8_t alpha)
+{
+    FlushMeshLayer();
+
+    if (alpha != 255)
+        SDL_SetTextureAlphaMod(ToSDL(texture), alpha);
+
+    SDL_RenderCopy(sdlRenderer, ToSDL(texture), source, destination);
+
+    if (alpha != 255)
+        SDL_SetTextureAlphaMod(ToSDL(texture), 255);
+}
+
+
+// SDL_Renderer has no triangles before SDL 2.0.18, so models are drawn with OpenGL underneath it when it
+// uses OpenGL. A RENDER_MODEL is then a GL_MODEL, and otherwise the MODEL itself.
+static RENDER_MODEL* CreateModel(const MODEL *model)
+{
+    if (!modelsSupported)
+        return (RENDER_MODEL*)model;
+
+    return (RENDER_MODEL*)GLModel_Create(model);
+}
+
+
+static void DestroyModel(RENDER_MODEL *model)
+{
+    if (modelsSupported)
+        GLModel_Destroy((GL_MODEL*)model);
+}
+
+
+static bool DrawModel(RENDER_MODEL *model, int firstIndex, int indexCount, const float *viewProjection, const RENDER_INSTANCE *instances, int instanceCount)
+{
+    if (modelsSupported)
+        return GLModel_Draw((GL_MODEL*)model, firstIndex, indexCount, viewProjection, instances, instanceCount);
+
+    // The layer only covers the output.
+    if (drawingToTarget || currentViewport.w <= 0 || currentViewport.h <= 0 || !PrepareMeshLayer())
+        return false;
+
+    MESH_RASTER_TARGET target;
+    target.pixels = meshLayer.pixels;
+    target.depth = meshLayer.depth;
+    target.width = meshLayer.width;
+    target.height = meshLayer.height;
+    target.clip.x = 0;
+    target.clip.y = 0;
+    target.clip.w = meshLayer.width;
+    target.clip.h = meshLayer.height;
+    target.viewport = target.clip;
+
+    MeshRaster_Draw(&target, (const MODEL*)model, firstIndex, indexCount, viewProjection, instances, instanceCount);
+    meshLayer.drawn = true;
+
+    return true;
+}
+
+
+static bool ReadPixels(const SDL_Rect *area, void *pixels, int pitch)
+{
+    FlushMeshLayer();
+    return SDL_RenderReadPixels(sdlRenderer, area, SDL_PIXELFORMAT_RGBA32, pixels, pitch) == 0;
+}
+
+
+static void Present(void)
+{
+    FlushMeshLayer();
+    SDL_RenderPresent(sdlRenderer);
+    MeshRaster_EndFrame();
+}
+
+
+const RENDER_BACKEND sdlRenderBackend =
+{
+    "SDL",
+    GetOutputSize,
+    TargetsSupported,
+    CreateTexture,
+    DestroyTexture,
+    GetTextureSize,
+    SetTextureBlend,
+    LockTexture,
+    UnlockTexture,
+    SetTarget,
+    SetViewport,
+    Clear,
+    FillRect,
+    Blit,
+    CreateModel,
+    DestroyModel,
+    DrawModel,
+    ReadPixels,
+    Present
+};
+
+
+void SDLBackend_Init(void)
+{
+    SDL_RendererInfo info;
+    modelsSupported = false;
+    drawingToTarget = false;
+    SDL_zero(currentViewport);
+    SDL_zero(meshLayer);
+
+    if (sdlRenderer == NULL || SDL_GetRendererInfo(sdlRenderer, &info) != 0)
+        return;
+
+    // The renderer's own context is current after it is created and stays so on this thread.
+    if (strcmp(info.name, "opengl") == 0)
+        modelsSupported = GLModel_Init();
+
+    if (!modelsSupported)
+        LOG_INFO(LOG_CATEGORY_RENDER, "The %s renderer has no OpenGL to draw models with; drawing them on the CPU", info.name);
+}
+
+
+void SDLBackend_Quit(void)
+{
+    if (modelsSupported)
+        GLModel_Quit();
+    modelsSupported = false;
+
+    MeshRaster_Flush();
+    if (meshLayer.texture != NULL)
+        SDL_DestroyTexture(meshLayer.texture);
+    delete[] meshLayer.pixels;
+    delete[] meshLayer.depth;
+    SDL_zero(meshLayer);
+}
@@ -0,0 +1,147 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+    Snapshot Notes:
+
+    The logic and render threads share game state through a triple buffer.
+    The logic thread always owns one slot (the back buffer) and the render
+    thread always owns another (the front buffer).
+    The third slot is exchanged atomically between them, along with a flag
+    that records whether it holds a snapshot the renderer has not seen yet.
+
+    Neither side ever waits for the other.
+    The logic thread may publish several snapshots between two frames, in
+    which case the renderer simply sees the latest one.
+*/
+
+
+#include <string.h>
+#include "animation.h"
+#include "camera.h"
+#include "game.h"
+#include "render.h"
+#include "snapshot.h"
+#include "SDL.h"
+
+
+#define SNAPSHOT_SLOT_COUNT (3)
+#define SNAPSHOT_INDEX_MASK (0x3)
+#define SNAPSHOT_FRESH_FLAG (0x4)
+
+
+static GAME_SNAPSHOT snapshotSlots[SNAPSHOT_SLOT_COUNT];
+
+// Index of the slot the logic thread writes into.
+static int backIndex;
+// Index of the slot handed between threads, combined with SNAPSHOT_FRESH_FLAG.
+static SDL_atomic_t sharedIndex;
+// Index of the slot the render thread reads from.
+static int frontIndex;
+
+// Copy of the snapshot the render thread consumed before the current one.
+static GAME_SNAPSHOT previousSnapshot;
+
+
+bool Snapshot_Init(void)
+{
+    memset(snapshotSlots, 0, sizeof(snapshotSlots));
+    memset(&previousSnapshot, 0, sizeof(previousSnapshot));
+
+    backIndex = 0;
+    SDL_AtomicSet(&sharedIndex, 1);
+    frontIndex = 2;
+
+    return true;
+}
+
+
+void Snapshot_Quit(void)
+{
+}
+
+
+void Snapshot_Publish(uint32_t currentTick)
+{
+    GAME_SNAPSHOT *snapshot = &snapshotSlots[backIndex];
+
+    snapshot->tick = currentTick;
+    snapshot->publishTime = SDL_GetPerformanceCounter();
+
+    snapshot->board = boardState;
+    snapshot->status = gameStatus;
+    snapshot->selectedRank = selectedRank;
+    snapshot->selectedFile = selectedFile;
+    snapshot->inputTime = lastInputTime;
+    snapshot->inputKind = lastInputKind;
+    snapshot->resizeTime = lastResizeTime;
+    memcpy(snapshot->animations, animationPool, sizeof(snapshot->animations));
+
+    snapshot->viewMode2D = viewMode2D;
+    Camera_GetMatrices(snapshot->view, snapshot->projection);
+
+    Render_GetViewport(&snapshot->viewport);
+
+    // Make sure the snapshot is fully written before it becomes visible.
+    SDL_MemoryBarrierRelease();
+    int oldIndex = SDL_AtomicSet(&sharedIndex, backIndex | SNAPSHOT_FRESH_FLAG);
+
+    backIndex = oldIndex & SNAPSHOT_INDEX_MASK;
+}
+
+
+bool Snapshot_Acquire(void)
+{
+    if ((SDL_AtomicGet(&sharedIndex) & SNAPSHOT_FRESH_FLAG) == 0)
+        return false;
+
+    // The front slot is about to be handed back to the logic thread.
+    previousSnapshot = snapshotSlots[frontIndex];
+
+    int oldIndex = SDL_AtomicSet(&sharedIndex, frontIndex);
+    SDL_MemoryBarrierAcquire();
+
+    frontIndex = oldIndex & SNAPSHOT_INDEX_MASK;
+
+    return true;
+}
+
+
+const GAME_SNAPSHOT* Snapshot_Current(void)
+{
+    return &snapshotSlots[frontIndex];
+}
+
+
+void Snapshot_InterpolateCamera(double interpolation, float *view, float *projection)
+{
+    const GAME_SNAPSHOT *current = Snapshot_Current();
+
+    // Never blend across a change of view mode.
+    if (current->viewMode2D != previousSnapshot.viewMode2D)
+        interpolation = 1.0;
+
+    float t = (float)interpolation;
+    for (int i = 0; i < 16; i++)
+    {
+        view[i] = previousSnapshot.view[i] + ((current->view[i] - previousSnapshot.view[i]) * t);
+        projection[i] = previousSnapshot.projection[i] + ((current->projection[i] - previousSnapshot.projection[i]) * t);
+    }
+}
@@ -0,0 +1,72 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "animation.h"
+#include "game.h"
+#include "SDL.h"
+
+
+// Everything the renderer needs to know about a single logic tick.
+// Snapshots are written only by the logic thread and are never modified once published.
+typedef struct
+{
+    uint32_t tick;
+    // SDL performance counter value at the time of publication.
+    uint64_t publishTime;
+
+    BOARD_STATE board;
+    GAME_STATUS status;
+    int selectedRank;
+    int selectedFile;
+    // The last input the game responded to, for input latency measurement.
+    uint64_t inputTime;
+    LATENCY_KIND inputKind;
+    ANIMATION animations[ANIMATION_POOL_SIZE];
+
+    bool viewMode2D;
+    float view[16];
+    float projection[16];
+
+    // The square area of the window the board is drawn into.
+    SDL_Rect viewport;
+    // Arrival time of the resize that produced the viewport, for resize latency measurement.
+    uint64_t resizeTime;
+} GAME_SNAPSHOT;
+
+
+bool Snapshot_Init(void);
+void Snapshot_Quit(void);
+
+// Logic thread: copy the current game state into the back buffer and make it the latest snapshot.
+void Snapshot_Publish(uint32_t currentTick);
+
+// Render thread: switch to the latest published snapshot, if there is one.
+// Returns true if a new snapshot was consumed.
+bool Snapshot_Acquire(void);
+
+// Render thread: the snapshot consumed by the last call to Snapshot_Acquire.
+const GAME_SNAPSHOT* Snapshot_Current(void);
+
+// Render thread: blend the camera matrices of the previous and current snapshots.
+void Snapshot_InterpolateCamera(double interpolation, float *view, float *projection);
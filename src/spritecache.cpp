@@ -0,0 +1,458 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "logger.h"
+#include "spritecache.h"
+#include "SDL.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#define SPRITE_FILE_MAGIC (0x54525053)  // "SPRT"
+#define SPRITE_FILE_VERSION (1)
+#define SPRITE_INDEX_NAME "index.txt"
+#define SPRITE_PATH_LENGTH (1024)
+
+
+// Precedes the raw pixels in a cache file. 32 bytes, so the pixels stay aligned in the mapping.
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t theme;
+    uint32_t tileSize;
+    uint32_t reserved;
+    uint64_t size;
+} SPRITE_FILE_HEADER;
+
+typedef struct
+{
+    void *base;
+    size_t size;
+} MAPPED_FILE;
+
+typedef struct
+{
+    int tileSize;
+    uint64_t theme;
+    size_t size;
+    const unsigned char *pixels;
+
+    // Exactly one of these holds the pixels: a heap buffer from the renderer, or a mapped cache file.
+    unsigned char *buffer;
+    MAPPED_FILE mapping;
+
+    uint64_t lastUse;
+} SPRITE_CACHE_ENTRY;
+
+typedef struct
+{
+    int tileSize;
+    uint64_t theme;
+} SPRITE_CACHE_KEY;
+
+
+static SPRITE_CACHE_ENTRY entries[SPRITE_CACHE_MAX_ENTRIES];
+static int entryCount = 0;
+static size_t usedBytes = 0;
+static size_t budget = SPRITE_CACHE_DEFAULT_BUDGET;
+static uint64_t useClock = 0;
+
+// Directory of the cache files, or NULL when nothing is persisted.
+static char *cacheDirectory = NULL;
+// Sets that were on disk when the cache started.
+static SPRITE_CACHE_KEY storedKeys[SPRITE_CACHE_MAX_ENTRIES];
+static int storedKeyCount = 0;
+
+static uint32_t memoryHits = 0;
+static uint32_t diskHits = 0;
+static uint32_t misses = 0;
+static uint32_t evictions = 0;
+
+
+static bool MapFile(const char *path, MAPPED_FILE *mapped)
+{
+#ifdef _WIN32
+    // The path is UTF-8.
+    WCHAR widePath[SPRITE_PATH_LENGTH];
+    if (MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath, SPRITE_PATH_LENGTH) == 0)
+        return false;
+
+    HANDLE file = CreateFileW(widePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // The view keeps the mapping and the file open after their handles are closed.
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+        return false;
+
+    void *base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (base == NULL)
+        return false;
+
+    mapped->base = base;
+    mapped->size = (size_t)fileSize.QuadPart;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0)
+    {
+        close(file);
+        return false;
+    }
+
+    void *base = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (base == MAP_FAILED)
+        return false;
+
+    mapped->base = base;
+    mapped->size = (size_t)status.st_size;
+#endif
+
+    return true;
+}
+
+
+static void UnmapFile(MAPPED_FILE *mapped)
+{
+    if (mapped->base == NULL)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(mapped->base);
+#else
+    munmap(mapped->base, mapped->size);
+#endif
+
+    mapped->base = NULL;
+    mapped->size = 0;
+}
+
+
+static void RemoveFile(const char *path)
+{
+#ifdef _WIN32
+    WCHAR widePath[SPRITE_PATH_LENGTH];
+    if (MultiByteToWideChar(CP_UTF8, 0, path, -1, widePath, SPRITE_PATH_LENGTH) != 0)
+        DeleteFileW(widePath);
+#else
+    remove(path);
+#endif
+}
+
+
+static void GetSetPath(int tileSize, uint64_t theme, char *path)
+{
+    SDL_snprintf(path, SPRITE_PATH_LENGTH, "%ssprites-%016" PRIx64 "-%d.rgba", cacheDirectory, theme, tileSize);
+}
+
+
+static void FreeEntry(SPRITE_CACHE_ENTRY *entry)
+{
+    delete[] entry->buffer;
+    entry->buffer = NULL;
+    UnmapFile(&entry->mapping);
+
+    usedBytes -= entry->size;
+}
+
+
+// Make room for a set of the given size. Returns false if it can never fit.
+static bool Reserve(size_t size)
+{
+    if (size > budget)
+        return false;
+
+    while (entryCount > 0 && (entryCount == SPRITE_CACHE_MAX_ENTRIES || usedBytes + size > budget))
+    {
+        int oldest = 0;
+        for (int i = 1; i < entryCount; i++)
+        {
+            if (entries[i].lastUse < entries[oldest].lastUse)
+                oldest = i;
+        }
+
+        FreeEntry(&entries[oldest]);
+        entries[oldest] = entries[--entryCount];
+        evictions++;
+    }
+
+    return true;
+}
+
+
+static SPRITE_CACHE_ENTRY* AddEntry(int tileSize, uint64_t theme, size_t size)
+{
+    SPRITE_CACHE_ENTRY *entry = &entries[entryCount++];
+    memset(entry, 0, sizeof(*entry));
+    entry->tileSize = tileSize;
+    entry->theme = theme;
+    entry->size = size;
+    entry->lastUse = ++useClock;
+
+    usedBytes += size;
+
+    return entry;
+}
+
+
+// Map a set written by an earlier run. Files that do not match what is asked for are ignored.
+static const unsigned char* LoadSet(int tileSize, uint64_t theme, size_t size)
+{
+    char path[SPRITE_PATH_LENGTH];
+    GetSetPath(tileSize, theme, path);
+
+    MAPPED_FILE mapping;
+    if (!MapFile(path, &mapping))
+        return NULL;
+
+    const SPRITE_FILE_HEADER *header = (const SPRITE_FILE_HEADER*)mapping.base;
+    if (mapping.size != sizeof(*header) + size || header->magic != SPRITE_FILE_MAGIC || header->version != SPRITE_FILE_VERSION
+        || header->theme != theme || header->tileSize != (uint32_t)tileSize || header->size != size || !Reserve(size))
+    {
+        UnmapFile(&mapping);
+        return NULL;
+    }
+
+    SPRITE_CACHE_ENTRY *entry = AddEntry(tileSize, theme, size);
+    entry->mapping = mapping;
+    entry->pixels = (const unsigned char*)mapping.base + sizeof(*header);
+
+    return entry->pixels;
+}
+
+
+static bool SaveSet(const SPRITE_CACHE_ENTRY *entry)
+{
+    char path[SPRITE_PATH_LENGTH];
+    GetSetPath(entry->tileSize, entry->theme, path);
+
+    SDL_RWops *file = SDL_RWFromFile(path, "wb");
+    if (file == NULL)
+        return false;
+
+    SPRITE_FILE_HEADER header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SPRITE_FILE_MAGIC;
+    header.version = SPRITE_FILE_VERSION;
+    header.theme = entry->theme;
+    header.tileSize = entry->tileSize;
+    header.size = entry->size;
+
+    bool success = SDL_RWwrite(file, &header, sizeof(header), 1) == 1
+        && SDL_RWwrite(file, entry->pixels, entry->size, 1) == 1;
+
+    if (SDL_RWclose(file) != 0)
+        success = false;
+
+    // A partial file would be rejected on load anyway, but do not leave it around.
+    if (!success)
+        RemoveFile(path);
+
+    return success;
+}
+
+
+static void ReadIndex(void)
+{
+    char path[SPRITE_PATH_LENGTH];
+    SDL_snprintf(path, sizeof(path), "%s" SPRITE_INDEX_NAME, cacheDirectory);
+
+    storedKeyCount = 0;
+
+    SDL_RWops *file = SDL_RWFromFile(path, "rb");
+    if (file == NULL)
+        return;
+
+    char text[SPRITE_CACHE_MAX_ENTRIES * 32];
+    size_t length = SDL_RWread(file, text, 1, sizeof(text) - 1);
+    text[length] = '\0';
+    SDL_RWclose(file);
+
+    char *line = text;
+    while (*line != '\0' && storedKeyCount < SPRITE_CACHE_MAX_ENTRIES)
+    {
+        SPRITE_CACHE_KEY *key = &storedKeys[storedKeyCount];
+        if (SDL_sscanf(line, "%d %" SCNx64, &key->tileSize, &key->theme) == 2)
+            storedKeyCount++;
+
+        char *next = SDL_strchr(line, '\n');
+        if (next == NULL)
+            break;
+        line = next + 1;
+    }
+}
+
+
+// Write out every cached set that is not on disk yet, and delete the files of sets that are no longer cached.
+static void WriteIndex(void)
+{
+    char path[SPRITE_PATH_LENGTH];
+    SDL_snprintf(path, sizeof(path), "%s" SPRITE_INDEX_NAME, cacheDirectory);
+
+    SDL_RWops *file = SDL_RWFromFile(path, "w");
+    if (file == NULL)
+        return;
+
+    int written = 0;
+    for (int i = 0; i < entryCount; i++)
+    {
+        const SPRITE_CACHE_ENTRY *entry = &entries[i];
+        if (entry->mapping.base == NULL && !SaveSet(entry))
+            continue;
+
+        char line[64];
+        int length = SDL_snprintf(line, sizeof(line), "%d %016" PRIx64 "\n", entry->tileSize, entry->theme);
+        SDL_RWwrite(file, line, length, 1);
+        written++;
+    }
+
+    SDL_RWclose(file);
+
+    for (int i = 0; i < storedKeyCount; i++)
+    {
+        bool kept = false;
+        for (int j = 0; j < entryCount && !kept; j++)
+            kept = entries[j].tileSize == storedKeys[i].tileSize && entries[j].theme == storedKeys[i].theme;
+
+        if (!kept)
+        {
+            GetSetPath(storedKeys[i].tileSize, storedKeys[i].theme, path);
+            RemoveFile(path);
+        }
+    }
+
+    LOG_INFO(LOG_CATEGORY_RENDER, "Sprite cache: %d sets on disk", written);
+}
+
+
+bool SpriteCache_Init(size_t budgetBytes, bool persistent)
+{
+    entryCount = 0;
+    usedBytes = 0;
+    budget = budgetBytes;
+    useClock = 0;
+    memoryHits = 0;
+    diskHits = 0;
+    misses = 0;
+    evictions = 0;
+
+    if (persistent)
+    {
+        // Not having a preference directory only costs the disk cache.
+        cacheDirectory = SDL_GetPrefPath("cg-chess", "sprites");
+        if (cacheDirectory == NULL)
+            LOG_WARN(LOG_CATEGORY_RENDER, "Sprite cache: no preference directory, sets are not persisted");
+        else
+            ReadIndex();
+    }
+
+    return true;
+}
+
+
+void SpriteCache_Quit(void)
+{
+    SpriteCache_LogStatistics();
+
+    if (cacheDirectory != NULL)
+        WriteIndex();
+
+    for (int i = 0; i < entryCount; i++)
+        FreeEntry(&entries[i]);
+    entryCount = 0;
+
+    SDL_free(cacheDirectory);
+    cacheDirectory = NULL;
+    storedKeyCount = 0;
+}
+
+
+const unsigned char* SpriteCache_Find(int tileSize, uint64_t theme, size_t size)
+{
+    for (int i = 0; i < entryCount; i++)
+    {
+        SPRITE_CACHE_ENTRY *entry = &entries[i];
+        if (entry->tileSize == tileSize && entry->theme == theme && entry->size == size)
+        {
+            entry->lastUse = ++useClock;
+            memoryHits++;
+            return entry->pixels;
+        }
+    }
+
+    if (cacheDirectory != NULL)
+    {
+        const unsigned char *pixels = LoadSet(tileSize, theme, size);
+        if (pixels != NULL)
+        {
+            diskHits++;
+            return pixels;
+        }
+    }
+
+    misses++;
+    return NULL;
+}
+
+
+void SpriteCache_Insert(int tileSize, uint64_t theme, unsigned char *pixels, size_t size)
+{
+    if (!Reserve(size))
+    {
+        delete[] pixels;
+        return;
+    }
+
+    SPRITE_CACHE_ENTRY *entry = AddEntry(tileSize, theme, size);
+    entry->buffer = pixels;
+    entry->pixels = pixels;
+}
+
+
+void SpriteCache_LogStatistics(void)
+{
+    LOG_INFO(LOG_CATEGORY_RENDER, "Sprite cache: %u memory hits, %u disk hits, %u misses, %u evictions, %d sets in %zu of %zu bytes",
+        memoryHits, diskHits, misses, evictions, entryCount, usedBytes, budget);
+}
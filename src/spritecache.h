@@ -0,0 +1,48 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define SPRITE_CACHE_DEFAULT_BUDGET (32 * 1024 * 1024)
+#define SPRITE_CACHE_MAX_ENTRIES (32)
+
+
+// Rasterized piece sets, keyed by tile size and theme.
+// Sets are kept in memory up to a byte budget, least recently used first out. With persistence on,
+// the sets still cached at exit are written to the user's preference directory and mapped back in
+// on later launches instead of being rasterized again.
+// Only the render thread may call Find and Insert.
+bool SpriteCache_Init(size_t budgetBytes, bool persistent);
+void SpriteCache_Quit(void);
+
+// The cached pixels of a set, or NULL. The size must match the one the set was inserted with.
+// The pointer is valid until the next call to SpriteCache_Insert or SpriteCache_Quit.
+const unsigned char* SpriteCache_Find(int tileSize, uint64_t theme, size_t size);
+
+// Hand a freshly rasterized set, allocated with new[], over to the cache.
+// It is freed at once if it does not fit the budget.
+void SpriteCache_Insert(int tileSize, uint64_t theme, unsigned char *pixels, size_t size);
+
+void SpriteCache_LogStatistics(void);
@@ -0,0 +1,117 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <float.h>
+#include <inttypes.h>
+#include <math.h>
+#include "logger.h"
+#include "timestep.h"
+#include "SDL.h"
+
+
+#define MICROSECONDS_PER_SECOND (1000000.0)
+
+
+void Timestep_Init(TIMESTEP *timestep, uint32_t ticksPerSecond, uint32_t maxCatchUpTicks)
+{
+    timestep->frequency = SDL_GetPerformanceFrequency();
+    timestep->ticksPerSecond = ticksPerSecond;
+    timestep->maxCatchUpTicks = maxCatchUpTicks;
+
+    timestep->previousCounter = SDL_GetPerformanceCounter();
+    timestep->laggedTime = 0;
+
+    Timestep_ResetStatistics(timestep);
+}
+
+
+uint32_t Timestep_Advance(TIMESTEP *timestep)
+{
+    uint64_t currentCounter = SDL_GetPerformanceCounter();
+    uint64_t elapsedCounts = currentCounter - timestep->previousCounter;
+    timestep->previousCounter = currentCounter;
+
+    // Frame interval statistics.
+    double frameTime = (elapsedCounts * MICROSECONDS_PER_SECOND) / timestep->frequency;
+    timestep->frameCount++;
+    timestep->frameTimeSum += frameTime;
+    timestep->frameTimeSquaredSum += frameTime * frameTime;
+    if (frameTime < timestep->frameTimeMinimum)
+        timestep->frameTimeMinimum = frameTime;
+    if (frameTime > timestep->frameTimeMaximum)
+        timestep->frameTimeMaximum = frameTime;
+
+    // One elapsed count is worth ticksPerSecond units of lag. One tick costs frequency units.
+    timestep->laggedTime += elapsedCounts * timestep->ticksPerSecond;
+
+    uint64_t dueTicks = timestep->laggedTime / timestep->frequency;
+    timestep->laggedTime -= dueTicks * timestep->frequency;
+
+    // Avoid the spiral of death: if logic can't keep up, slow the game down instead of falling further behind.
+    if (dueTicks > timestep->maxCatchUpTicks)
+    {
+        timestep->droppedTicks += (uint32_t)(dueTicks - timestep->maxCatchUpTicks);
+        dueTicks = timestep->maxCatchUpTicks;
+    }
+
+    return (uint32_t)dueTicks;
+}
+
+
+double Timestep_Interpolation(const TIMESTEP *timestep)
+{
+    return timestep->laggedTime / (double)timestep->frequency;
+}
+
+
+uint32_t Timestep_MillisecondsUntilNextTick(const TIMESTEP *timestep)
+{
+    uint64_t remainingUnits = timestep->frequency - timestep->laggedTime;
+
+    // Round down, so sleeping never makes a tick late.
+    return (uint32_t)((remainingUnits * 1000) / (timestep->frequency * timestep->ticksPerSecond));
+}
+
+
+void Timestep_LogStatistics(const TIMESTEP *timestep, const char *name)
+{
+    if (timestep->frameCount == 0)
+        return;
+
+    double mean = timestep->frameTimeSum / timestep->frameCount;
+    double variance = (timestep->frameTimeSquaredSum / timestep->frameCount) - (mean * mean);
+    if (variance < 0.0)
+        variance = 0.0;
+
+    LOG_INFO(LOG_CATEGORY_MAIN, "%s: Interval mean: %.3fms min: %.3fms max: %.3fms jitter: %.3fms Dropped ticks: %" PRIu32,
+                name, mean / 1000.0, timestep->frameTimeMinimum / 1000.0, timestep->frameTimeMaximum / 1000.0,
+                sqrt(variance) / 1000.0, timestep->droppedTicks);
+}
+
+
+void Timestep_ResetStatistics(TIMESTEP *timestep)
+{
+    timestep->frameCount = 0;
+    timestep->frameTimeSum = 0.0;
+    timestep->frameTimeSquaredSum = 0.0;
+    timestep->frameTimeMinimum = DBL_MAX;
+    timestep->frameTimeMaximum = 0.0;
+    timestep->droppedTicks = 0;
+}
@@ -0,0 +1,63 @@
+/*
+    Copyright 2017, Nicholas Jankowski, Carson Killbreath, Nathan Oles,
+    Richard Peterson, Rebecca Roughton, Benjamin Schnell
+
+    This file is part of cg-chess.
+
+    cg-chess is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cg-chess is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cg-chess.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+// Fixed logic timestep measured with the SDL performance counter.
+// Lag is kept in units of (1 / (frequency * ticksPerSecond)) seconds, so a logic tick is
+// exactly `frequency` units long and no rounding error accumulates, whatever the tick rate.
+typedef struct
+{
+    uint64_t frequency;
+    uint32_t ticksPerSecond;
+    uint32_t maxCatchUpTicks;
+
+    uint64_t previousCounter;
+    uint64_t laggedTime;
+
+    // Frame interval statistics since the last call to Timestep_ResetStatistics, in microseconds.
+    uint32_t frameCount;
+    double frameTimeSum;
+    double frameTimeSquaredSum;
+    double frameTimeMinimum;
+    double frameTimeMaximum;
+    // Logic ticks thrown away because they were more than maxCatchUpTicks behind.
+    uint32_t droppedTicks;
+} TIMESTEP;
+
+
+void Timestep_Init(TIMESTEP *timestep, uint32_t ticksPerSecond, uint32_t maxCatchUpTicks);
+
+// Measure the time since the last call and return how many logic ticks are due.
+// Never returns more than maxCatchUpTicks; older ticks are dropped instead of run.
+uint32_t Timestep_Advance(TIMESTEP *timestep);
+
+// The fraction of a tick that has elapsed since the last due tick, in [0, 1).
+double Timestep_Interpolation(const TIMESTEP *timestep);
+
+// Whole milliseconds that can be slept before the next tick is due.
+uint32_t Timestep_MillisecondsUntilNextTick(const TIMESTEP *timestep);
+
+void Timestep_LogStatistics(const TIMESTEP *timestep, const char *name);
+void Timestep_ResetStatistics(TIMESTEP *timestep);
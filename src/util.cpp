@@ -21,6 +21,8 @@
 #include "glm/mat4x3.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "tiny_obj_loader.h"
+#include "util.h"
+#include "SDL.h"
 
 
 std::vector<glm::mat4x3>* Util_FindBoundingBox(tinyobj::attrib_t attrib, std::vector<tinyobj::shape_t> shapes)
@@ -125,3 +127,106 @@ std::vector<glm::mat4x3>* Util_FindBoundingBox(tinyobj::attrib_t attrib, std::ve
 
     return planes;
 }
+
+
+// Internal function.
+static const char* LineEnd(const char *text)
+{
+    const char *end = SDL_strchr(text, '\n');
+    return end != NULL ? end : text + SDL_strlen(text);
+}
+
+
+// Internal function.
+// Where the value of the key "key" starts, if the key is in between start and end.
+// The quotes and the colon are part of the match, so a key never matches a longer one or a string value.
+static const char* FindKey(const char *start, const char *end, const char *key)
+{
+    size_t length = SDL_strlen(key);
+    for (const char *c = start; c + length + 3 <= end; c++)
+    {
+        if (c[0] == '"' && SDL_strncmp(c + 1, key, length) == 0 && c[length + 1] == '"' && c[length + 2] == ':')
+            return c + length + 3;
+    }
+
+    return NULL;
+}
+
+
+// Internal function.
+// Whether a value is exactly the string text.
+static bool StringEquals(const char *value, const char *end, const char *text)
+{
+    while (value < end && *value == ' ')
+        value++;
+
+    size_t length = SDL_strlen(text);
+    return value + length + 2 <= end && value[0] == '"' && SDL_strncmp(value + 1, text, length) == 0 && value[length + 1] == '"';
+}
+
+
+bool Util_FindResultNumber(const char *text, const char *list, const char *name, const char *field, double *value)
+{
+    const char *listStart = FindKey(text, text + SDL_strlen(text), list);
+    if (listStart == NULL)
+        return false;
+
+    // The list runs from the line after its key to the line that closes it.
+    const char *line = LineEnd(listStart);
+    while (*line != '\0')
+    {
+        line++;
+        const char *end = LineEnd(line);
+
+        const char *first = line;
+        while (first < end && *first == ' ')
+            first++;
+        if (first < end && *first == ']')
+            return false;
+
+        const char *lineName = FindKey(line, end, "name");
+        if (lineName != NULL && StringEquals(lineName, end, name))
+        {
+            const char *number = FindKey(line, end, field);
+            if (number == NULL)
+                return false;
+
+            *value = SDL_strtod(number, NULL);
+            return true;
+        }
+
+        line = end;
+    }
+
+    return false;
+}
+
+
+bool Util_ReadFile(const char *path, std::vector<char> *contents)
+{
+    SDL_RWops *file = SDL_RWFromFile(path, "rb");
+    if (file == NULL)
+        return false;
+
+    Sint64 size = SDL_RWsize(file);
+    contents->assign(size > 0 ? (size_t)size + 1 : 1, '\0');
+    bool success = size == 0 || (size > 0 && SDL_RWread(file, contents->data(), (size_t)size, 1) == 1);
+    SDL_RWclose(file);
+
+    return success;
+}
+
+
+bool Util_WriteFile(const char *path, const void *data, size_t length)
+{
+    SDL_RWops *file = SDL_RWFromFile(path, "wb");
+    if (file == NULL)
+        return false;
+
+    bool success = length == 0 || SDL_RWwrite(file, data, length, 1) == 1;
+
+    if (SDL_RWclose(file) != 0)
+        success = false;
+
+    return success;
+}
@@ -20,8 +20,20 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <vector>
 #include "glm/mat4x3.hpp"
 #include "tiny_obj_loader.h"
 
 
 std::vector<glm::mat4x3>* Util_FindBoundingBox(tinyobj::attrib_t attrib, std::vector<tinyobj::shape_t> shapes);
+
+// Read a number from a results file that lists one JSON object per line, like the benchmark and golden timings.
+// The entry is the one in the list called list whose "name" is exactly name. Returns false if it or its field is missing.
+bool Util_FindResultNumber(const char *text, const char *list, const char *name, const char *field, double *value);
+
+// Read a whole file. A NUL is appended, so text can be used as a string; the file itself is size() - 1 bytes.
+bool Util_ReadFile(const char *path, std::vector<char> *contents);
+
+// Replace a file with length bytes of data.
+bool Util_WriteFile(const char *path, const void *data, size_t length);